@@ -0,0 +1,87 @@
+#include "AllocationCounter2D.h"
+#include <cassert>
+
+#if defined(KENGINE2D_TRACK_ALLOCATIONS)
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<bool> sCounting(false);
+static std::atomic<size_t> sAllocationCount(0);
+
+void * operator new(std::size_t size)
+{
+	if (sCounting.load(std::memory_order_relaxed))
+	{
+		sAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	void * memory = std::malloc(size != 0 ? size : 1);
+	if (memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void * operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void * memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void * memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void * memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void * memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+bool KEngine2D::AllocationCounter::IsEnabled()
+{
+	return true;
+}
+
+void KEngine2D::AllocationCounter::Begin()
+{
+	assert(!sCounting);
+	sAllocationCount = 0;
+	sCounting = true;
+}
+
+size_t KEngine2D::AllocationCounter::End()
+{
+	assert(sCounting);
+	sCounting = false;
+	return sAllocationCount;
+}
+
+#else
+
+bool KEngine2D::AllocationCounter::IsEnabled()
+{
+	return false;
+}
+
+void KEngine2D::AllocationCounter::Begin()
+{
+
+}
+
+size_t KEngine2D::AllocationCounter::End()
+{
+	return 0;
+}
+
+#endif
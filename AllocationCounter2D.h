@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+
+namespace KEngine2D
+{
+	//Counts heap allocations made through global operator new, on any thread, between Begin and End.  Only does anything
+	//when built with KENGINE2D_TRACK_ALLOCATIONS, which replaces the global operators in AllocationCounter2D.cpp, so leave
+	//it off in programs that replace them themselves.  Otherwise counts always come out as 0.
+	class AllocationCounter
+	{
+	public:
+		static bool IsEnabled();
+		//There's only the one count, so Begin asserts if it's already counting.  Every PhysicsSystem::Update counts, so in
+		//builds with KENGINE2D_TRACK_ALLOCATIONS two systems mustn't update at the same time on different threads.
+		static void Begin();
+		static size_t End(); //Allocations since Begin.  Counts don't nest.
+	};
+}
@@ -0,0 +1,69 @@
+//Times stepping the same moving transforms one at a time and as a MechanicsBatch, and prints how far apart the two
+//end up, which should be nothing.  Build it along with the library sources, for example:
+//  g++ -std=c++14 -O2 -DNDEBUG -I. -I<KEngineCore include path> Benchmarks/MechanicsBatch2D.cpp *.cpp -o MechanicsBatch2D -lpthread
+//  ./MechanicsBatch2D [transforms] [steps]
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "../MechanicalTransform2D.h"
+#include "../MechanicsBatch2D.h"
+
+using namespace KEngine2D;
+
+int main(int argc, char ** argv)
+{
+	int transformCount = argc > 1 ? atoi(argv[1]) : 100000;
+	int stepCount = argc > 2 ? atoi(argv[2]) : 100;
+
+	MechanicsUpdater updater;
+	std::vector<MechanicalTransform> loose(transformCount);
+	std::vector<MechanicalTransform> batched(transformCount);
+	for (int i = 0; i < transformCount; i++)
+	{
+		StaticTransform transform({ (Scalar)i, (Scalar)(i % 77) }, 0.1f * i);
+		Point velocity = { (Scalar)(i % 13) - 6.0f, (Scalar)(i % 7) - 3.0f };
+		Scalar angularVelocity = 0.01f * (i % 5);
+		loose[i].Init(transform, velocity, angularVelocity);
+		batched[i].Init(updater.GetBatch(), transform, velocity, angularVelocity);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (int step = 0; step < stepCount; step++)
+	{
+		for (MechanicalTransform & transform : loose)
+		{
+			transform.Update(1.0 / 60.0);
+		}
+	}
+	auto looseEnd = std::chrono::steady_clock::now();
+	for (int step = 0; step < stepCount; step++)
+	{
+		updater.Update(1.0 / 60.0);
+	}
+	auto batchedEnd = std::chrono::steady_clock::now();
+
+	double difference = 0.0;
+	for (int i = 0; i < transformCount; i++)
+	{
+		Point looseTranslation = loose[i].GetTranslation();
+		Point batchedTranslation = batched[i].GetTranslation();
+		difference += fabs(looseTranslation.x - batchedTranslation.x) + fabs(looseTranslation.y - batchedTranslation.y);
+		difference += fabs(loose[i].GetRotation() - batched[i].GetRotation());
+	}
+	printf("transforms=%d steps=%d\n", transformCount, stepCount);
+	printf("one at a time ms=%.1f\n", std::chrono::duration<double, std::milli>(looseEnd - start).count());
+	printf("batched ms=%.1f\n", std::chrono::duration<double, std::milli>(batchedEnd - looseEnd).count());
+	printf("difference=%g\n", difference);
+
+	for (MechanicalTransform & transform : batched)
+	{
+		transform.Deinit();
+	}
+	for (MechanicalTransform & transform : loose)
+	{
+		transform.Deinit();
+	}
+	return 0;
+}
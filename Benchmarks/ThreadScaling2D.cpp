@@ -0,0 +1,89 @@
+//Times PhysicsSystem::Update on the same scene at each thread count from 1 up to the given maximum, and prints the total
+//energy after each run, which should come out the same every time.  Build it along with the library sources, for example:
+//  g++ -std=c++14 -O2 -DNDEBUG -I. -I<KEngineCore include path> Benchmarks/ThreadScaling2D.cpp *.cpp -o ThreadScaling2D -lpthread
+//  ./ThreadScaling2D [objects] [frames] [max threads]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "../Physics2D.h"
+#include "../MechanicsBatch2D.h"
+
+using namespace KEngine2D;
+
+static void RunScene(int objectCount, int frameCount, int threadCount)
+{
+	const Scalar size = 1000.0f;
+	MechanicsBatch batch;
+	PhysicsSystem system;
+	system.Init(BroadphaseType::SweepAndPrune);
+	system.SetThreadCount(threadCount);
+	BoundaryLine walls[4];
+	walls[0].Init(1.0f, 0.0f, 0.0f);
+	walls[1].Init(-1.0f, 0.0f, size);
+	walls[2].Init(0.0f, 1.0f, 0.0f);
+	walls[3].Init(0.0f, -1.0f, size);
+	for (BoundaryLine & wall : walls)
+	{
+		system.AddBoundary(&wall);
+	}
+
+	//Same seed every run, so every thread count sees the same scene
+	srand(1);
+	std::vector<PhysicsHandle> bodies;
+	for (int i = 0; i < objectCount; i++)
+	{
+		Point position = { (Scalar)(rand() % 980 + 10), (Scalar)(rand() % 980 + 10) };
+		Point velocity = { (Scalar)(rand() % 100 - 50), (Scalar)(rand() % 100 - 50) };
+		PhysicsHandle body = system.CreateBody(&batch, 1.0f, StaticTransform(position), velocity);
+		if (i % 3 == 0)
+		{
+			system.AddBox(body, 6.0f, 4.0f);
+		}
+		else
+		{
+			system.AddCircle(body, 3.0f);
+		}
+		bodies.push_back(body);
+	}
+
+	long long collisionCount = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		batch.Integrate(1.0 / 60.0);
+		system.Update(1.0 / 60.0);
+		collisionCount += system.GetStatistics().collisionCount;
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	double energy = 0.0;
+	for (PhysicsHandle body : bodies)
+	{
+		energy += system.GetBody(body)->GetEnergy();
+	}
+	printf("threads=%d ms=%.1f collisions=%lld energy=%f\n", threadCount, std::chrono::duration<double, std::milli>(end - start).count(), collisionCount, energy);
+	system.Deinit();
+	for (BoundaryLine & wall : walls)
+	{
+		wall.Deinit();
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	int objectCount = argc > 1 ? atoi(argv[1]) : 3000;
+	int frameCount = argc > 2 ? atoi(argv[2]) : 200;
+	int maxThreadCount = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+	if (maxThreadCount < 1)
+	{
+		maxThreadCount = 1;
+	}
+	printf("objects=%d frames=%d\n", objectCount, frameCount);
+	for (int threadCount = 1; threadCount <= maxThreadCount; threadCount++)
+	{
+		RunScene(objectCount, frameCount, threadCount);
+	}
+	return 0;
+}
@@ -1,9 +1,125 @@
 #include "Boundaries2D.h"
 #include <cassert>
 #include <vector>
+#include <algorithm>
+#include <new>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+bool KEngine2D::Overlaps(AxisAlignedBoundingBox const & box, AxisAlignedBoundingBox const & other)
+{
+	return box.first.x <= other.second.x && other.first.x <= box.second.x && box.first.y <= other.second.y && other.first.y <= box.second.y;
+}
+
+bool KEngine2D::Contains(AxisAlignedBoundingBox const & box, AxisAlignedBoundingBox const & other)
+{
+	return box.first.x <= other.first.x && box.first.y <= other.first.y && other.second.x <= box.second.x && other.second.y <= box.second.y;
+}
+
+//Slab test of the segment from start to end
+bool KEngine2D::Intersects(AxisAlignedBoundingBox const & box, Point const & start, Point const & end)
+{
+	Scalar tMin = 0.0f;
+	Scalar tMax = 1.0f;
+	Scalar origin[2] = { start.x, start.y };
+	Scalar delta[2] = { end.x - start.x, end.y - start.y };
+	Scalar boxMin[2] = { box.first.x, box.first.y };
+	Scalar boxMax[2] = { box.second.x, box.second.y };
+	for (int i = 0; i < 2; i++) {
+		if (delta[i] == 0.0f) {
+			if (origin[i] < boxMin[i] || origin[i] > boxMax[i]) {
+				return false;
+			}
+		} else {
+			Scalar t1 = (boxMin[i] - origin[i]) / delta[i];
+			Scalar t2 = (boxMax[i] - origin[i]) / delta[i];
+			tMin = fmax(tMin, fmin(t1, t2));
+			tMax = fmin(tMax, fmax(t1, t2));
+			if (tMin > tMax) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void KEngine2D::Merge(AxisAlignedBoundingBox & box, AxisAlignedBoundingBox const & other)
+{
+	box.first.x = fmin(box.first.x, other.first.x);
+	box.first.y = fmin(box.first.y, other.first.y);
+	box.second.x = fmax(box.second.x, other.second.x);
+	box.second.y = fmax(box.second.y, other.second.y);
+}
+
+//When a point moving from start to end first comes within minDistance of the center.  Points already that close don't count.
+static bool SweepPointToCircle(KEngine2D::Point const & center, KEngine2D::Scalar minDistance, KEngine2D::Point const & start, KEngine2D::Point const & end, KEngine2D::Scalar & fraction)
+{
+	KEngine2D::Point offset = start;
+	offset -= center;
+	KEngine2D::Point delta = end;
+	delta -= start;
+	KEngine2D::Scalar c = KEngine2D::DotProduct(offset, offset) - (minDistance * minDistance);
+	if (c <= 0.0f) {
+		return false;
+	}
+	KEngine2D::Scalar a = KEngine2D::DotProduct(delta, delta);
+	KEngine2D::Scalar b = 2.0f * KEngine2D::DotProduct(offset, delta);
+	KEngine2D::Scalar discriminant = (b * b) - (4.0f * a * c);
+	if (a <= 0.0f || b >= 0.0f || discriminant < 0.0f) {
+		return false;
+	}
+	KEngine2D::Scalar time = (-b - sqrt(discriminant)) / (2.0f * a);
+	if (time > 1.0f) {
+		return false;
+	}
+	fraction = time;
+	return true;
+}
+
+//Keeps the two deepest corners past the boundary, each corner being its own feature.  Corners are rounded off by the radius.
+static bool GetCornersManifold(KEngine2D::Point const * vertices, int count, KEngine2D::Scalar radius, KEngine2D::BoundaryLine const & boundary, KEngine2D::ContactManifold & manifold)
+{
+	KEngine2D::Point boundaryNormal = boundary.GetNormal();
+	KEngine2D::Scalar length = sqrt(KEngine2D::DotProduct(boundaryNormal, boundaryNormal));
+	boundaryNormal /= length;
+
+	manifold.normal = -boundaryNormal;
+	manifold.pointCount = 0;
+	for (int i = 0; i < count; i++) {
+		KEngine2D::Scalar distance = (boundary.GetSignedDistance(vertices[i]) / length) - radius;
+		if (distance > 0.0f) {
+			continue;
+		}
+		KEngine2D::Point point = boundaryNormal;
+		point *= (-distance / 2.0f) - radius;
+		point += vertices[i];
+		KEngine2D::ContactPoint contact = { point, -distance, (unsigned int)i, 0.0f };
+		if (manifold.pointCount < 2) {
+			manifold.points[manifold.pointCount++] = contact;
+		} else {
+			int shallowest = manifold.points[0].depth < manifold.points[1].depth ? 0 : 1;
+			if (contact.depth > manifold.points[shallowest].depth) {
+				manifold.points[shallowest] = contact;
+			}
+		}
+	}
+	return manifold.pointCount > 0;
+}
+
+//For shapes without a test of their own, the average of the manifold's points
+static KEngine2D::CollisionInfo GetCollisionInfo(bool collides, KEngine2D::ContactManifold const & manifold, KEngine2D::Point const & normal)
+{
+	KEngine2D::CollisionInfo retVal = { false, KEngine2D::Point::Origin(), normal };
+	if (collides) {
+		retVal.collides = true;
+		for (int i = 0; i < manifold.pointCount; i++) {
+			retVal.collisionPoint += manifold.points[i].point;
+		}
+		retVal.collisionPoint /= (KEngine2D::Scalar)manifold.pointCount;
+	}
+	return retVal;
+}
+
 KEngine2D::BoundaryLine::BoundaryLine()
 {
 	mXCoefficient = 0.0f;
@@ -16,7 +132,7 @@ KEngine2D::BoundaryLine::~BoundaryLine()
 	Deinit();
 }
 
-void KEngine2D::BoundaryLine::Init( double xCoefficient, double yCoefficient, double constantCoefficient )
+void KEngine2D::BoundaryLine::Init( Scalar xCoefficient, Scalar yCoefficient, Scalar constantCoefficient )
 {
 	assert(xCoefficient != 0.0f || yCoefficient != 0.0f);
 	mXCoefficient = xCoefficient;
@@ -31,10 +147,10 @@ void KEngine2D::BoundaryLine::Deinit()
 	mConstantCoefficient = 0.0f;
 }
 
-double KEngine2D::BoundaryLine::GetSignedDistance( Point const & point ) const
+KEngine2D::Scalar KEngine2D::BoundaryLine::GetSignedDistance( Point const & point ) const
 {
 	assert(mXCoefficient != 0.0f || mYCoefficient != 0.0f);
-	double fDistance = mXCoefficient * point.x + mYCoefficient * point.y + mConstantCoefficient;
+	Scalar fDistance = mXCoefficient * point.x + mYCoefficient * point.y + mConstantCoefficient;
 	return fDistance;
 }
 
@@ -44,10 +160,26 @@ KEngine2D::Point KEngine2D::BoundaryLine::GetNormal() const
 	return normal;
 }
 
+bool KEngine2D::BoundaryLine::SweepCircle(Point const & start, Point const & end, Scalar radius, Scalar & fraction) const
+{
+	Point normal = GetNormal();
+	Scalar length = sqrt(DotProduct(normal, normal));
+	Scalar startDistance = GetSignedDistance(start) / length;
+	Scalar endDistance = GetSignedDistance(end) / length;
+	if (startDistance <= radius || endDistance > radius) {
+		return false;
+	}
+	fraction = (startDistance - radius) / (startDistance - endDistance);
+	return true;
+}
+
 KEngine2D::BoundingCircle::BoundingCircle()
 {
 	mTransform = 0;
 	mRadius = 0.0f;
+	mPose = { Point::Origin(), 1.0f, 1.0f, 0.0f };
+	mPoseVersion = 0;
+	mPoseCached = false;
 }
 
 KEngine2D::BoundingCircle::~BoundingCircle()
@@ -55,40 +187,66 @@ KEngine2D::BoundingCircle::~BoundingCircle()
 	Deinit();
 }
 
-void KEngine2D::BoundingCircle::Init( Transform * transform, double radius )
+void KEngine2D::BoundingCircle::Init( Transform * transform, Scalar radius )
 {
 	assert(transform != 0);
 	assert(radius >= 0.0f);
 	mTransform = transform;
 	mRadius = radius;
+	mPoseCached = false;
+	UpdatePose();
 }
 
 void KEngine2D::BoundingCircle::Deinit()
 {
 	mTransform = 0;
 	mRadius = 0.0f;
+	mPoseCached = false;
+}
+
+//Nothing to do if the transform hasn't changed since the last snapshot
+void KEngine2D::BoundingCircle::UpdatePose() const
+{
+	assert(mTransform != 0);
+	unsigned int version = mTransform->GetVersion();
+	if (mPoseCached && version == mPoseVersion)
+	{
+		return;
+	}
+	mPose = mTransform->GetPose();
+	mPoseVersion = version;
+	mPoseCached = true;
+	Point center = GetCenter();
+	Scalar radius = GetRadius();
+	mBoundingBox = { { center.x - radius, center.y - radius }, { center.x + radius, center.y + radius } };
 }
 
-double KEngine2D::BoundingCircle::GetRadius() const
+KEngine2D::Scalar KEngine2D::BoundingCircle::GetRadius() const
 {	
 	assert(mTransform != 0);
-	return mRadius * mTransform->GetScale();
+	return mRadius * mPose.scale;
 }
 
 KEngine2D::Point KEngine2D::BoundingCircle::GetCenter() const
 {
 	assert(mTransform != 0);
-	return mTransform->GetTranslation();
+	return mPose.translation;
 }
 
-double KEngine2D::BoundingCircle::GetArea() const
+KEngine2D::Scalar KEngine2D::BoundingCircle::GetArea() const
 {
 	return M_PI * pow(GetRadius(), 2);
 }
 
-double KEngine2D::BoundingCircle::GetAreaMomentOfInertia() const
+KEngine2D::Scalar KEngine2D::BoundingCircle::GetAreaMomentOfInertia() const
+{
+	return pow(GetRadius(), 2) / 2.0f;
+}
+
+KEngine2D::AxisAlignedBoundingBox KEngine2D::BoundingCircle::GetAxisAlignedBoundingBox() const
 {
-	return M_PI_4 * pow(GetRadius(), 4); //M_PI_4 is pi/4
+	assert(mTransform != 0);
+	return mBoundingBox;
 }
 
 KEngine2D::CollisionInfo KEngine2D::BoundingCircle::Collides( BoundingCircle const & other ) const
@@ -98,11 +256,11 @@ KEngine2D::CollisionInfo KEngine2D::BoundingCircle::Collides( BoundingCircle con
 	Point otherCenter = other.GetCenter();
 	retVal.collisionNormal = otherCenter;
 	retVal.collisionNormal -= center;
-	double distance2 = DotProduct(retVal.collisionNormal, retVal.collisionNormal);
-	float radius = GetRadius();
-	float otherRadius = other.GetRadius();
-	double minDistance = radius + otherRadius;
-	double minDistance2 = minDistance * minDistance;  // Cheaper than sqrt
+	Scalar distance2 = DotProduct(retVal.collisionNormal, retVal.collisionNormal);
+	Scalar radius = GetRadius();
+	Scalar otherRadius = other.GetRadius();
+	Scalar minDistance = radius + otherRadius;
+	Scalar minDistance2 = minDistance * minDistance;  // Cheaper than sqrt
 	retVal.collides = distance2 <= minDistance2;
 	retVal.collisionPoint = retVal.collisionNormal;
 	retVal.collisionPoint *= radius / minDistance;
@@ -114,8 +272,8 @@ KEngine2D::CollisionInfo KEngine2D::BoundingCircle::Collides( BoundaryLine const
 {
 	CollisionInfo retVal;
 	Point center = GetCenter();
-	double distance = boundary.GetSignedDistance(center);
-	double minDistance = GetRadius();
+	Scalar distance = boundary.GetSignedDistance(center);
+	Scalar minDistance = GetRadius();
 	retVal.collides = (distance <= minDistance);
 	retVal.collisionNormal = boundary.GetNormal();
 	retVal.collisionPoint = center;
@@ -123,11 +281,76 @@ KEngine2D::CollisionInfo KEngine2D::BoundingCircle::Collides( BoundaryLine const
 	return retVal;
 }
 
+bool KEngine2D::BoundingCircle::GetManifold(BoundingCircle const & other, ContactManifold & manifold) const
+{
+	Point center = GetCenter();
+	Point delta = other.GetCenter();
+	delta -= center;
+	Scalar radius = GetRadius();
+	Scalar minDistance = radius + other.GetRadius();
+	Scalar distance2 = DotProduct(delta, delta);
+	if (distance2 > minDistance * minDistance) {
+		return false;
+	}
+	Scalar distance = sqrt(distance2);
+	manifold.normal = { 1.0f, 0.0f }; //Any direction will do for perfectly overlapping circles
+	if (distance > 0.0f) {
+		manifold.normal = delta;
+		manifold.normal /= distance;
+	}
+	Scalar depth = minDistance - distance;
+	Point point = manifold.normal;
+	point *= radius - (depth / 2.0f); //Halfway through the overlap
+	point += center;
+	manifold.pointCount = 1;
+	manifold.points[0] = { point, depth, 0, 0.0f };
+	return true;
+}
+
+//The normal points out of the circle and into the boundary
+bool KEngine2D::BoundingCircle::GetManifold(BoundaryLine const & boundary, ContactManifold & manifold) const
+{
+	Point boundaryNormal = boundary.GetNormal();
+	Scalar length = sqrt(DotProduct(boundaryNormal, boundaryNormal));
+	boundaryNormal /= length;
+	Point center = GetCenter();
+	Scalar distance = boundary.GetSignedDistance(center) / length;
+	Scalar radius = GetRadius();
+	if (distance > radius) {
+		return false;
+	}
+	manifold.normal = -boundaryNormal;
+	Point point = boundaryNormal;
+	point *= -(radius + distance) / 2.0f; //Halfway between the deepest point and the boundary
+	point += center;
+	manifold.pointCount = 1;
+	manifold.points[0] = { point, radius - distance, 0, 0.0f };
+	return true;
+}
+
+KEngine2D::ConvexHull KEngine2D::BoundingCircle::GetConvexHull() const
+{
+	return { &mPose.translation, nullptr, 1, GetRadius() };
+}
+
+bool KEngine2D::BoundingCircle::SweepCircle(Point const & start, Point const & end, Scalar radius, Scalar & fraction) const
+{
+	return SweepPointToCircle(GetCenter(), GetRadius() + radius, start, end, fraction);
+}
+
+KEngine2D::Scalar KEngine2D::BoundingCircle::GetInnerRadius() const
+{
+	return GetRadius();
+}
+
 KEngine2D::BoundingBox::BoundingBox()
 {
 	mTransform = nullptr;
 	mWidth = 0.0f;
 	mHeight = 0.0f;
+	mPose = { Point::Origin(), 1.0f, 1.0f, 0.0f };
+	mPoseVersion = 0;
+	mPoseCached = false;
 }
 
 KEngine2D::BoundingBox::~BoundingBox()
@@ -135,7 +358,7 @@ KEngine2D::BoundingBox::~BoundingBox()
 	Deinit();
 }
 
-void KEngine2D::BoundingBox::Init(Transform * transform, double width, double height)
+void KEngine2D::BoundingBox::Init(Transform * transform, Scalar width, Scalar height)
 {
 	assert(transform != 0);
 	assert(width >= 0.0f);
@@ -143,6 +366,8 @@ void KEngine2D::BoundingBox::Init(Transform * transform, double width, double he
 	mTransform = transform;
 	mWidth = width;
 	mHeight = height;
+	mPoseCached = false;
+	UpdatePose();
 }
 
 void KEngine2D::BoundingBox::Deinit()
@@ -150,55 +375,89 @@ void KEngine2D::BoundingBox::Deinit()
 	mTransform = 0;
 	mWidth = 0.0f;
 	mHeight = 0.0f;
+	mPoseCached = false;
 }
 
-double KEngine2D::BoundingBox::GetWidth() const
+//Everything derived from the pose is worked out here, once per change, and every test after that just reads it
+void KEngine2D::BoundingBox::UpdatePose() const
 {
 	assert(mTransform != 0);
-	return mWidth * mTransform->GetScale();
+	unsigned int version = mTransform->GetVersion();
+	if (mPoseCached && version == mPoseVersion)
+	{
+		return;
+	}
+	mPose = mTransform->GetPose();
+	mPoseVersion = version;
+	mPoseCached = true;
+	mXAxis = { mPose.cosTheta, mPose.sinTheta };
+	mYAxis = { -mXAxis.y, mXAxis.x };
+	mHalfWidth = GetWidth() / 2.0f;
+	mHalfHeight = GetHeight() / 2.0f;
+	GetCorners(mCorners);
+	GetPolygon(mVertices, mNormals);
+	mBoundingBox = { mCorners[0], mCorners[0] };
+	for (int i = 1; i < Corner::CornerCount; i++) {
+		Merge(mBoundingBox, { mCorners[i], mCorners[i] });
+	}
 }
 
-double KEngine2D::BoundingBox::GetHeight() const
+KEngine2D::Scalar KEngine2D::BoundingBox::GetWidth() const
 {
 	assert(mTransform != 0);
-	return mHeight * mTransform->GetScale();
+	return mWidth * mPose.scale;
+}
+
+KEngine2D::Scalar KEngine2D::BoundingBox::GetHeight() const
+{
+	assert(mTransform != 0);
+	return mHeight * mPose.scale;
 }
 
 KEngine2D::Point KEngine2D::BoundingBox::GetCenter() const
 {
 	assert(mTransform != 0);
-	return mTransform->GetTranslation();
+	return mPose.translation;
 }
 
-double KEngine2D::BoundingBox::GetArea() const
+KEngine2D::Scalar KEngine2D::BoundingBox::GetArea() const
 {
 	return GetWidth() * GetHeight();
 }
 
-double KEngine2D::BoundingBox::GetAreaMomentOfInertia() const
+KEngine2D::Scalar KEngine2D::BoundingBox::GetAreaMomentOfInertia() const
 {
 	return (pow(GetHeight(), 2.0f) + pow(GetWidth(), 2.0f)) / 12.0f;
 }
 
-KEngine2D::Point KEngine2D::BoundingBox::GetCorner(Corner corner) const
+KEngine2D::AxisAlignedBoundingBox KEngine2D::BoundingBox::GetAxisAlignedBoundingBox() const
+{
+	assert(mTransform != 0);
+	return mBoundingBox;
+}
+
+void KEngine2D::BoundingBox::GetCorners(Point corners[CornerCount]) const
 {
-	assert(corner >= 0 && corner < Corner::CornerCount);
-	constexpr Point corners[4] = {
+	constexpr Point cornerVecs[CornerCount] = {
 		{-.5f, -.5f}, //Upper Left
 		{ .5f, -.5f}, //Upper Right
 		{ .5f,  .5f}, //Lower Right
 		{-.5f,  .5f}  //Lower Left
 	};
 
-	const Point &cornerVec = corners[corner];
-
-	return mTransform->LocalToGlobal({cornerVec.x * GetWidth(), cornerVec.y * GetHeight()});
+	Point localCorners[CornerCount];
+	for (int i = 0; i < Corner::CornerCount; i++) {
+		localCorners[i] = { cornerVecs[i].x * GetWidth(), cornerVecs[i].y * GetHeight() };
+	}
+	mPose.LocalToGlobalBatch(localCorners, corners, CornerCount);
 }
 
-KEngine2D::Point KEngine2D::BoundingBox::GetAxis(Axis axis) const
+KEngine2D::Point KEngine2D::BoundingBox::GetAxis(Point const corners[CornerCount], Axis axis)
 {
 	assert(axis >= 0 && axis < Axis::AxisCount);
-	return GetCorner((Corner)((axis * 2) + 1)) - GetCorner((Corner)0);
+	Point retVal = corners[(axis * 2) + 1];
+	retVal -= corners[0];
+	return retVal;
 }
 
 KEngine2D::CollisionInfo KEngine2D::BoundingBox::Collides(BoundaryLine const & boundary) const
@@ -208,9 +467,10 @@ KEngine2D::CollisionInfo KEngine2D::BoundingBox::Collides(BoundaryLine const & b
 	retVal.collisionNormal = boundary.GetNormal();
 	retVal.collisionPoint = Point::Origin();
 	int numPenetrating = 0;
+	Point const * corners = mCorners;
 	for (int i = 0; i < Corner::CornerCount; i++) {
-		Point corner = GetCorner((Corner)i);
-		float distance = boundary.GetSignedDistance(corner);
+		Point corner = corners[i];
+		Scalar distance = boundary.GetSignedDistance(corner);
 		if (distance < 0) {
 			numPenetrating++;;
 			retVal.collisionPoint += corner;
@@ -231,11 +491,11 @@ KEngine2D::CollisionInfo KEngine2D::BoundingBox::Collides(BoundingCircle const &
 	retVal.collisionPoint = Point::Origin();
 	Point center = GetCenter();
 	Point otherCenter = other.GetCenter();
-	float radius = other.GetRadius();
-	float radius2 = radius * radius;
-	float halfWidth = GetWidth() / 2.0f;
-	float halfHeight = GetHeight() / 2.0f;
-	Point otherCenterLocal = mTransform->GlobalToLocal(other.GetCenter());
+	Scalar radius = other.GetRadius();
+	Scalar radius2 = radius * radius;
+	Scalar halfWidth = mHalfWidth;
+	Scalar halfHeight = mHalfHeight;
+	Point otherCenterLocal = mPose.GlobalToLocal(other.GetCenter());
 
 	if (otherCenterLocal.x > -halfWidth && otherCenterLocal.x < halfWidth && otherCenterLocal.y > -halfHeight && otherCenterLocal.y < halfHeight) //Deep penetration
 	{
@@ -248,14 +508,14 @@ KEngine2D::CollisionInfo KEngine2D::BoundingBox::Collides(BoundingCircle const &
 		if (otherCenterLocal.y > halfHeight && otherCenterLocal.y < halfHeight + radius) //Top
 		{
 			retVal.collides = true;
-			retVal.collisionNormal = mTransform->LocalToGlobal({ 0, 1 }, true);
-			retVal.collisionPoint = mTransform->LocalToGlobal({ otherCenterLocal.x, halfHeight }, false);
+			retVal.collisionNormal = mPose.LocalToGlobal({ 0, 1 }, true);
+			retVal.collisionPoint = mPose.LocalToGlobal({ otherCenterLocal.x, halfHeight }, false);
 		}
 		else if (otherCenterLocal.y > -(halfHeight + radius) && otherCenterLocal.y < halfHeight) //Bottom
 		{
 			retVal.collides = true;
-			retVal.collisionNormal = mTransform->LocalToGlobal({ 0, -1 }, true);
-			retVal.collisionPoint = mTransform->LocalToGlobal({ otherCenterLocal.x, -halfHeight }, false);
+			retVal.collisionNormal = mPose.LocalToGlobal({ 0, -1 }, true);
+			retVal.collisionPoint = mPose.LocalToGlobal({ otherCenterLocal.x, -halfHeight }, false);
 		}
 	}
 	else if (otherCenterLocal.y > -halfHeight && otherCenterLocal.y < halfHeight) //Horizontal
@@ -263,22 +523,23 @@ KEngine2D::CollisionInfo KEngine2D::BoundingBox::Collides(BoundingCircle const &
 		if (otherCenterLocal.x > halfWidth && otherCenterLocal.x < halfWidth + radius) //Right
 		{
 			retVal.collides = true;
-			retVal.collisionNormal = mTransform->LocalToGlobal({ 1, 0 }, true);
-			retVal.collisionPoint = mTransform->LocalToGlobal({ halfWidth, otherCenterLocal.y }, false);
+			retVal.collisionNormal = mPose.LocalToGlobal({ 1, 0 }, true);
+			retVal.collisionPoint = mPose.LocalToGlobal({ halfWidth, otherCenterLocal.y }, false);
 		}
 		else if (otherCenterLocal.x > -(halfWidth + radius) && otherCenterLocal.x < halfWidth) //Left
 		{
 			retVal.collides = true;
-			retVal.collisionNormal = mTransform->LocalToGlobal({ -1, 0 }, true);
-			retVal.collisionPoint = mTransform->LocalToGlobal({ -halfWidth, otherCenterLocal.y }, false);
+			retVal.collisionNormal = mPose.LocalToGlobal({ -1, 0 }, true);
+			retVal.collisionPoint = mPose.LocalToGlobal({ -halfWidth, otherCenterLocal.y }, false);
 		}
 	} 
 	else // Check for corner penetration
 	{
+		Point const * corners = mCorners;
 		for (int i = 0; i < Corner::CornerCount; i++) {
-			Point corner = GetCorner((Corner)i);
+			Point corner = corners[i];
 			Point axis = otherCenter - corner;
-			float dist2 = DotProduct(axis, axis);
+			Scalar dist2 = DotProduct(axis, axis);
 			if (dist2 < radius2)
 			{
 				retVal.collides = true;
@@ -295,35 +556,38 @@ KEngine2D::CollisionInfo KEngine2D::BoundingBox::Collides(BoundingCircle const &
 KEngine2D::CollisionInfo KEngine2D::BoundingBox::Collides(BoundingBox const & other) const
 {
 	CollisionInfo retVal;
-	retVal.collides = MayCollide(other) && other.MayCollide(*this);
+	Point const * corners = mCorners;
+	Point const * otherCorners = other.mCorners;
+	retVal.collides = MayCollide(corners, otherCorners) && MayCollide(otherCorners, corners);
 	retVal.collisionNormal = Point::Origin();
 	retVal.collisionPoint = Point::Origin();
 	if (retVal.collides) {
-		std::vector<std::pair<Point, Point>> cornerPenetrations;
+		std::pair<Point, Point> cornerPenetrations[Corner::CornerCount * 2]; //Fixed size, since this runs for every touching pair
+		int penetrationCount = 0;
 		//Does our corners penetrate?
 		for (int i = 0; i < Corner::CornerCount; i++) {
-			CollisionInfo possibleCollision = other.Collides(GetCorner((Corner)i));
+			CollisionInfo possibleCollision = other.Collides(corners[i]);
 			if (possibleCollision.collides)
 			{
-				cornerPenetrations.push_back({ possibleCollision.collisionPoint, -possibleCollision.collisionNormal });// Invert the normal
+				cornerPenetrations[penetrationCount++] = { possibleCollision.collisionPoint, -possibleCollision.collisionNormal };// Invert the normal
 			}
 		}
 		//Okay, does one of their corners penetrate?
 		for (int i = 0; i < Corner::CornerCount; i++) {
-			CollisionInfo possibleCollision = Collides(other.GetCorner((Corner)i));
+			CollisionInfo possibleCollision = Collides(otherCorners[i]);
 			if (possibleCollision.collides)
 			{
-				cornerPenetrations.push_back({ possibleCollision.collisionPoint, possibleCollision.collisionNormal });
+				cornerPenetrations[penetrationCount++] = { possibleCollision.collisionPoint, possibleCollision.collisionNormal };
 			}
 		}
 
-		if (cornerPenetrations.size() > 0) {
-			for (auto penetration : cornerPenetrations) 
+		if (penetrationCount > 0) {
+			for (int i = 0; i < penetrationCount; i++) 
 			{
-				retVal.collisionPoint += penetration.first;
-				retVal.collisionNormal = penetration.second;
+				retVal.collisionPoint += cornerPenetrations[i].first;
+				retVal.collisionNormal = cornerPenetrations[i].second;
 			}
-			retVal.collisionPoint /= cornerPenetrations.size();
+			retVal.collisionPoint /= penetrationCount;
 			//retVal.collisionNormal /= cornerPenetrations.size();
 			
 		}
@@ -342,56 +606,54 @@ KEngine2D::CollisionInfo KEngine2D::BoundingBox::Collides(Point const & other) c
 {
 	CollisionInfo retVal;
 	retVal.collisionPoint = other;
-	Point otherLocal = mTransform->GlobalToLocal(other);
-	float halfWidth = GetWidth() / 2.0f;
-	float halfHeight = GetHeight() / 2.0f;
-	float slope = halfHeight / halfWidth;
+	Point otherLocal = mPose.GlobalToLocal(other);
+	Scalar halfWidth = mHalfWidth;
+	Scalar halfHeight = mHalfHeight;
+	Scalar slope = halfHeight / halfWidth;
 	retVal.collides = otherLocal.x > -halfWidth && otherLocal.x < halfWidth && otherLocal.y > -halfHeight &&  otherLocal.y < halfHeight;
 	if (otherLocal.y > (otherLocal.x * slope)) // Upper Right
 	{
 		if (otherLocal.y > (otherLocal.x * -slope)) //Upper quadrant
 		{
-			retVal.collisionNormal = mTransform->LocalToGlobal({ 0, 1 }, true);
+			retVal.collisionNormal = mPose.LocalToGlobal({ 0, 1 }, true);
 		}
 		else // Right quadrant
 		{
-			retVal.collisionNormal = mTransform->LocalToGlobal({ 1, 0 }, true);
+			retVal.collisionNormal = mPose.LocalToGlobal({ 1, 0 }, true);
 		}
 	}
 	else // Lower Left
 	{
 		if (otherLocal.y > (otherLocal.x * -slope)) //Left quadrant
 		{
-			retVal.collisionNormal = mTransform->LocalToGlobal({ -1, 0 }, true);
+			retVal.collisionNormal = mPose.LocalToGlobal({ -1, 0 }, true);
 		}
 		else // Bottom quadrant
 		{
-			retVal.collisionNormal = mTransform->LocalToGlobal({ 0, -1 }, true);
+			retVal.collisionNormal = mPose.LocalToGlobal({ 0, -1 }, true);
 		}
 	}
 	return retVal;
 }
 
-bool KEngine2D::BoundingBox::MayCollide(BoundingBox const & other) const
+bool KEngine2D::BoundingBox::MayCollide(Point const corners[CornerCount], Point const otherCorners[CornerCount])
 {
-	constexpr Corner firstCorner = (Corner)0;
-	
 	for (int a = 0; a < Axis::AxisCount; a++) {
 
 		Corner firstCorner = (Corner)0;
 
-		Point axis = GetAxis((Axis)a);
+		Point axis = GetAxis(corners, (Axis)a);
 		axis /= DotProduct(axis, axis);
-		float origin = DotProduct(GetCorner(firstCorner), axis);
+		Scalar origin = DotProduct(corners[firstCorner], axis);
 
-		double t = DotProduct(other.GetCorner(Corner::UpperLeft), axis);
+		Scalar t = DotProduct(otherCorners[Corner::UpperLeft], axis);
 
 		// Find the extent of box 2 on axis a
-		double tMin = t;
-		double tMax = t;
+		Scalar tMin = t;
+		Scalar tMax = t;
 
 		for (int c = firstCorner + 1; c < Corner::CornerCount; ++c) {
-			t = DotProduct(other.GetCorner((Corner)c), axis);
+			t = DotProduct(otherCorners[c], axis);
 
 			if (t < tMin) {
 				tMin = t;
@@ -410,11 +672,1062 @@ bool KEngine2D::BoundingBox::MayCollide(BoundingBox const & other) const
     return true;
 }
 
+void KEngine2D::BoundingBox::GetPolygon(Point vertices[CornerCount], Point normals[CornerCount]) const
+{
+	Point center = GetCenter();
+	Point xAxis = mXAxis;
+	Point yAxis = mYAxis;
+	Scalar halfWidth = mHalfWidth;
+	Scalar halfHeight = mHalfHeight;
+	constexpr Scalar signs[CornerCount][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+	for (int i = 0; i < CornerCount; i++) {
+		vertices[i] = { center.x + (signs[i][0] * halfWidth * xAxis.x) + (signs[i][1] * halfHeight * yAxis.x), center.y + (signs[i][0] * halfWidth * xAxis.y) + (signs[i][1] * halfHeight * yAxis.y) };
+	}
+	normals[0] = -yAxis;
+	normals[1] = xAxis;
+	normals[2] = yAxis;
+	normals[3] = -xAxis;
+}
+
+//Largest gap between one of our edges and the other polygon's closest corner, negative when every edge overlaps
+KEngine2D::Scalar KEngine2D::BoundingBox::FindMaxSeparation(Point const vertices[CornerCount], Point const normals[CornerCount], Point const otherVertices[CornerCount], int & edge)
+{
+	Scalar maxSeparation = -HUGE_VAL;
+	edge = 0;
+	for (int i = 0; i < CornerCount; i++) {
+		Scalar separation = HUGE_VAL;
+		for (int j = 0; j < CornerCount; j++) {
+			Point offset = otherVertices[j];
+			offset -= vertices[i];
+			separation = fmin(separation, DotProduct(normals[i], offset));
+		}
+		if (separation > maxSeparation) {
+			maxSeparation = separation;
+			edge = i;
+		}
+	}
+	return maxSeparation;
+}
+
+//Keeps the part of the segment behind the plane, tagging any new end point with the plane's id
+static bool ClipSegment(KEngine2D::Point segment[2], unsigned int ids[2], KEngine2D::Point const & normal, KEngine2D::Scalar offset, unsigned int planeId)
+{
+	KEngine2D::Scalar distance = KEngine2D::DotProduct(normal, segment[0]) - offset;
+	KEngine2D::Scalar otherDistance = KEngine2D::DotProduct(normal, segment[1]) - offset;
+	if (distance > 0.0f && otherDistance > 0.0f) {
+		return false;
+	}
+	if (distance * otherDistance < 0.0f) {
+		KEngine2D::Point intersection = segment[1];
+		intersection -= segment[0];
+		intersection *= distance / (distance - otherDistance);
+		intersection += segment[0];
+		int clipped = distance > 0.0f ? 0 : 1;
+		segment[clipped] = intersection;
+		ids[clipped] = planeId;
+	}
+	return true;
+}
+
+//Separating axis test to find the reference face, then the incident face is clipped against it, for up to two points
+bool KEngine2D::BoundingBox::GetManifold(BoundingBox const & other, ContactManifold & manifold) const
+{
+	Point const * vertices = mVertices;
+	Point const * normals = mNormals;
+	Point const * otherVertices = other.mVertices;
+	Point const * otherNormals = other.mNormals;
+
+	int edge, otherEdge;
+	Scalar separation = FindMaxSeparation(vertices, normals, otherVertices, edge);
+	if (separation > 0.0f) {
+		return false;
+	}
+	Scalar otherSeparation = FindMaxSeparation(otherVertices, otherNormals, vertices, otherEdge);
+	if (otherSeparation > 0.0f) {
+		return false;
+	}
+
+	//Only switch to the other box's face when it's clearly better, so the choice doesn't flicker between frames
+	constexpr Scalar tolerance = 0.0005f;
+	bool flip = otherSeparation > separation + tolerance;
+	Point const * referenceVertices = flip ? otherVertices : vertices;
+	Point const * incidentVertices = flip ? vertices : otherVertices;
+	Point const * incidentNormals = flip ? normals : otherNormals;
+	int referenceEdge = flip ? otherEdge : edge;
+	Point referenceNormal = flip ? otherNormals[otherEdge] : normals[edge];
+
+	int incidentEdge = 0;
+	Scalar minDot = HUGE_VAL;
+	for (int i = 0; i < CornerCount; i++) {
+		Scalar dot = DotProduct(referenceNormal, incidentNormals[i]);
+		if (dot < minDot) {
+			minDot = dot;
+			incidentEdge = i;
+		}
+	}
+
+	Point segment[2] = { incidentVertices[incidentEdge], incidentVertices[(incidentEdge + 1) % CornerCount] };
+	unsigned int ids[2] = { (unsigned int)incidentEdge, (unsigned int)((incidentEdge + 1) % CornerCount) };
+	Point start = referenceVertices[referenceEdge];
+	Point end = referenceVertices[(referenceEdge + 1) % CornerCount];
+	Point tangent = end;
+	tangent -= start;
+	tangent /= sqrt(DotProduct(tangent, tangent));
+	if (!ClipSegment(segment, ids, -tangent, -DotProduct(tangent, start), CornerCount + referenceEdge) ||
+		!ClipSegment(segment, ids, tangent, DotProduct(tangent, end), CornerCount + ((referenceEdge + 1) % CornerCount))) {
+		return false;
+	}
+
+	Scalar frontOffset = DotProduct(referenceNormal, start);
+	manifold.normal = flip ? -referenceNormal : referenceNormal;
+	manifold.pointCount = 0;
+	for (int i = 0; i < 2; i++) {
+		Scalar pointSeparation = DotProduct(referenceNormal, segment[i]) - frontOffset;
+		if (pointSeparation <= 0.0f) {
+			unsigned int featureId = ((flip ? 1 : 0) << 12) | (referenceEdge << 8) | (incidentEdge << 4) | ids[i];
+			manifold.points[manifold.pointCount++] = { segment[i], -pointSeparation, featureId, 0.0f };
+		}
+	}
+	return manifold.pointCount > 0;
+}
+
+bool KEngine2D::BoundingBox::GetManifold(BoundingCircle const & other, ContactManifold & manifold) const
+{
+	Point xAxis = mXAxis;
+	Point yAxis = mYAxis;
+	Point center = GetCenter();
+	Point offset = other.GetCenter();
+	offset -= center;
+	Point otherCenterLocal = { DotProduct(offset, xAxis), DotProduct(offset, yAxis) };
+	Scalar radius = other.GetRadius();
+	Scalar halfWidth = mHalfWidth;
+	Scalar halfHeight = mHalfHeight;
+
+	Point closestLocal = { fmax(-halfWidth, fmin(halfWidth, otherCenterLocal.x)), fmax(-halfHeight, fmin(halfHeight, otherCenterLocal.y)) };
+	Point normalLocal;
+	Scalar depth;
+	unsigned int featureId;
+	if (closestLocal.x == otherCenterLocal.x && closestLocal.y == otherCenterLocal.y) { //Deep penetration, push out through the nearest face
+		Scalar xPenetration = halfWidth - fabs(otherCenterLocal.x);
+		Scalar yPenetration = halfHeight - fabs(otherCenterLocal.y);
+		if (xPenetration < yPenetration) {
+			normalLocal = { otherCenterLocal.x < 0.0f ? -1.0f : 1.0f, 0.0f };
+			closestLocal.x = normalLocal.x * halfWidth;
+			depth = xPenetration + radius;
+			featureId = normalLocal.x < 0.0f ? 3 : 1;
+		} else {
+			normalLocal = { 0.0f, otherCenterLocal.y < 0.0f ? -1.0f : 1.0f };
+			closestLocal.y = normalLocal.y * halfHeight;
+			depth = yPenetration + radius;
+			featureId = normalLocal.y < 0.0f ? 0 : 2;
+		}
+	} else {
+		Point delta = otherCenterLocal;
+		delta -= closestLocal;
+		Scalar distance2 = DotProduct(delta, delta);
+		if (distance2 > radius * radius) {
+			return false;
+		}
+		Scalar distance = sqrt(distance2);
+		normalLocal = delta;
+		normalLocal /= distance;
+		depth = radius - distance;
+		//Faces are 0 to 3 like the polygon edges, corners are 4 and up
+		bool onVerticalFace = closestLocal.x == otherCenterLocal.x;
+		bool onHorizontalFace = closestLocal.y == otherCenterLocal.y;
+		if (onVerticalFace) {
+			featureId = closestLocal.y < 0.0f ? 0 : 2;
+		} else if (onHorizontalFace) {
+			featureId = closestLocal.x < 0.0f ? 3 : 1;
+		} else {
+			featureId = CornerCount + (closestLocal.y < 0.0f ? (closestLocal.x < 0.0f ? 0 : 1) : (closestLocal.x < 0.0f ? 3 : 2));
+		}
+	}
+
+	manifold.normal = { (normalLocal.x * xAxis.x) + (normalLocal.y * yAxis.x), (normalLocal.x * xAxis.y) + (normalLocal.y * yAxis.y) };
+	Point point = { center.x + (closestLocal.x * xAxis.x) + (closestLocal.y * yAxis.x), center.y + (closestLocal.x * xAxis.y) + (closestLocal.y * yAxis.y) };
+	manifold.pointCount = 1;
+	manifold.points[0] = { point, depth, featureId, 0.0f };
+	return true;
+}
+
+bool KEngine2D::BoundingBox::GetManifold(BoundaryLine const & boundary, ContactManifold & manifold) const
+{
+	return GetCornersManifold(mVertices, CornerCount, 0.0f, boundary, manifold);
+}
+
+KEngine2D::ConvexHull KEngine2D::BoundingBox::GetConvexHull() const
+{
+	return { mVertices, mNormals, CornerCount, 0.0f };
+}
+
+KEngine2D::Scalar KEngine2D::BoundingBox::GetInnerRadius() const
+{
+	return std::min(GetWidth(), GetHeight()) / 2.0f;
+}
+
+//Slab test against the box grown by the radius, done in the box's own frame
+bool KEngine2D::BoundingBox::SweepCircle(Point const & start, Point const & end, Scalar radius, Scalar & fraction) const
+{
+	Point xAxis = mXAxis;
+	Point yAxis = mYAxis;
+	Point offset = start;
+	offset -= GetCenter();
+	Point delta = end;
+	delta -= start;
+	Scalar localStart[AxisCount] = { DotProduct(offset, xAxis), DotProduct(offset, yAxis) };
+	Scalar localDelta[AxisCount] = { DotProduct(delta, xAxis), DotProduct(delta, yAxis) };
+	Scalar halfExtents[AxisCount] = { mHalfWidth + radius, mHalfHeight + radius };
+
+	if (fabs(localStart[Horizontal]) <= halfExtents[Horizontal] && fabs(localStart[Vertical]) <= halfExtents[Vertical]) {
+		return false;
+	}
+	Scalar entryFraction = 0.0f;
+	Scalar exitFraction = 1.0f;
+	for (int axis = 0; axis < AxisCount; axis++) {
+		if (localDelta[axis] == 0.0f) {
+			if (fabs(localStart[axis]) > halfExtents[axis]) {
+				return false;
+			}
+			continue;
+		}
+		Scalar entryTime = (-halfExtents[axis] - localStart[axis]) / localDelta[axis];
+		Scalar exitTime = (halfExtents[axis] - localStart[axis]) / localDelta[axis];
+		if (entryTime > exitTime) {
+			std::swap(entryTime, exitTime);
+		}
+		entryFraction = fmax(entryFraction, entryTime);
+		exitFraction = fmin(exitFraction, exitTime);
+		if (entryFraction > exitFraction) {
+			return false;
+		}
+	}
+	fraction = entryFraction;
+	return true;
+}
+
+static KEngine2D::Point Scaled(KEngine2D::Point point, KEngine2D::Scalar scale)
+{
+	point *= scale;
+	return point;
+}
+
+//A corner of the Minkowski difference, remembering which corners of the two hulls made it
+struct SimplexVertex
+{
+	KEngine2D::Point point;      //On the first hull
+	KEngine2D::Point otherPoint; //On the second
+	KEngine2D::Point difference; //otherPoint - point
+	int index;
+	int otherIndex;
+	KEngine2D::Scalar weight;    //Share of the closest point, once the simplex is solved
+};
+
+static int FindSupport(KEngine2D::ConvexHull const & hull, KEngine2D::Point const & direction)
+{
+	int best = 0;
+	KEngine2D::Scalar bestDot = KEngine2D::DotProduct(hull.vertices[0], direction);
+	for (int i = 1; i < hull.count; i++) {
+		KEngine2D::Scalar dot = KEngine2D::DotProduct(hull.vertices[i], direction);
+		if (dot > bestDot) {
+			bestDot = dot;
+			best = i;
+		}
+	}
+	return best;
+}
+
+static SimplexVertex MakeSimplexVertex(KEngine2D::ConvexHull const & hull, int index, KEngine2D::ConvexHull const & other, int otherIndex)
+{
+	SimplexVertex vertex;
+	vertex.point = hull.vertices[index];
+	vertex.otherPoint = other.vertices[otherIndex];
+	vertex.difference = vertex.otherPoint;
+	vertex.difference -= vertex.point;
+	vertex.index = index;
+	vertex.otherIndex = otherIndex;
+	vertex.weight = 1.0f;
+	return vertex;
+}
+
+//Closest point on a segment to the origin, dropping the far end when it's closest to the near one
+static void SolveSimplex2(SimplexVertex simplex[3], int & count)
+{
+	KEngine2D::Point w1 = simplex[0].difference;
+	KEngine2D::Point w2 = simplex[1].difference;
+	KEngine2D::Point e12 = w2;
+	e12 -= w1;
+	KEngine2D::Scalar d12_2 = -KEngine2D::DotProduct(w1, e12);
+	if (d12_2 <= 0.0f) {
+		simplex[0].weight = 1.0f;
+		count = 1;
+		return;
+	}
+	KEngine2D::Scalar d12_1 = KEngine2D::DotProduct(w2, e12);
+	if (d12_1 <= 0.0f) {
+		simplex[1].weight = 1.0f;
+		simplex[0] = simplex[1];
+		count = 1;
+		return;
+	}
+	KEngine2D::Scalar inverse = 1.0f / (d12_1 + d12_2);
+	simplex[0].weight = d12_1 * inverse;
+	simplex[1].weight = d12_2 * inverse;
+	count = 2;
+}
+
+//The same for a triangle, checking each corner and edge region in turn before settling on the inside
+static void SolveSimplex3(SimplexVertex simplex[3], int & count)
+{
+	KEngine2D::Point w1 = simplex[0].difference;
+	KEngine2D::Point w2 = simplex[1].difference;
+	KEngine2D::Point w3 = simplex[2].difference;
+
+	KEngine2D::Point e12 = w2;
+	e12 -= w1;
+	KEngine2D::Scalar d12_1 = KEngine2D::DotProduct(w2, e12);
+	KEngine2D::Scalar d12_2 = -KEngine2D::DotProduct(w1, e12);
+	KEngine2D::Point e13 = w3;
+	e13 -= w1;
+	KEngine2D::Scalar d13_1 = KEngine2D::DotProduct(w3, e13);
+	KEngine2D::Scalar d13_2 = -KEngine2D::DotProduct(w1, e13);
+	KEngine2D::Point e23 = w3;
+	e23 -= w2;
+	KEngine2D::Scalar d23_1 = KEngine2D::DotProduct(w3, e23);
+	KEngine2D::Scalar d23_2 = -KEngine2D::DotProduct(w2, e23);
+
+	KEngine2D::Scalar n123 = KEngine2D::PseudoCrossProduct(e12, e13);
+	KEngine2D::Scalar d123_1 = n123 * KEngine2D::PseudoCrossProduct(w2, w3);
+	KEngine2D::Scalar d123_2 = n123 * KEngine2D::PseudoCrossProduct(w3, w1);
+	KEngine2D::Scalar d123_3 = n123 * KEngine2D::PseudoCrossProduct(w1, w2);
+
+	if (d12_2 <= 0.0f && d13_2 <= 0.0f) {
+		simplex[0].weight = 1.0f;
+		count = 1;
+	} else if (d12_1 > 0.0f && d12_2 > 0.0f && d123_3 <= 0.0f) {
+		KEngine2D::Scalar inverse = 1.0f / (d12_1 + d12_2);
+		simplex[0].weight = d12_1 * inverse;
+		simplex[1].weight = d12_2 * inverse;
+		count = 2;
+	} else if (d13_1 > 0.0f && d13_2 > 0.0f && d123_2 <= 0.0f) {
+		KEngine2D::Scalar inverse = 1.0f / (d13_1 + d13_2);
+		simplex[0].weight = d13_1 * inverse;
+		simplex[2].weight = d13_2 * inverse;
+		simplex[1] = simplex[2];
+		count = 2;
+	} else if (d12_1 <= 0.0f && d23_2 <= 0.0f) {
+		simplex[1].weight = 1.0f;
+		simplex[0] = simplex[1];
+		count = 1;
+	} else if (d13_1 <= 0.0f && d23_1 <= 0.0f) {
+		simplex[2].weight = 1.0f;
+		simplex[0] = simplex[2];
+		count = 1;
+	} else if (d23_1 > 0.0f && d23_2 > 0.0f && d123_1 <= 0.0f) {
+		KEngine2D::Scalar inverse = 1.0f / (d23_1 + d23_2);
+		simplex[1].weight = d23_1 * inverse;
+		simplex[2].weight = d23_2 * inverse;
+		simplex[0] = simplex[2];
+		count = 2;
+	} else {
+		KEngine2D::Scalar inverse = 1.0f / (d123_1 + d123_2 + d123_3);
+		simplex[0].weight = d123_1 * inverse;
+		simplex[1].weight = d123_2 * inverse;
+		simplex[2].weight = d123_3 * inverse;
+		count = 3;
+	}
+}
+
+//Walks the simplex towards the origin of the Minkowski difference until it stops finding new corners
+static KEngine2D::Scalar RunGjk(KEngine2D::ConvexHull const & hull, KEngine2D::ConvexHull const & other, KEngine2D::Point & point, KEngine2D::Point & otherPoint, int & index, int & otherIndex)
+{
+	constexpr int maxIterations = 20;
+	SimplexVertex simplex[3];
+	simplex[0] = MakeSimplexVertex(hull, 0, other, 0);
+	int count = 1;
+	for (int iteration = 0; iteration < maxIterations; iteration++) {
+		int previousCount = count;
+		int previousIndices[3];
+		int previousOtherIndices[3];
+		for (int i = 0; i < count; i++) {
+			previousIndices[i] = simplex[i].index;
+			previousOtherIndices[i] = simplex[i].otherIndex;
+		}
+
+		if (count == 2) {
+			SolveSimplex2(simplex, count);
+		} else if (count == 3) {
+			SolveSimplex3(simplex, count);
+		}
+		if (count == 3) {
+			break; //The origin is inside, so the hulls overlap
+		}
+
+		KEngine2D::Point closest = KEngine2D::Point::Origin();
+		for (int i = 0; i < count; i++) {
+			closest += Scaled(simplex[i].difference, simplex[i].weight);
+		}
+		if (KEngine2D::DotProduct(closest, closest) <= 1e-12f) {
+			break; //Touching
+		}
+
+		//Heading back towards the origin, so as far along -closest on the second hull and along closest on the first
+		SimplexVertex vertex = MakeSimplexVertex(hull, FindSupport(hull, closest), other, FindSupport(other, -closest));
+		bool repeated = false;
+		for (int i = 0; i < previousCount; i++) {
+			repeated = repeated || (vertex.index == previousIndices[i] && vertex.otherIndex == previousOtherIndices[i]);
+		}
+		if (repeated) {
+			break; //No closer corner to be had
+		}
+		simplex[count++] = vertex;
+	}
+
+	point = KEngine2D::Point::Origin();
+	otherPoint = KEngine2D::Point::Origin();
+	for (int i = 0; i < count; i++) {
+		point += Scaled(simplex[i].point, simplex[i].weight);
+		otherPoint += Scaled(simplex[i].otherPoint, simplex[i].weight);
+	}
+	index = simplex[0].index;
+	otherIndex = simplex[0].otherIndex;
+	if (count == 3) {
+		otherPoint = point;
+		return 0.0f;
+	}
+	KEngine2D::Point delta = otherPoint;
+	delta -= point;
+	return sqrt(KEngine2D::DotProduct(delta, delta));
+}
+
+KEngine2D::Scalar KEngine2D::GetHullDistance(ConvexHull const & hull, ConvexHull const & other, Point & point, Point & otherPoint)
+{
+	int index, otherIndex;
+	return RunGjk(hull, other, point, otherPoint, index, otherIndex);
+}
+
+//Same as the box version, for any number of edges
+static KEngine2D::Scalar FindHullSeparation(KEngine2D::ConvexHull const & hull, KEngine2D::ConvexHull const & other, int & edge)
+{
+	KEngine2D::Scalar maxSeparation = -HUGE_VAL;
+	edge = 0;
+	for (int i = 0; i < hull.count; i++) {
+		KEngine2D::Scalar separation = HUGE_VAL;
+		for (int j = 0; j < other.count; j++) {
+			KEngine2D::Point offset = other.vertices[j];
+			offset -= hull.vertices[i];
+			separation = fmin(separation, KEngine2D::DotProduct(hull.normals[i], offset));
+		}
+		if (separation > maxSeparation) {
+			maxSeparation = separation;
+			edge = i;
+		}
+	}
+	return maxSeparation;
+}
+
+//Incident face clipped to the reference face, with each point put halfway between the two rounded surfaces
+static bool ClipHulls(KEngine2D::ConvexHull const & hull, KEngine2D::ConvexHull const & other, KEngine2D::Scalar separation, int edge, KEngine2D::Scalar otherSeparation, int otherEdge, KEngine2D::ContactManifold & manifold)
+{
+	constexpr KEngine2D::Scalar tolerance = 0.0005f;
+	bool flip = otherSeparation > separation + tolerance;
+	KEngine2D::ConvexHull const & reference = flip ? other : hull;
+	KEngine2D::ConvexHull const & incident = flip ? hull : other;
+	int referenceEdge = flip ? otherEdge : edge;
+	KEngine2D::Point referenceNormal = reference.normals[referenceEdge];
+
+	int incidentEdge = 0;
+	KEngine2D::Scalar minDot = HUGE_VAL;
+	for (int i = 0; i < incident.count; i++) {
+		KEngine2D::Scalar dot = KEngine2D::DotProduct(referenceNormal, incident.normals[i]);
+		if (dot < minDot) {
+			minDot = dot;
+			incidentEdge = i;
+		}
+	}
+
+	int incidentNext = (incidentEdge + 1) % incident.count;
+	int referenceNext = (referenceEdge + 1) % reference.count;
+	KEngine2D::Point segment[2] = { incident.vertices[incidentEdge], incident.vertices[incidentNext] };
+	unsigned int ids[2] = { (unsigned int)incidentEdge, (unsigned int)incidentNext };
+	KEngine2D::Point start = reference.vertices[referenceEdge];
+	KEngine2D::Point end = reference.vertices[referenceNext];
+	KEngine2D::Point tangent = end;
+	tangent -= start;
+	tangent /= sqrt(KEngine2D::DotProduct(tangent, tangent));
+	if (!ClipSegment(segment, ids, -tangent, -KEngine2D::DotProduct(tangent, start), KEngine2D::BoundingPolygon::MaxVertices + referenceEdge) ||
+		!ClipSegment(segment, ids, tangent, KEngine2D::DotProduct(tangent, end), KEngine2D::BoundingPolygon::MaxVertices + referenceNext)) {
+		return false;
+	}
+
+	KEngine2D::Scalar totalRadius = reference.radius + incident.radius;
+	KEngine2D::Scalar frontOffset = KEngine2D::DotProduct(referenceNormal, start);
+	manifold.normal = flip ? -referenceNormal : referenceNormal;
+	manifold.pointCount = 0;
+	for (int i = 0; i < 2; i++) {
+		KEngine2D::Scalar pointSeparation = KEngine2D::DotProduct(referenceNormal, segment[i]) - frontOffset;
+		if (pointSeparation <= totalRadius) {
+			KEngine2D::Point point = referenceNormal;
+			point *= (reference.radius - incident.radius - pointSeparation) / 2.0f;
+			point += segment[i];
+			unsigned int featureId = ((flip ? 1 : 0) << 12) | (referenceEdge << 8) | (incidentEdge << 4) | ids[i];
+			manifold.points[manifold.pointCount++] = { point, totalRadius - pointSeparation, featureId, 0.0f };
+		}
+	}
+	return manifold.pointCount > 0;
+}
+
+bool KEngine2D::GetHullManifold(ConvexHull const & hull, ConvexHull const & other, ContactManifold & manifold)
+{
+	constexpr Scalar tolerance = 0.0005f;
+	Scalar totalRadius = hull.radius + other.radius;
+	Point point, otherPoint;
+	int index, otherIndex;
+	Scalar distance = RunGjk(hull, other, point, otherPoint, index, otherIndex);
+	if (distance > totalRadius) {
+		return false;
+	}
+
+	//Faces only give the right answer when a face is what's closest.  When it's two corners, their separations come up
+	//short of the real distance, so the rounded corners are left to the closest points instead.
+	if (hull.count >= 2 && other.count >= 2) {
+		int edge, otherEdge;
+		Scalar separation = FindHullSeparation(hull, other, edge);
+		Scalar otherSeparation = FindHullSeparation(other, hull, otherEdge);
+		if (distance <= tolerance || std::max(separation, otherSeparation) + tolerance >= distance) {
+			return ClipHulls(hull, other, separation, edge, otherSeparation, otherEdge, manifold);
+		}
+	}
+
+	if (distance > tolerance) {
+		manifold.normal = otherPoint;
+		manifold.normal -= point;
+		manifold.normal /= distance;
+		Point contact = manifold.normal;
+		contact *= (hull.radius + distance - other.radius) / 2.0f;
+		contact += point;
+		manifold.pointCount = 1;
+		manifold.points[0] = { contact, totalRadius - distance, (2u << 12) | (index << 4) | otherIndex, 0.0f };
+		return true;
+	}
+
+	//A circle's centre inside the other hull, pushed out through the nearest face
+	bool flip = hull.count < 2;
+	ConvexHull const & faces = flip ? other : hull;
+	ConvexHull const & center = flip ? hull : other;
+	Point faceNormal = { 1.0f, 0.0f }; //Any direction will do for two circles on top of each other
+	Scalar separation = 0.0f;
+	int edge = 0;
+	if (faces.count >= 2) {
+		separation = FindHullSeparation(faces, center, edge);
+		faceNormal = faces.normals[edge];
+	}
+	Point contact = faceNormal;
+	contact *= (faces.radius - center.radius - separation) / 2.0f;
+	contact += center.vertices[0];
+	manifold.normal = flip ? -faceNormal : faceNormal;
+	manifold.pointCount = 1;
+	manifold.points[0] = { contact, totalRadius - separation, (3u << 12) | edge, 0.0f };
+	return true;
+}
+
+KEngine2D::BoundingPolygon::BoundingPolygon()
+{
+	mTransform = nullptr;
+	mCount = 0;
+	mLocalCenter = Point::Origin();
+	mLocalArea = 0.0f;
+	mLocalMomentOfInertia = 0.0f;
+	mLocalInnerRadius = 0.0f;
+	mPose = { Point::Origin(), 1.0f, 1.0f, 0.0f };
+	mPoseVersion = 0;
+	mPoseCached = false;
+}
+
+KEngine2D::BoundingPolygon::~BoundingPolygon()
+{
+	Deinit();
+}
+
+//Everything that doesn't depend on the pose is worked out here, once
+void KEngine2D::BoundingPolygon::Init(Transform * transform, Point const * vertices, int count)
+{
+	assert(transform != nullptr);
+	assert(count >= 3 && count <= MaxVertices);
+	mTransform = transform;
+	mCount = count;
+
+	Scalar twiceArea = 0.0f;
+	for (int i = 0; i < count; i++) {
+		twiceArea += PseudoCrossProduct(vertices[i], vertices[(i + 1) % count]);
+	}
+	for (int i = 0; i < count; i++) {
+		mLocalVertices[i] = vertices[twiceArea < 0.0f ? count - 1 - i : i];
+	}
+	for (int i = 0; i < count; i++) {
+		Point edge = mLocalVertices[(i + 1) % count];
+		edge -= mLocalVertices[i];
+		Scalar length = sqrt(DotProduct(edge, edge));
+		assert(length > 0.0f);
+		mLocalNormals[i] = { edge.y / length, -edge.x / length };
+	}
+
+	//Fanned out into triangles from the first corner
+	Point origin = mLocalVertices[0];
+	Point center = Point::Origin();
+	Scalar area = 0.0f;
+	Scalar momentOfInertia = 0.0f;
+	for (int i = 1; i + 1 < count; i++) {
+		Point e1 = mLocalVertices[i];
+		e1 -= origin;
+		Point e2 = mLocalVertices[i + 1];
+		e2 -= origin;
+		Scalar cross = PseudoCrossProduct(e1, e2);
+		assert(cross >= 0.0f); //Not convex
+		Scalar triangleArea = cross / 2.0f;
+		area += triangleArea;
+		center += Scaled(e1 + e2, triangleArea / 3.0f);
+		Scalar xSquared = (e1.x * e1.x) + (e2.x * e1.x) + (e2.x * e2.x);
+		Scalar ySquared = (e1.y * e1.y) + (e2.y * e1.y) + (e2.y * e2.y);
+		momentOfInertia += (cross / 12.0f) * (xSquared + ySquared);
+	}
+	assert(area > 0.0f);
+	center /= area;
+	mLocalArea = area;
+	mLocalMomentOfInertia = (momentOfInertia / area) - DotProduct(center, center); //Moved from the first corner to the centroid
+	mLocalCenter = center + origin;
+
+	mLocalInnerRadius = HUGE_VAL;
+	for (int i = 0; i < count; i++) {
+		mLocalInnerRadius = fmin(mLocalInnerRadius, DotProduct(mLocalNormals[i], mLocalVertices[i] - mLocalCenter));
+	}
+
+	mPoseCached = false;
+	UpdatePose();
+}
+
+void KEngine2D::BoundingPolygon::Deinit()
+{
+	mTransform = nullptr;
+	mCount = 0;
+	mPoseCached = false;
+}
+
+void KEngine2D::BoundingPolygon::UpdatePose() const
+{
+	assert(mTransform != nullptr);
+	unsigned int version = mTransform->GetVersion();
+	if (mPoseCached && version == mPoseVersion)
+	{
+		return;
+	}
+	mPose = mTransform->GetPose();
+	mPoseVersion = version;
+	mPoseCached = true;
+	mPose.LocalToGlobalBatch(mLocalVertices, mVertices, mCount);
+	for (int i = 0; i < mCount; i++) {
+		mNormals[i] = { (mPose.cosTheta * mLocalNormals[i].x) - (mPose.sinTheta * mLocalNormals[i].y), (mPose.sinTheta * mLocalNormals[i].x) + (mPose.cosTheta * mLocalNormals[i].y) };
+	}
+	mCenter = mPose.LocalToGlobal(mLocalCenter);
+	mBoundingBox = { mVertices[0], mVertices[0] };
+	for (int i = 1; i < mCount; i++) {
+		Merge(mBoundingBox, { mVertices[i], mVertices[i] });
+	}
+}
+
+int KEngine2D::BoundingPolygon::GetVertexCount() const
+{
+	return mCount;
+}
+
+KEngine2D::Point KEngine2D::BoundingPolygon::GetCenter() const
+{
+	assert(mTransform != nullptr);
+	return mCenter;
+}
+
+KEngine2D::Scalar KEngine2D::BoundingPolygon::GetArea() const
+{
+	return mLocalArea * mPose.scale * mPose.scale;
+}
+
+KEngine2D::Scalar KEngine2D::BoundingPolygon::GetAreaMomentOfInertia() const
+{
+	return mLocalMomentOfInertia * mPose.scale * mPose.scale;
+}
+
+KEngine2D::AxisAlignedBoundingBox KEngine2D::BoundingPolygon::GetAxisAlignedBoundingBox() const
+{
+	assert(mTransform != nullptr);
+	return mBoundingBox;
+}
+
+KEngine2D::CollisionInfo KEngine2D::BoundingPolygon::Collides(BoundaryLine const & boundary) const
+{
+	ContactManifold manifold;
+	return GetCollisionInfo(GetManifold(boundary, manifold), manifold, boundary.GetNormal());
+}
+
+bool KEngine2D::BoundingPolygon::GetManifold(BoundaryLine const & boundary, ContactManifold & manifold) const
+{
+	return GetCornersManifold(mVertices, mCount, 0.0f, boundary, manifold);
+}
+
+KEngine2D::ConvexHull KEngine2D::BoundingPolygon::GetConvexHull() const
+{
+	return { mVertices, mNormals, mCount, 0.0f };
+}
+
+//Clips the path against every face pushed out by the radius
+bool KEngine2D::BoundingPolygon::SweepCircle(Point const & start, Point const & end, Scalar radius, Scalar & fraction) const
+{
+	Point delta = end;
+	delta -= start;
+	bool inside = true;
+	Scalar entryFraction = 0.0f;
+	Scalar exitFraction = 1.0f;
+	for (int i = 0; i < mCount; i++) {
+		Point offset = start;
+		offset -= mVertices[i];
+		Scalar distance = DotProduct(mNormals[i], offset) - radius;
+		Scalar approach = DotProduct(mNormals[i], delta);
+		inside = inside && distance <= 0.0f;
+		if (approach == 0.0f) {
+			if (distance > 0.0f) {
+				return false;
+			}
+			continue;
+		}
+		Scalar time = -distance / approach;
+		if (approach < 0.0f) {
+			entryFraction = fmax(entryFraction, time);
+		} else {
+			exitFraction = fmin(exitFraction, time);
+		}
+		if (entryFraction > exitFraction) {
+			return false;
+		}
+	}
+	if (inside) {
+		return false;
+	}
+	fraction = entryFraction;
+	return true;
+}
+
+KEngine2D::Scalar KEngine2D::BoundingPolygon::GetInnerRadius() const
+{
+	return mLocalInnerRadius * mPose.scale;
+}
+
+KEngine2D::BoundingCapsule::BoundingCapsule()
+{
+	mTransform = nullptr;
+	mLength = 0.0f;
+	mRadius = 0.0f;
+	mPose = { Point::Origin(), 1.0f, 1.0f, 0.0f };
+	mPoseVersion = 0;
+	mPoseCached = false;
+}
+
+KEngine2D::BoundingCapsule::~BoundingCapsule()
+{
+	Deinit();
+}
+
+void KEngine2D::BoundingCapsule::Init(Transform * transform, Scalar length, Scalar radius)
+{
+	assert(transform != nullptr);
+	assert(length > 0.0f); //Use a circle for that
+	assert(radius >= 0.0f);
+	mTransform = transform;
+	mLength = length;
+	mRadius = radius;
+	mPoseCached = false;
+	UpdatePose();
+}
+
+void KEngine2D::BoundingCapsule::Deinit()
+{
+	mTransform = nullptr;
+	mLength = 0.0f;
+	mRadius = 0.0f;
+	mPoseCached = false;
+}
+
+//The segment's two sides are its edges, one each way
+void KEngine2D::BoundingCapsule::UpdatePose() const
+{
+	assert(mTransform != nullptr);
+	unsigned int version = mTransform->GetVersion();
+	if (mPoseCached && version == mPoseVersion)
+	{
+		return;
+	}
+	mPose = mTransform->GetPose();
+	mPoseVersion = version;
+	mPoseCached = true;
+	Point ends[2] = { { -mLength / 2.0f, 0.0f }, { mLength / 2.0f, 0.0f } };
+	mPose.LocalToGlobalBatch(ends, mVertices, 2);
+	mNormals[0] = { mPose.sinTheta, -mPose.cosTheta };
+	mNormals[1] = -mNormals[0];
+	Scalar radius = GetRadius();
+	mBoundingBox = { mVertices[0], mVertices[0] };
+	Merge(mBoundingBox, { mVertices[1], mVertices[1] });
+	mBoundingBox.first -= { radius, radius };
+	mBoundingBox.second += { radius, radius };
+}
+
+KEngine2D::Scalar KEngine2D::BoundingCapsule::GetLength() const
+{
+	assert(mTransform != nullptr);
+	return mLength * mPose.scale;
+}
+
+KEngine2D::Scalar KEngine2D::BoundingCapsule::GetRadius() const
+{
+	assert(mTransform != nullptr);
+	return mRadius * mPose.scale;
+}
+
+KEngine2D::Point KEngine2D::BoundingCapsule::GetCenter() const
+{
+	assert(mTransform != nullptr);
+	return mPose.translation;
+}
+
+KEngine2D::Scalar KEngine2D::BoundingCapsule::GetArea() const
+{
+	Scalar radius = GetRadius();
+	return (2.0f * radius * GetLength()) + (M_PI * radius * radius);
+}
+
+//The rectangle, plus the two half discs moved out to the ends, shared out over the whole area
+KEngine2D::Scalar KEngine2D::BoundingCapsule::GetAreaMomentOfInertia() const
+{
+	Scalar radius = GetRadius();
+	Scalar length = GetLength();
+	Scalar area = GetArea();
+	if (area <= 0.0f) {
+		return (length * length) / 12.0f; //Just the segment
+	}
+	Scalar rectangleArea = 2.0f * radius * length;
+	Scalar rectangle = rectangleArea * ((length * length) + (4.0f * radius * radius)) / 12.0f;
+	Scalar ends = (M_PI_2 * pow(radius, 4)) + (M_PI * radius * radius * length * length / 4.0f) + (4.0f * pow(radius, 3) * length / 3.0f);
+	return (rectangle + ends) / area;
+}
+
+KEngine2D::AxisAlignedBoundingBox KEngine2D::BoundingCapsule::GetAxisAlignedBoundingBox() const
+{
+	assert(mTransform != nullptr);
+	return mBoundingBox;
+}
+
+KEngine2D::CollisionInfo KEngine2D::BoundingCapsule::Collides(BoundaryLine const & boundary) const
+{
+	ContactManifold manifold;
+	return GetCollisionInfo(GetManifold(boundary, manifold), manifold, boundary.GetNormal());
+}
+
+bool KEngine2D::BoundingCapsule::GetManifold(BoundaryLine const & boundary, ContactManifold & manifold) const
+{
+	return GetCornersManifold(mVertices, 2, GetRadius(), boundary, manifold);
+}
+
+KEngine2D::ConvexHull KEngine2D::BoundingCapsule::GetConvexHull() const
+{
+	return { mVertices, mNormals, 2, GetRadius() };
+}
+
+//The straight part is a slab test in the capsule's own frame, and the ends are circles
+bool KEngine2D::BoundingCapsule::SweepCircle(Point const & start, Point const & end, Scalar radius, Scalar & fraction) const
+{
+	Scalar minDistance = GetRadius() + radius;
+	Point point, otherPoint;
+	ConvexHull startHull = { &start, nullptr, 1, 0.0f };
+	if (GetHullDistance(GetConvexHull(), startHull, point, otherPoint) <= minDistance) {
+		return false;
+	}
+
+	bool hit = false;
+	Scalar endFraction;
+	for (int i = 0; i < 2; i++) {
+		if (SweepPointToCircle(mVertices[i], minDistance, start, end, endFraction) && (!hit || endFraction < fraction)) {
+			fraction = endFraction;
+			hit = true;
+		}
+	}
+
+	Point axis = { mPose.cosTheta, mPose.sinTheta };
+	Point offset = start;
+	offset -= GetCenter();
+	Point delta = end;
+	delta -= start;
+	Scalar localStart[2] = { DotProduct(offset, axis), DotProduct(offset, mNormals[1]) };
+	Scalar localDelta[2] = { DotProduct(delta, axis), DotProduct(delta, mNormals[1]) };
+	Scalar halfExtents[2] = { GetLength() / 2.0f, minDistance };
+	Scalar entryFraction = 0.0f;
+	Scalar exitFraction = 1.0f;
+	for (int i = 0; i < 2; i++) {
+		if (localDelta[i] == 0.0f) {
+			if (fabs(localStart[i]) > halfExtents[i]) {
+				return hit;
+			}
+			continue;
+		}
+		Scalar entryTime = (-halfExtents[i] - localStart[i]) / localDelta[i];
+		Scalar exitTime = (halfExtents[i] - localStart[i]) / localDelta[i];
+		if (entryTime > exitTime) {
+			std::swap(entryTime, exitTime);
+		}
+		entryFraction = fmax(entryFraction, entryTime);
+		exitFraction = fmin(exitFraction, exitTime);
+		if (entryFraction > exitFraction) {
+			return hit;
+		}
+	}
+	if (!hit || entryFraction < fraction) {
+		fraction = entryFraction;
+	}
+	return true;
+}
+
+KEngine2D::Scalar KEngine2D::BoundingCapsule::GetInnerRadius() const
+{
+	return GetRadius();
+}
+
+KEngine2D::BoundingShape::BoundingShape(BoundingBox const & box)
+{
+	mType = ShapeType::Box;
+	new (&mBox) BoundingBox(box);
+}
+
+KEngine2D::BoundingShape::BoundingShape(BoundingCircle const & circle)
+{
+	mType = ShapeType::Circle;
+	new (&mCircle) BoundingCircle(circle);
+}
+
+KEngine2D::BoundingShape::BoundingShape(BoundingPolygon const & polygon)
+{
+	mType = ShapeType::Polygon;
+	new (&mPolygon) BoundingPolygon(polygon);
+}
+
+KEngine2D::BoundingShape::BoundingShape(BoundingCapsule const & capsule)
+{
+	mType = ShapeType::Capsule;
+	new (&mCapsule) BoundingCapsule(capsule);
+}
+
+KEngine2D::BoundingShape::BoundingShape(BoundingShape const & other)
+{
+	CopyFrom(other);
+}
+
+KEngine2D::BoundingShape & KEngine2D::BoundingShape::operator=(BoundingShape const & other)
+{
+	if (this != &other)
+	{
+		Destroy();
+		CopyFrom(other);
+	}
+	return *this;
+}
+
+KEngine2D::BoundingShape::~BoundingShape()
+{
+	Destroy();
+}
+
+KEngine2D::ShapeType KEngine2D::BoundingShape::GetType() const
+{
+	return mType;
+}
+
+KEngine2D::BoundingBox const & KEngine2D::BoundingShape::GetBox() const
+{
+	assert(mType == ShapeType::Box);
+	return mBox;
+}
+
+KEngine2D::BoundingCircle const & KEngine2D::BoundingShape::GetCircle() const
+{
+	assert(mType == ShapeType::Circle);
+	return mCircle;
+}
+
+KEngine2D::BoundingPolygon const & KEngine2D::BoundingShape::GetPolygon() const
+{
+	assert(mType == ShapeType::Polygon);
+	return mPolygon;
+}
+
+KEngine2D::BoundingCapsule const & KEngine2D::BoundingShape::GetCapsule() const
+{
+	assert(mType == ShapeType::Capsule);
+	return mCapsule;
+}
+
+//Only ever called on storage that doesn't hold a shape, either new or just destroyed
+void KEngine2D::BoundingShape::CopyFrom(BoundingShape const & other)
+{
+	mType = other.mType;
+	switch (mType)
+	{
+	case ShapeType::Box:
+		new (&mBox) BoundingBox(other.mBox);
+		break;
+	case ShapeType::Circle:
+		new (&mCircle) BoundingCircle(other.mCircle);
+		break;
+	case ShapeType::Polygon:
+		new (&mPolygon) BoundingPolygon(other.mPolygon);
+		break;
+	case ShapeType::Capsule:
+		new (&mCapsule) BoundingCapsule(other.mCapsule);
+		break;
+	}
+}
+
+void KEngine2D::BoundingShape::Destroy()
+{
+	switch (mType)
+	{
+	case ShapeType::Box:
+		mBox.~BoundingBox();
+		break;
+	case ShapeType::Circle:
+		mCircle.~BoundingCircle();
+		break;
+	case ShapeType::Polygon:
+		mPolygon.~BoundingPolygon();
+		break;
+	case ShapeType::Capsule:
+		mCapsule.~BoundingCapsule();
+		break;
+	}
+}
+
+KEngine2D::BoundingArea::BoundingArea()
+{
+	mShapeVersion = 0;
+	mTransform = nullptr;
+}
+
 void KEngine2D::BoundingArea::Init(Transform * transform)
 {
 	mTransform = transform;
-	mBoundingBoxes.clear();
-	mBoundingCircles.clear();
+	mShapes.clear();
+	mShapeVersion++;
+}
+
+void KEngine2D::BoundingArea::Deinit()
+{
+	mTransform = nullptr;
+	mShapes.clear();
+	mShapeVersion++;
 }
 
 KEngine2D::Point KEngine2D::BoundingArea::GetCenter() const
@@ -423,89 +1736,244 @@ KEngine2D::Point KEngine2D::BoundingArea::GetCenter() const
 	return mTransform->GetTranslation();
 }
 
+struct UpdatePoseVisitor
+{
+	typedef void Result;
+
+	template <typename Shape>
+	void operator()(Shape const & shape) const { shape.UpdatePose(); }
+};
+
+void KEngine2D::BoundingArea::UpdatePoses() const
+{
+	for (BoundingShape const & shape : mShapes) {
+		shape.Visit(UpdatePoseVisitor());
+	}
+}
+
 void KEngine2D::BoundingArea::AddBoundingBox(const BoundingBox * box)
 {
-	mBoundingBoxes.push_back(box);
+	mShapes.push_back(*box);
+	mShapeVersion++;
 }
 
 void KEngine2D::BoundingArea::AddBoundingCircle(const BoundingCircle * circle)
 {
-	mBoundingCircles.push_back(circle);
+	mShapes.push_back(*circle);
+	mShapeVersion++;
 }
 
-double KEngine2D::BoundingArea::GetAreaMomentOfInertia()
+void KEngine2D::BoundingArea::AddBoundingPolygon(const BoundingPolygon * polygon)
 {
-	double accumulator = 0.0f;
-	for (const BoundingBox * box : mBoundingBoxes) {
-		accumulator += box->GetAreaMomentOfInertia();
-		Point offset = box->GetCenter() - GetCenter();
-		accumulator += DotProduct(offset, offset) * box->GetArea();
-	}
+	mShapes.push_back(*polygon);
+	mShapeVersion++;
+}
+
+void KEngine2D::BoundingArea::AddBoundingCapsule(const BoundingCapsule * capsule)
+{
+	mShapes.push_back(*capsule);
+	mShapeVersion++;
+}
 
+//Each shape's share goes by its area, moved out to its offset from the centre
+struct MomentVisitor
+{
+	typedef void Result;
+	KEngine2D::Point center;
+	KEngine2D::Scalar & accumulator;
+	KEngine2D::Scalar & totalArea;
+
+	template <typename Shape>
+	void operator()(Shape const & shape) const
+	{
+		KEngine2D::Point offset = shape.GetCenter() - center;
+		KEngine2D::Scalar area = shape.GetArea();
+		accumulator += area * (shape.GetAreaMomentOfInertia() + DotProduct(offset, offset));
+		totalArea += area;
+	}
+};
 
-	for (const BoundingCircle * circle : mBoundingCircles) {
-		accumulator += circle->GetAreaMomentOfInertia();
-		Point offset = circle->GetCenter() - GetCenter();
-		accumulator += DotProduct(offset, offset) * circle->GetArea();
+KEngine2D::Scalar KEngine2D::BoundingArea::GetAreaMomentOfInertia() const
+{
+	Scalar accumulator = 0.0f;
+	Scalar totalArea = 0.0f;
+	MomentVisitor visitor = { GetCenter(), accumulator, totalArea };
+	for (BoundingShape const & shape : mShapes) {
+		shape.Visit(visitor);
 	}
-	return accumulator;
+	return totalArea > 0.0f ? accumulator / totalArea : 0.0f;
 }
 
-std::pair<KEngine2D::Point, KEngine2D::Point> KEngine2D::BoundingArea::GetAxisAlignedBoundingBox() const
+struct BoundingBoxVisitor
+{
+	typedef KEngine2D::AxisAlignedBoundingBox Result;
+
+	template <typename Shape>
+	Result operator()(Shape const & shape) const { return shape.GetAxisAlignedBoundingBox(); }
+};
+
+KEngine2D::AxisAlignedBoundingBox KEngine2D::BoundingArea::GetAxisAlignedBoundingBox() const
 {
-	return std::pair<Point, Point>();
+	Point center = GetCenter();
+	AxisAlignedBoundingBox retVal = { center, center }; //Empty areas still get a (degenerate) box so they can be sorted
+	bool first = true;
+	for (BoundingShape const & shape : mShapes) {
+		AxisAlignedBoundingBox box = shape.Visit(BoundingBoxVisitor());
+		if (first) {
+			retVal = box;
+			first = false;
+		} else {
+			Merge(retVal, box);
+		}
+	}
+	return retVal;
 }
 
+//Pairs with a test of their own use it, and everything else goes through the convex hulls
+struct CollidesVisitor
+{
+	typedef KEngine2D::CollisionInfo Result;
+
+	KEngine2D::CollisionInfo operator()(KEngine2D::BoundingBox const & box, KEngine2D::BoundingBox const & other) const { return box.Collides(other); }
+	KEngine2D::CollisionInfo operator()(KEngine2D::BoundingBox const & box, KEngine2D::BoundingCircle const & other) const { return box.Collides(other); }
+	KEngine2D::CollisionInfo operator()(KEngine2D::BoundingCircle const & circle, KEngine2D::BoundingCircle const & other) const { return circle.Collides(other); }
+
+	template <typename Shape, typename OtherShape>
+	KEngine2D::CollisionInfo operator()(Shape const & shape, OtherShape const & other) const
+	{
+		KEngine2D::ContactManifold manifold;
+		return GetCollisionInfo(KEngine2D::GetHullManifold(shape.GetConvexHull(), other.GetConvexHull(), manifold), manifold, manifold.normal);
+	}
+};
+
 //Doesn't get the complete collision manifold, sorry.
 KEngine2D::CollisionInfo KEngine2D::BoundingArea::Collides(const BoundingArea & other) const
 {
-	for (const BoundingBox * box : mBoundingBoxes)
+	for (BoundingShape const & shape : mShapes)
 	{
-		for (const BoundingBox * otherBox : other.mBoundingBoxes)
+		for (BoundingShape const & otherShape : other.mShapes)
 		{
-			CollisionInfo possibleCollision = box->Collides(*otherBox);
+			CollisionInfo possibleCollision = BoundingShape::Visit(CollidesVisitor(), shape, otherShape);
 			if (possibleCollision.collides)
 			{
 				return possibleCollision;
 			}
 		}
+	}
+	return { false, Point::Origin(), Point::Origin() };
+}
+
+//Same as above, but for full manifolds
+struct ManifoldVisitor
+{
+	typedef bool Result;
+	KEngine2D::ContactManifold & manifold;
 
-		for (const BoundingCircle * otherCircle : other.mBoundingCircles)
+	bool operator()(KEngine2D::BoundingBox const & box, KEngine2D::BoundingBox const & other) const { return box.GetManifold(other, manifold); }
+	bool operator()(KEngine2D::BoundingBox const & box, KEngine2D::BoundingCircle const & other) const { return box.GetManifold(other, manifold); }
+	bool operator()(KEngine2D::BoundingCircle const & circle, KEngine2D::BoundingCircle const & other) const { return circle.GetManifold(other, manifold); }
+	bool operator()(KEngine2D::BoundingCircle const & circle, KEngine2D::BoundingBox const & other) const
+	{
+		if (!other.GetManifold(circle, manifold)) {
+			return false;
+		}
+		manifold.normal = -manifold.normal; //Worked out from the box's side
+		return true;
+	}
+
+	template <typename Shape, typename OtherShape>
+	bool operator()(Shape const & shape, OtherShape const & other) const
+	{
+		return KEngine2D::GetHullManifold(shape.GetConvexHull(), other.GetConvexHull(), manifold);
+	}
+};
+
+void KEngine2D::BoundingArea::GetManifolds(BoundingArea const & other, std::vector<ContactManifold> & manifolds) const
+{
+	ContactManifold manifold;
+	ManifoldVisitor visitor = { manifold };
+	for (int i = 0; i < (int)mShapes.size(); i++)
+	{
+		for (int j = 0; j < (int)other.mShapes.size(); j++)
 		{
-			CollisionInfo possibleCollision = box->Collides(*otherCircle);
-			if (possibleCollision.collides)
+			if (BoundingShape::Visit(visitor, mShapes[i], other.mShapes[j]))
 			{
-				return possibleCollision;
+				manifold.shape = i;
+				manifold.otherShape = j;
+				manifolds.push_back(manifold);
 			}
 		}
 	}
+}
+
+struct BoundaryManifoldVisitor
+{
+	typedef bool Result;
+	KEngine2D::BoundaryLine const & boundary;
+	KEngine2D::ContactManifold & manifold;
+
+	template <typename Shape>
+	bool operator()(Shape const & shape) const { return shape.GetManifold(boundary, manifold); }
+};
 
-	
-	for (const BoundingCircle * circle : mBoundingCircles)
+void KEngine2D::BoundingArea::GetManifolds(BoundaryLine const & boundary, std::vector<ContactManifold> & manifolds) const
+{
+	ContactManifold manifold;
+	BoundaryManifoldVisitor visitor = { boundary, manifold };
+	for (int i = 0; i < (int)mShapes.size(); i++)
 	{
-		for (const BoundingCircle * otherCircle : other.mBoundingCircles)
+		if (mShapes[i].Visit(visitor))
 		{
-			CollisionInfo possibleCollision = circle->Collides(*otherCircle);
-			if (possibleCollision.collides) {
-				return possibleCollision;
-			}
+			manifold.shape = i;
+			manifold.otherShape = 0;
+			manifolds.push_back(manifold);
 		}
 	}
-	return { false, Point::Origin(), Point::Origin() };
 }
 
-KEngine2D::CollisionInfo KEngine2D::BoundingArea::Collides(BoundaryLine const & boundary) const
+struct SweepCircleVisitor
+{
+	typedef bool Result;
+	KEngine2D::Point const & start;
+	KEngine2D::Point const & end;
+	KEngine2D::Scalar radius;
+	KEngine2D::Scalar & fraction;
+
+	template <typename Shape>
+	bool operator()(Shape const & shape) const { return shape.SweepCircle(start, end, radius, fraction); }
+};
+
+bool KEngine2D::BoundingArea::SweepCircle(Point const & start, Point const & end, Scalar radius, Scalar & fraction) const
 {
-	for (const BoundingBox * box : mBoundingBoxes)
+	bool hit = false;
+	Scalar shapeFraction;
+	SweepCircleVisitor visitor = { start, end, radius, shapeFraction };
+	for (BoundingShape const & shape : mShapes)
 	{
-		CollisionInfo possibleCollision = box->Collides(boundary);
-		if (possibleCollision.collides) {
-			return possibleCollision;
+		if (shape.Visit(visitor) && (!hit || shapeFraction < fraction))
+		{
+			fraction = shapeFraction;
+			hit = true;
 		}
 	}
-	for (const BoundingCircle * circle : mBoundingCircles)
+	return hit;
+}
+
+struct BoundaryCollidesVisitor
+{
+	typedef KEngine2D::CollisionInfo Result;
+	KEngine2D::BoundaryLine const & boundary;
+
+	template <typename Shape>
+	Result operator()(Shape const & shape) const { return shape.Collides(boundary); }
+};
+
+KEngine2D::CollisionInfo KEngine2D::BoundingArea::Collides(BoundaryLine const & boundary) const
+{
+	BoundaryCollidesVisitor visitor = { boundary };
+	for (BoundingShape const & shape : mShapes)
 	{
-		CollisionInfo possibleCollision = circle->Collides(boundary);
+		CollisionInfo possibleCollision = shape.Visit(visitor);
 		if (possibleCollision.collides) {
 			return possibleCollision;
 		}
@@ -513,12 +1981,12 @@ KEngine2D::CollisionInfo KEngine2D::BoundingArea::Collides(BoundaryLine const &
 	return{ false, Point::Origin(), Point::Origin() };
 }
 
-const std::vector<const KEngine2D::BoundingBox*>& KEngine2D::BoundingArea::GetBoundingBoxes()
+std::vector<KEngine2D::BoundingShape> const & KEngine2D::BoundingArea::GetShapes() const
 {
-	return mBoundingBoxes;
+	return mShapes;
 }
 
-const std::vector<const KEngine2D::BoundingCircle*>& KEngine2D::BoundingArea::GetBoundingCircles()
+unsigned int KEngine2D::BoundingArea::GetShapeVersion() const
 {
-	return mBoundingCircles;
+	return mShapeVersion;
 }
@@ -2,6 +2,7 @@
 #include "Transform2D.h"
 #include <vector>
 #include <tuple>
+#include <type_traits>
 
 namespace KEngine2D
 {
@@ -16,23 +17,70 @@ namespace KEngine2D
 		Point collisionNormal;
 	};
 
+	struct ContactPoint
+	{
+		Point point;
+		Scalar depth;
+		unsigned int featureId; //Which features of the two shapes made this point, stable from frame to frame
+		Scalar normalImpulse;   //Accumulated by the solver, and carried over to warm start the next frame
+	};
+
+	struct ContactManifold
+	{
+		int shape;      //Index into the first area's shapes
+		int otherShape;
+		Point normal;   //Unit length, from the first shape towards the second
+		int pointCount;
+		ContactPoint points[2];
+	};
+
+	typedef std::pair<Point, Point> AxisAlignedBoundingBox; //Minimum corner first, maximum corner second
+
+	bool Overlaps(AxisAlignedBoundingBox const & box, AxisAlignedBoundingBox const & other);
+	bool Contains(AxisAlignedBoundingBox const & box, AxisAlignedBoundingBox const & other);
+	bool Intersects(AxisAlignedBoundingBox const & box, Point const & start, Point const & end);
+	void Merge(AxisAlignedBoundingBox & box, AxisAlignedBoundingBox const & other);
+
+	//Any convex shape, as its corners (the centre of a circle, or the ends of a capsule) rounded off by a radius.  Points
+	//into the shape's cached geometry, so is only good until the shape's pose next changes.
+	struct ConvexHull
+	{
+		Point const * vertices; //Counter-clockwise
+		Point const * normals;  //Outward, edge i runs from vertex i to vertex i + 1.  Null for a single point.
+		int count;
+		Scalar radius;
+	};
+
+	//Distance between the hulls ignoring their radii, found with GJK, along with the closest points.  0 when they overlap.
+	Scalar GetHullDistance(ConvexHull const & hull, ConvexHull const & other, Point & point, Point & otherPoint);
+	//GJK decides whether they touch and handles rounded corners, faces are clipped against each other after a separating
+	//axis test for up to two points.  The normal goes from the first hull to the second.
+	bool GetHullManifold(ConvexHull const & hull, ConvexHull const & other, ContactManifold & manifold);
+
 	class BoundaryLine
 	{
 	public:
 		BoundaryLine();
 		~BoundaryLine();
 
-		void Init(double xCoefficient, double yCoefficient, double constantCoefficient);
+		void Init(Scalar xCoefficient, Scalar yCoefficient, Scalar constantCoefficient);
 		void Deinit();
 
-		double GetSignedDistance(Point const & point) const;
+		Scalar GetSignedDistance(Point const & point) const;
 		Point GetNormal() const;
+
+		//Sweeps a circle from start to end, giving the fraction of the way it gets before touching.  Circles that start out
+		//touching are left to the normal collision tests, and don't count.
+		bool SweepCircle(Point const & start, Point const & end, Scalar radius, Scalar & fraction) const;
 	private:
-		double mXCoefficient;
-		double mYCoefficient;
-		double mConstantCoefficient;
+		Scalar mXCoefficient;
+		Scalar mYCoefficient;
+		Scalar mConstantCoefficient;
 	};
 
+	//Shapes work from a snapshot of their transform's pose rather than the transform itself, so collision tests never make
+	//virtual calls.  The snapshot is taken on Init and by UpdatePose, which the physics system calls once per update.
+	//Anything else derived from the pose is cached along with it, and only redone when the transform's version changes.
 	class BoundingCircle
 	{
 	public:
@@ -40,20 +88,33 @@ namespace KEngine2D
 		BoundingCircle();
 		~BoundingCircle();
 
-		void Init(Transform * transform, double radius);
+		void Init(Transform * transform, Scalar radius);
 		void Deinit();
+		void UpdatePose() const;
 
-		double GetRadius() const;
+		Scalar GetRadius() const;
 		Point GetCenter() const;
-		double GetArea() const;
-		double GetAreaMomentOfInertia() const;
+		Scalar GetArea() const;
+		Scalar GetAreaMomentOfInertia() const;
+		AxisAlignedBoundingBox GetAxisAlignedBoundingBox() const;
 
 		CollisionInfo Collides(BoundingCircle const & other) const;
 		CollisionInfo Collides(BoundaryLine const & boundary) const;
 
+		bool GetManifold(BoundingCircle const & other, ContactManifold & manifold) const;
+		bool GetManifold(BoundaryLine const & boundary, ContactManifold & manifold) const;
+		ConvexHull GetConvexHull() const;
+
+		bool SweepCircle(Point const & start, Point const & end, Scalar radius, Scalar & fraction) const;
+		Scalar GetInnerRadius() const; //Biggest circle about the centre that fits inside, for sweeping
+
 	private:
-		double		mRadius;
+		Scalar		mRadius;
 		Transform *	mTransform;
+		mutable Pose mPose;
+		mutable unsigned int mPoseVersion;
+		mutable bool mPoseCached;
+		mutable AxisAlignedBoundingBox mBoundingBox;
 	};
 
 	class BoundingBox
@@ -62,19 +123,30 @@ namespace KEngine2D
 		BoundingBox();
 		~BoundingBox();
 
-		void Init(Transform * transform, double width, double height);
+		void Init(Transform * transform, Scalar width, Scalar height);
 		void Deinit();
-		double GetWidth() const;
-		double GetHeight() const;
+		void UpdatePose() const;
+		Scalar GetWidth() const;
+		Scalar GetHeight() const;
 		Point GetCenter() const;
-		double GetArea() const;
-		double GetAreaMomentOfInertia() const;
+		Scalar GetArea() const;
+		Scalar GetAreaMomentOfInertia() const;
+		AxisAlignedBoundingBox GetAxisAlignedBoundingBox() const;
 
 		CollisionInfo Collides(BoundingCircle const & other) const;
 		CollisionInfo Collides(BoundaryLine const & boundary) const;
 		CollisionInfo Collides(BoundingBox const & other) const;
 		CollisionInfo Collides(Point const & other) const;
 
+		bool GetManifold(BoundingCircle const & other, ContactManifold & manifold) const;
+		bool GetManifold(BoundingBox const & other, ContactManifold & manifold) const;
+		bool GetManifold(BoundaryLine const & boundary, ContactManifold & manifold) const;
+		ConvexHull GetConvexHull() const;
+
+		//Treats the corners as square rather than rounded, so hits near a corner come a little early
+		bool SweepCircle(Point const & start, Point const & end, Scalar radius, Scalar & fraction) const;
+		Scalar GetInnerRadius() const;
+
 	private:
 		enum Corner {
 			UpperLeft,
@@ -90,35 +162,248 @@ namespace KEngine2D
 			AxisCount
 		};
 		
-		Point GetCorner(Corner corner) const;
-		Point GetAxis(Axis axis) const;
-		bool MayCollide(BoundingBox const & other) const;
+		//Only used to fill in the cache, everything else reads mCorners, mVertices and mNormals
+		void GetCorners(Point corners[CornerCount]) const;
+		static Point GetAxis(Point const corners[CornerCount], Axis axis);
+		static bool MayCollide(Point const corners[CornerCount], Point const otherCorners[CornerCount]);
+
+		//Counter-clockwise corners and outward edge normals, edge i runs from vertex i to vertex i + 1
+		void GetPolygon(Point vertices[CornerCount], Point normals[CornerCount]) const;
+		static Scalar FindMaxSeparation(Point const vertices[CornerCount], Point const normals[CornerCount], Point const otherVertices[CornerCount], int & edge);
+
+		Scalar		mWidth;
+		Scalar		mHeight;
+		Transform *	mTransform;
+		mutable Pose mPose;
+		mutable unsigned int mPoseVersion;
+		mutable bool mPoseCached;
+		mutable Point mXAxis;
+		mutable Point mYAxis;
+		mutable Scalar mHalfWidth;
+		mutable Scalar mHalfHeight;
+		mutable Point mCorners[CornerCount];
+		mutable Point mVertices[CornerCount];
+		mutable Point mNormals[CornerCount];
+		mutable AxisAlignedBoundingBox mBoundingBox;
+	};
+
+	//Convex polygon of up to MaxVertices corners, given in the transform's space.  One of these can stand in for the
+	//handful of boxes it would take to approximate an outline, leaving the narrowphase far fewer pairs to test.
+	class BoundingPolygon
+	{
+	public:
+		static constexpr int MaxVertices = 8;
+
+		BoundingPolygon();
+		~BoundingPolygon();
+
+		//The corners can wind either way, but have to make a convex shape
+		void Init(Transform * transform, Point const * vertices, int count);
+		void Deinit();
+		void UpdatePose() const;
+
+		int GetVertexCount() const;
+		Point GetCenter() const; //The centroid
+		Scalar GetArea() const;
+		Scalar GetAreaMomentOfInertia() const;
+		AxisAlignedBoundingBox GetAxisAlignedBoundingBox() const;
+
+		CollisionInfo Collides(BoundaryLine const & boundary) const;
+		bool GetManifold(BoundaryLine const & boundary, ContactManifold & manifold) const;
+		ConvexHull GetConvexHull() const;
+
+		//Square cornered, like the box
+		bool SweepCircle(Point const & start, Point const & end, Scalar radius, Scalar & fraction) const;
+		Scalar GetInnerRadius() const;
+
+	private:
+		Point		mLocalVertices[MaxVertices]; //Counter-clockwise once Init has sorted out the winding
+		Point		mLocalNormals[MaxVertices];
+		int			mCount;
+		Point		mLocalCenter;
+		Scalar		mLocalArea;
+		Scalar		mLocalMomentOfInertia; //About the centroid, per unit area
+		Scalar		mLocalInnerRadius;
+		Transform *	mTransform;
+		mutable Pose mPose;
+		mutable unsigned int mPoseVersion;
+		mutable bool mPoseCached;
+		mutable Point mVertices[MaxVertices];
+		mutable Point mNormals[MaxVertices];
+		mutable Point mCenter;
+		mutable AxisAlignedBoundingBox mBoundingBox;
+	};
 
-		double		mWidth;
-		double		mHeight;
+	//A segment along the transform's x axis, centred on its origin and rounded off by a radius.  Slides over edges and
+	//rolls where a box would catch, which suits characters and limbs.
+	class BoundingCapsule
+	{
+	public:
+		BoundingCapsule();
+		~BoundingCapsule();
+
+		//The length is between the centres of the two rounded ends
+		void Init(Transform * transform, Scalar length, Scalar radius);
+		void Deinit();
+		void UpdatePose() const;
+
+		Scalar GetLength() const;
+		Scalar GetRadius() const;
+		Point GetCenter() const;
+		Scalar GetArea() const;
+		Scalar GetAreaMomentOfInertia() const;
+		AxisAlignedBoundingBox GetAxisAlignedBoundingBox() const;
+
+		CollisionInfo Collides(BoundaryLine const & boundary) const;
+		bool GetManifold(BoundaryLine const & boundary, ContactManifold & manifold) const;
+		ConvexHull GetConvexHull() const;
+
+		bool SweepCircle(Point const & start, Point const & end, Scalar radius, Scalar & fraction) const;
+		Scalar GetInnerRadius() const;
+
+	private:
+		Scalar		mLength;
+		Scalar		mRadius;
 		Transform *	mTransform;
+		mutable Pose mPose;
+		mutable unsigned int mPoseVersion;
+		mutable bool mPoseCached;
+		mutable Point mVertices[2]; //The two ends
+		mutable Point mNormals[2];
+		mutable AxisAlignedBoundingBox mBoundingBox;
+	};
+
+	enum class ShapeType
+	{
+		Box,
+		Circle,
+		Polygon,
+		Capsule
+	};
+
+	//Any one of the shapes, kept by value and tagged with its type, so an area's shapes all sit together in one array.
+	//Visit hands the visitor the shape as its own type, so code that works the same on every shape only needs writing once.
+	//Visitors are functors with a templated operator() (or one for each shape), and a Result typedef for what it returns.
+	class BoundingShape
+	{
+	public:
+		BoundingShape(BoundingBox const & box);
+		BoundingShape(BoundingCircle const & circle);
+		BoundingShape(BoundingPolygon const & polygon);
+		BoundingShape(BoundingCapsule const & capsule);
+		BoundingShape(BoundingShape const & other);
+		BoundingShape & operator=(BoundingShape const & other);
+		~BoundingShape();
+
+		ShapeType GetType() const;
+		BoundingBox const & GetBox() const;
+		BoundingCircle const & GetCircle() const;
+		BoundingPolygon const & GetPolygon() const;
+		BoundingCapsule const & GetCapsule() const;
+
+		template <typename Visitor>
+		typename std::decay<Visitor>::type::Result Visit(Visitor && visitor) const
+		{
+			switch (mType)
+			{
+			case ShapeType::Circle:
+				return visitor(mCircle);
+			case ShapeType::Polygon:
+				return visitor(mPolygon);
+			case ShapeType::Capsule:
+				return visitor(mCapsule);
+			case ShapeType::Box:
+			default:
+				return visitor(mBox);
+			}
+		}
+
+		//Both shapes as their own types, for tests between pairs of them
+		template <typename Visitor>
+		static typename std::decay<Visitor>::type::Result Visit(Visitor && visitor, BoundingShape const & shape, BoundingShape const & other)
+		{
+			FirstShapeVisitor<typename std::decay<Visitor>::type> first = { visitor, other };
+			return shape.Visit(first);
+		}
+
+	private:
+		//Visit for pairs goes through these, taking the first shape's type and then the second's
+		template <typename Visitor, typename Shape>
+		struct SecondShapeVisitor
+		{
+			typedef typename Visitor::Result Result;
+			Visitor & visitor;
+			Shape const & shape;
+
+			template <typename OtherShape>
+			Result operator()(OtherShape const & other) const { return visitor(shape, other); }
+		};
+
+		template <typename Visitor>
+		struct FirstShapeVisitor
+		{
+			typedef typename Visitor::Result Result;
+			Visitor & visitor;
+			BoundingShape const & other;
+
+			template <typename Shape>
+			Result operator()(Shape const & shape) const
+			{
+				SecondShapeVisitor<Visitor, Shape> second = { visitor, shape };
+				return other.Visit(second);
+			}
+		};
+
+		void CopyFrom(BoundingShape const & other);
+		void Destroy();
+
+		ShapeType mType;
+		union
+		{
+			BoundingBox mBox;
+			BoundingCircle mCircle;
+			BoundingPolygon mPolygon;
+			BoundingCapsule mCapsule;
+		};
 	};
 
 	class BoundingArea
 	{
 	public:
+		BoundingArea();
 		void Init(Transform * transform);
 		void Deinit();
 		Point GetCenter() const;
+		//Shapes are copied in, so don't have to outlive the area.  They keep the transform they were given.
 		void AddBoundingBox(const BoundingBox * box);
 		void AddBoundingCircle(const BoundingCircle * circle);
-		double GetAreaMomentOfInertia();
-		std::pair<Point,Point> GetAxisAlignedBoundingBox() const;
+		void AddBoundingPolygon(const BoundingPolygon * polygon);
+		void AddBoundingCapsule(const BoundingCapsule * capsule);
+		//Snapshots every shape's pose in one pass
+		void UpdatePoses() const;
+		//Polar moment of area about the centre, divided by the area, the same as each shape's.  Times the mass, it's the
+		//moment of inertia.
+		Scalar GetAreaMomentOfInertia() const;
+		AxisAlignedBoundingBox GetAxisAlignedBoundingBox() const;
 
 		CollisionInfo Collides(const BoundingArea &other) const;
 		CollisionInfo Collides(BoundaryLine const & boundary) const;
 
-		const std::vector<const BoundingBox *>& GetBoundingBoxes();
-		const std::vector<const BoundingCircle *>& GetBoundingCircles();
+		//Appends a manifold for every pair of shapes that touch
+		void GetManifolds(BoundingArea const & other, std::vector<ContactManifold> & manifolds) const;
+		//Boundaries only have the one shape, so otherShape is always 0
+		void GetManifolds(BoundaryLine const & boundary, std::vector<ContactManifold> & manifolds) const;
+
+		//Earliest hit over all the shapes
+		bool SweepCircle(Point const & start, Point const & end, Scalar radius, Scalar & fraction) const;
+
+		std::vector<BoundingShape> const & GetShapes() const;
+		//Goes up whenever shapes are added or cleared, for anything that caches values worked out from them
+		unsigned int GetShapeVersion() const;
 
 	private:
-		std::vector<const BoundingBox *> mBoundingBoxes;
-		std::vector<const BoundingCircle *> mBoundingCircles;
+		std::vector<BoundingShape> mShapes;
+		unsigned int mShapeVersion;
 		Transform * mTransform;
 	};
 }
\ No newline at end of file
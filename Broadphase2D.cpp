@@ -0,0 +1,747 @@
+#include "Broadphase2D.h"
+#include <cassert>
+#include <algorithm>
+#include <math.h>
+
+static bool PairPrecedes(KEngine2D::BroadphasePair const & pair, KEngine2D::BroadphasePair const & other)
+{
+	return pair.first < other.first || (pair.first == other.first && pair.second < other.second);
+}
+
+//Needs a definition before C++17, since push_back takes it by reference
+constexpr int KEngine2D::AABBTree::NullNode;
+
+KEngine2D::BruteForce::BruteForce()
+{
+	mProxyCount = 0;
+}
+
+KEngine2D::BruteForce::~BruteForce()
+{
+	Deinit();
+}
+
+void KEngine2D::BruteForce::Init()
+{
+	mProxyCount = 0;
+}
+
+void KEngine2D::BruteForce::Deinit()
+{
+	mProxyCount = 0;
+}
+
+void KEngine2D::BruteForce::AddProxy(int proxy)
+{
+	assert(proxy == mProxyCount);
+	mProxyCount++;
+}
+
+void KEngine2D::BruteForce::RemoveProxy(int proxy)
+{
+	assert(proxy >= 0 && proxy < mProxyCount);
+	mProxyCount--;
+}
+
+void KEngine2D::BruteForce::Reserve(int proxyCount)
+{
+	assert(proxyCount >= 0); //Nothing kept per proxy
+}
+
+void KEngine2D::BruteForce::FindPairs(std::vector<AxisAlignedBoundingBox> const & boxes, std::vector<BroadphasePair> & pairs)
+{
+	assert(boxes.size() == (size_t)mProxyCount);
+	pairs.clear();
+	for (int i = 0; i < mProxyCount; i++) {
+		for (int j = i + 1; j < mProxyCount; j++) {
+			pairs.push_back({ i, j });
+		}
+	}
+}
+
+void KEngine2D::BruteForce::UpdateProxies(std::vector<AxisAlignedBoundingBox> const & boxes)
+{
+	assert(boxes.size() == (size_t)mProxyCount); //Nothing kept per proxy
+}
+
+void KEngine2D::BruteForce::QueryRegion(std::vector<AxisAlignedBoundingBox> const & boxes, AxisAlignedBoundingBox const & region, std::vector<int> & proxies)
+{
+	assert(boxes.size() == (size_t)mProxyCount);
+	proxies.clear();
+	for (int proxy = 0; proxy < mProxyCount; proxy++) {
+		if (Overlaps(boxes[proxy], region)) {
+			proxies.push_back(proxy);
+		}
+	}
+}
+
+KEngine2D::SweepAndPrune::SweepAndPrune()
+{
+	mRemovalsPending = false;
+	mWidestBox = 0.0f;
+}
+
+KEngine2D::SweepAndPrune::~SweepAndPrune()
+{
+	Deinit();
+}
+
+void KEngine2D::SweepAndPrune::Init()
+{
+	mEndpoints.clear();
+	mKeyProxies.clear();
+	mProxyKeys.clear();
+	mRemovalsPending = false;
+	mActiveProxies.clear();
+	mWidestBox = 0.0f;
+}
+
+void KEngine2D::SweepAndPrune::Deinit()
+{
+	mEndpoints.clear();
+	mKeyProxies.clear();
+	mProxyKeys.clear();
+	mRemovalsPending = false;
+	mActiveProxies.clear();
+	mWidestBox = 0.0f;
+}
+
+void KEngine2D::SweepAndPrune::AddProxy(int proxy)
+{
+	assert((size_t)proxy == mProxyKeys.size()); //Proxies are appended
+	int key = (int)mKeyProxies.size();
+	mKeyProxies.push_back(proxy);
+	mProxyKeys.push_back(key);
+	//Placeholder values, the first FindPairs will sort them into place
+	mEndpoints.push_back({ 0.0f, key, true });
+	mEndpoints.push_back({ 0.0f, key, false });
+}
+
+void KEngine2D::SweepAndPrune::RemoveProxy(int proxy)
+{
+	assert(proxy >= 0 && (size_t)proxy < mProxyKeys.size());
+	int last = (int)mProxyKeys.size() - 1;
+	mKeyProxies[mProxyKeys[proxy]] = -1;
+	if (proxy != last) {
+		mProxyKeys[proxy] = mProxyKeys[last];
+		mKeyProxies[mProxyKeys[proxy]] = proxy;
+	}
+	mProxyKeys.pop_back();
+	mRemovalsPending = true;
+}
+
+void KEngine2D::SweepAndPrune::Reserve(int proxyCount)
+{
+	mEndpoints.reserve(proxyCount * 2);
+	mKeyProxies.reserve(proxyCount);
+	mProxyKeys.reserve(proxyCount);
+	mActiveProxies.reserve(proxyCount);
+}
+
+//Keeps the survivors in order, so the list stays sorted, and starts the keys over as the proxies themselves
+void KEngine2D::SweepAndPrune::ApplyRemovals()
+{
+	size_t count = 0;
+	for (Endpoint const & endpoint : mEndpoints) {
+		int proxy = mKeyProxies[endpoint.proxy];
+		if (proxy >= 0) {
+			mEndpoints[count] = endpoint;
+			mEndpoints[count].proxy = proxy;
+			count++;
+		}
+	}
+	mEndpoints.resize(count);
+	mKeyProxies.resize(mProxyKeys.size());
+	for (size_t proxy = 0; proxy < mProxyKeys.size(); proxy++) {
+		mKeyProxies[proxy] = (int)proxy;
+		mProxyKeys[proxy] = (int)proxy;
+	}
+	mRemovalsPending = false;
+}
+
+//Minimums sort ahead of maximums at the same value, so touching boxes still count as overlapping
+bool KEngine2D::SweepAndPrune::Precedes(Endpoint const & endpoint, Endpoint const & other)
+{
+	return endpoint.value < other.value || (endpoint.value == other.value && endpoint.isMin && !other.isMin);
+}
+
+void KEngine2D::SweepAndPrune::UpdateProxies(std::vector<AxisAlignedBoundingBox> const & boxes)
+{
+	assert(boxes.size() == mProxyKeys.size());
+	if (mRemovalsPending) {
+		ApplyRemovals();
+	}
+	mWidestBox = 0.0f;
+	for (Endpoint & endpoint : mEndpoints) {
+		AxisAlignedBoundingBox const & box = boxes[endpoint.proxy];
+		endpoint.value = endpoint.isMin ? box.first.x : box.second.x;
+		mWidestBox = std::max(mWidestBox, box.second.x - box.first.x);
+	}
+
+	//Insertion sort, since objects rarely move far between frames the list is almost sorted already
+	for (size_t i = 1; i < mEndpoints.size(); i++) {
+		Endpoint endpoint = mEndpoints[i];
+		size_t j = i;
+		while (j > 0 && Precedes(endpoint, mEndpoints[j - 1])) {
+			mEndpoints[j] = mEndpoints[j - 1];
+			j--;
+		}
+		mEndpoints[j] = endpoint;
+	}
+}
+
+void KEngine2D::SweepAndPrune::FindPairs(std::vector<AxisAlignedBoundingBox> const & boxes, std::vector<BroadphasePair> & pairs)
+{
+	pairs.clear();
+	UpdateProxies(boxes);
+
+	mActiveProxies.clear();
+	for (Endpoint const & endpoint : mEndpoints) {
+		if (endpoint.isMin) {
+			AxisAlignedBoundingBox const & box = boxes[endpoint.proxy];
+			for (int active : mActiveProxies) {
+				AxisAlignedBoundingBox const & activeBox = boxes[active];
+				if (box.first.y <= activeBox.second.y && activeBox.first.y <= box.second.y) { //Already overlapping in x
+					pairs.push_back({ std::min(endpoint.proxy, active), std::max(endpoint.proxy, active) });
+				}
+			}
+			mActiveProxies.push_back(endpoint.proxy);
+		} else {
+			auto it = std::find(mActiveProxies.begin(), mActiveProxies.end(), endpoint.proxy);
+			assert(it != mActiveProxies.end());
+			*it = mActiveProxies.back();
+			mActiveProxies.pop_back();
+		}
+	}
+
+	std::sort(pairs.begin(), pairs.end(), PairPrecedes);
+}
+
+//Any box overlapping the region starts no further back than the widest box, so only that stretch of the list needs looking at
+void KEngine2D::SweepAndPrune::QueryRegion(std::vector<AxisAlignedBoundingBox> const & boxes, AxisAlignedBoundingBox const & region, std::vector<int> & proxies)
+{
+	assert(boxes.size() == mProxyKeys.size() && !mRemovalsPending);
+	proxies.clear();
+	Scalar firstValue = region.first.x - mWidestBox;
+	auto it = std::lower_bound(mEndpoints.begin(), mEndpoints.end(), firstValue, [](Endpoint const & endpoint, Scalar value) {
+		return endpoint.value < value;
+	});
+	for (; it != mEndpoints.end() && it->value <= region.second.x; ++it) {
+		if (it->isMin && Overlaps(boxes[it->proxy], region)) {
+			proxies.push_back(it->proxy);
+		}
+	}
+}
+
+KEngine2D::SpatialGrid::SpatialGrid()
+{
+	mCellSize = 1.0f;
+	mProxyCount = 0;
+	mBucketMask = 0;
+}
+
+KEngine2D::SpatialGrid::~SpatialGrid()
+{
+	Deinit();
+}
+
+void KEngine2D::SpatialGrid::Init(Scalar cellSize)
+{
+	assert(cellSize > 0.0f);
+	mCellSize = cellSize;
+	mProxyCount = 0;
+	mBucketMask = 0;
+}
+
+void KEngine2D::SpatialGrid::Deinit()
+{
+	mProxyCount = 0;
+	mBucketMask = 0;
+	mEntries.clear();
+	mBucketStarts.clear();
+	mBucketCursors.clear();
+}
+
+void KEngine2D::SpatialGrid::AddProxy(int proxy)
+{
+	assert(proxy == mProxyCount);
+	mProxyCount++;
+}
+
+void KEngine2D::SpatialGrid::RemoveProxy(int proxy)
+{
+	assert(proxy >= 0 && proxy < mProxyCount);
+	mProxyCount--;
+}
+
+void KEngine2D::SpatialGrid::Reserve(int proxyCount)
+{
+	size_t entryCount = (size_t)proxyCount * 4;
+	size_t bucketCount = 16;
+	while (bucketCount < entryCount * 2) {
+		bucketCount <<= 1;
+	}
+	mEntries.reserve(entryCount);
+	mBucketStarts.reserve(bucketCount + 1);
+	mBucketCursors.reserve(bucketCount);
+}
+
+KEngine2D::SpatialGrid::CellRange KEngine2D::SpatialGrid::GetCellRange(AxisAlignedBoundingBox const & box) const
+{
+	return{ (int)floor(box.first.x / mCellSize), (int)floor(box.first.y / mCellSize), (int)floor(box.second.x / mCellSize), (int)floor(box.second.y / mCellSize) };
+}
+
+size_t KEngine2D::SpatialGrid::GetBucket(int cellX, int cellY) const
+{
+	return (((unsigned int)cellX * 73856093u) ^ ((unsigned int)cellY * 19349663u)) & mBucketMask;
+}
+
+void KEngine2D::SpatialGrid::UpdateProxies(std::vector<AxisAlignedBoundingBox> const & boxes)
+{
+	assert(boxes.size() == (size_t)mProxyCount);
+	size_t entryCount = 0;
+	for (AxisAlignedBoundingBox const & box : boxes) {
+		CellRange range = GetCellRange(box);
+		entryCount += (size_t)(range.maxX - range.minX + 1) * (range.maxY - range.minY + 1);
+	}
+
+	//Keep the table at least twice as big as the entry count so buckets stay short
+	size_t bucketCount = 16;
+	while (bucketCount < entryCount * 2) {
+		bucketCount <<= 1;
+	}
+	mBucketMask = bucketCount - 1;
+
+	//Counting sort the entries into their buckets
+	mBucketStarts.assign(bucketCount + 1, 0);
+	for (AxisAlignedBoundingBox const & box : boxes) {
+		CellRange range = GetCellRange(box);
+		for (int x = range.minX; x <= range.maxX; x++) {
+			for (int y = range.minY; y <= range.maxY; y++) {
+				mBucketStarts[GetBucket(x, y) + 1]++;
+			}
+		}
+	}
+	for (size_t i = 1; i <= bucketCount; i++) {
+		mBucketStarts[i] += mBucketStarts[i - 1];
+	}
+	mBucketCursors.assign(mBucketStarts.begin(), mBucketStarts.end() - 1);
+	mEntries.resize(entryCount);
+	for (int proxy = 0; proxy < mProxyCount; proxy++) {
+		CellRange range = GetCellRange(boxes[proxy]);
+		for (int x = range.minX; x <= range.maxX; x++) {
+			for (int y = range.minY; y <= range.maxY; y++) {
+				mEntries[mBucketCursors[GetBucket(x, y)]++] = { proxy, x, y };
+			}
+		}
+	}
+}
+
+void KEngine2D::SpatialGrid::FindPairs(std::vector<AxisAlignedBoundingBox> const & boxes, std::vector<BroadphasePair> & pairs)
+{
+	pairs.clear();
+	UpdateProxies(boxes);
+
+	size_t bucketCount = mBucketMask + 1;
+	for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+		for (size_t i = mBucketStarts[bucket]; i < mBucketStarts[bucket + 1]; i++) {
+			Entry const & entry = mEntries[i];
+			for (size_t j = i + 1; j < mBucketStarts[bucket + 1]; j++) {
+				Entry const & other = mEntries[j];
+				if (entry.cellX != other.cellX || entry.cellY != other.cellY) { //Different cell that hashed to the same bucket
+					continue;
+				}
+				AxisAlignedBoundingBox const & box = boxes[entry.proxy];
+				AxisAlignedBoundingBox const & otherBox = boxes[other.proxy];
+				if (!Overlaps(box, otherBox)) {
+					continue;
+				}
+				//Pairs sharing several cells are only reported from the first cell of their overlap
+				CellRange range = GetCellRange(box);
+				CellRange otherRange = GetCellRange(otherBox);
+				if (entry.cellX != std::max(range.minX, otherRange.minX) || entry.cellY != std::max(range.minY, otherRange.minY)) {
+					continue;
+				}
+				pairs.push_back({ std::min(entry.proxy, other.proxy), std::max(entry.proxy, other.proxy) });
+			}
+		}
+	}
+
+	std::sort(pairs.begin(), pairs.end(), PairPrecedes);
+}
+
+void KEngine2D::SpatialGrid::QueryRegion(std::vector<AxisAlignedBoundingBox> const & boxes, AxisAlignedBoundingBox const & region, std::vector<int> & proxies)
+{
+	assert(boxes.size() == (size_t)mProxyCount);
+	proxies.clear();
+	CellRange range = GetCellRange(region);
+	double cellCount = ((double)range.maxX - range.minX + 1.0) * ((double)range.maxY - range.minY + 1.0);
+	if (cellCount > (double)mEntries.size()) {
+		//Covers more cells than there are entries, so it's quicker to look at everything
+		for (int proxy = 0; proxy < mProxyCount; proxy++) {
+			if (Overlaps(boxes[proxy], region)) {
+				proxies.push_back(proxy);
+			}
+		}
+		return;
+	}
+	for (int x = range.minX; x <= range.maxX; x++) {
+		for (int y = range.minY; y <= range.maxY; y++) {
+			size_t bucket = GetBucket(x, y);
+			for (size_t i = mBucketStarts[bucket]; i < mBucketStarts[bucket + 1]; i++) {
+				Entry const & entry = mEntries[i];
+				if (entry.cellX != x || entry.cellY != y || !Overlaps(boxes[entry.proxy], region)) {
+					continue;
+				}
+				//Same as for pairs, only reported from the first cell the region and the box share
+				CellRange proxyRange = GetCellRange(boxes[entry.proxy]);
+				if (x == std::max(range.minX, proxyRange.minX) && y == std::max(range.minY, proxyRange.minY)) {
+					proxies.push_back(entry.proxy);
+				}
+			}
+		}
+	}
+}
+
+static KEngine2D::Scalar GetPerimeter(KEngine2D::AxisAlignedBoundingBox const & box)
+{
+	return 2.0f * ((box.second.x - box.first.x) + (box.second.y - box.first.y));
+}
+
+static KEngine2D::AxisAlignedBoundingBox GetUnion(KEngine2D::AxisAlignedBoundingBox const & box, KEngine2D::AxisAlignedBoundingBox const & other)
+{
+	KEngine2D::AxisAlignedBoundingBox retVal = box;
+	KEngine2D::Merge(retVal, other);
+	return retVal;
+}
+
+KEngine2D::AABBTree::AABBTree()
+{
+	mMargin = 0.0f;
+	mRoot = NullNode;
+	mFreeList = NullNode;
+}
+
+KEngine2D::AABBTree::~AABBTree()
+{
+	Deinit();
+}
+
+void KEngine2D::AABBTree::Init(Scalar margin)
+{
+	assert(margin >= 0.0f);
+	mMargin = margin;
+	mRoot = NullNode;
+	mFreeList = NullNode;
+	mNodes.clear();
+	mProxyLeaves.clear();
+}
+
+void KEngine2D::AABBTree::Deinit()
+{
+	mRoot = NullNode;
+	mFreeList = NullNode;
+	mNodes.clear();
+	mProxyLeaves.clear();
+	mStack.clear();
+}
+
+void KEngine2D::AABBTree::AddProxy(int proxy)
+{
+	assert((size_t)proxy == mProxyLeaves.size());
+	mProxyLeaves.push_back(NullNode); //The leaf is created once FindPairs knows where the proxy is
+}
+
+void KEngine2D::AABBTree::RemoveProxy(int proxy)
+{
+	assert(proxy >= 0 && (size_t)proxy < mProxyLeaves.size());
+	int leaf = mProxyLeaves[proxy];
+	if (leaf != NullNode) {
+		RemoveLeaf(leaf);
+		FreeNode(leaf);
+	}
+	mProxyLeaves[proxy] = mProxyLeaves.back();
+	mProxyLeaves.pop_back();
+	if ((size_t)proxy < mProxyLeaves.size() && mProxyLeaves[proxy] != NullNode) {
+		mNodes[mProxyLeaves[proxy]].proxy = proxy;
+	}
+}
+
+//A tree of n leaves has n - 1 branches, and a balanced one is never deep enough to outgrow the stack
+void KEngine2D::AABBTree::Reserve(int proxyCount)
+{
+	mNodes.reserve(proxyCount * 2);
+	mProxyLeaves.reserve(proxyCount);
+	mStack.reserve(64);
+}
+
+void KEngine2D::AABBTree::UpdateProxies(std::vector<AxisAlignedBoundingBox> const & boxes)
+{
+	assert(boxes.size() == mProxyLeaves.size());
+	for (size_t proxy = 0; proxy < boxes.size(); proxy++) {
+		AxisAlignedBoundingBox const & box = boxes[proxy];
+		int leaf = mProxyLeaves[proxy];
+		if (leaf != NullNode && Contains(mNodes[leaf].box, box)) {
+			continue; //Still inside its fat box, nothing to do
+		}
+		if (leaf == NullNode) {
+			leaf = AllocateNode();
+			mNodes[leaf].proxy = (int)proxy;
+			mProxyLeaves[proxy] = leaf;
+		} else {
+			RemoveLeaf(leaf);
+		}
+		mNodes[leaf].box = { { box.first.x - mMargin, box.first.y - mMargin }, { box.second.x + mMargin, box.second.y + mMargin } };
+		InsertLeaf(leaf);
+	}
+}
+
+void KEngine2D::AABBTree::FindPairs(std::vector<AxisAlignedBoundingBox> const & boxes, std::vector<BroadphasePair> & pairs)
+{
+	pairs.clear();
+	UpdateProxies(boxes);
+
+	for (size_t proxy = 0; proxy < boxes.size(); proxy++) {
+		AxisAlignedBoundingBox const & box = boxes[proxy];
+		mStack.clear();
+		mStack.push_back(mRoot);
+		while (!mStack.empty()) {
+			int nodeIndex = mStack.back();
+			mStack.pop_back();
+			if (nodeIndex == NullNode) {
+				continue;
+			}
+			Node const & node = mNodes[nodeIndex];
+			if (!Overlaps(node.box, box)) {
+				continue;
+			}
+			if (node.IsLeaf()) {
+				//Each pair is seen from both sides, only keep it from the lower proxy and only if the real boxes touch
+				if ((size_t)node.proxy > proxy && Overlaps(box, boxes[node.proxy])) {
+					pairs.push_back({ (int)proxy, node.proxy });
+				}
+			} else {
+				mStack.push_back(node.children[0]);
+				mStack.push_back(node.children[1]);
+			}
+		}
+	}
+
+	std::sort(pairs.begin(), pairs.end(), PairPrecedes);
+}
+
+void KEngine2D::AABBTree::QueryRegion(AxisAlignedBoundingBox const & region, std::vector<int> & proxies)
+{
+	proxies.clear();
+	mStack.clear();
+	mStack.push_back(mRoot);
+	while (!mStack.empty()) {
+		int nodeIndex = mStack.back();
+		mStack.pop_back();
+		if (nodeIndex == NullNode) {
+			continue;
+		}
+		Node const & node = mNodes[nodeIndex];
+		if (!Overlaps(node.box, region)) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			proxies.push_back(node.proxy);
+		} else {
+			mStack.push_back(node.children[0]);
+			mStack.push_back(node.children[1]);
+		}
+	}
+}
+
+void KEngine2D::AABBTree::QueryRegion(std::vector<AxisAlignedBoundingBox> const & boxes, AxisAlignedBoundingBox const & region, std::vector<int> & proxies)
+{
+	assert(boxes.size() == mProxyLeaves.size());
+	QueryRegion(region, proxies);
+	proxies.erase(std::remove_if(proxies.begin(), proxies.end(), [&boxes, &region](int proxy) {
+		return !Overlaps(boxes[proxy], region);
+	}), proxies.end());
+}
+
+void KEngine2D::AABBTree::QueryRay(Point const & start, Point const & end, std::vector<int> & proxies)
+{
+	proxies.clear();
+	mStack.clear();
+	mStack.push_back(mRoot);
+	while (!mStack.empty()) {
+		int nodeIndex = mStack.back();
+		mStack.pop_back();
+		if (nodeIndex == NullNode) {
+			continue;
+		}
+		Node const & node = mNodes[nodeIndex];
+		if (!Intersects(node.box, start, end)) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			proxies.push_back(node.proxy);
+		} else {
+			mStack.push_back(node.children[0]);
+			mStack.push_back(node.children[1]);
+		}
+	}
+}
+
+int KEngine2D::AABBTree::GetHeight() const
+{
+	return mRoot == NullNode ? 0 : mNodes[mRoot].height;
+}
+
+int KEngine2D::AABBTree::AllocateNode()
+{
+	int node;
+	if (mFreeList != NullNode) {
+		node = mFreeList;
+		mFreeList = mNodes[node].parent;
+	} else {
+		node = (int)mNodes.size();
+		mNodes.push_back(Node());
+	}
+	mNodes[node].parent = NullNode;
+	mNodes[node].children[0] = NullNode;
+	mNodes[node].children[1] = NullNode;
+	mNodes[node].height = 0;
+	mNodes[node].proxy = NullNode;
+	return node;
+}
+
+void KEngine2D::AABBTree::FreeNode(int node)
+{
+	assert(node >= 0 && (size_t)node < mNodes.size());
+	mNodes[node].parent = mFreeList;
+	mNodes[node].height = -1;
+	mFreeList = node;
+}
+
+void KEngine2D::AABBTree::ReplaceChild(int parent, int oldChild, int newChild)
+{
+	if (parent == NullNode) {
+		mRoot = newChild;
+	} else if (mNodes[parent].children[0] == oldChild) {
+		mNodes[parent].children[0] = newChild;
+	} else {
+		assert(mNodes[parent].children[1] == oldChild);
+		mNodes[parent].children[1] = newChild;
+	}
+}
+
+//Recomputes box and height from the children
+void KEngine2D::AABBTree::Refit(int node)
+{
+	Node & refitting = mNodes[node];
+	Node const & child = mNodes[refitting.children[0]];
+	Node const & otherChild = mNodes[refitting.children[1]];
+	refitting.box = GetUnion(child.box, otherChild.box);
+	refitting.height = 1 + std::max(child.height, otherChild.height);
+}
+
+void KEngine2D::AABBTree::InsertLeaf(int leaf)
+{
+	if (mRoot == NullNode) {
+		mRoot = leaf;
+		mNodes[leaf].parent = NullNode;
+		return;
+	}
+
+	//Walk down picking whichever side grows the least, surface area heuristic style
+	AxisAlignedBoundingBox leafBox = mNodes[leaf].box;
+	int sibling = mRoot;
+	while (!mNodes[sibling].IsLeaf()) {
+		Node const & node = mNodes[sibling];
+		Scalar perimeter = GetPerimeter(node.box);
+		Scalar combinedPerimeter = GetPerimeter(GetUnion(node.box, leafBox));
+		Scalar cost = 2.0f * combinedPerimeter; //Cost of making a new parent for this node and the leaf
+		Scalar inheritanceCost = 2.0f * (combinedPerimeter - perimeter); //Minimum cost of pushing the leaf further down
+
+		Scalar childCosts[2];
+		for (int i = 0; i < 2; i++) {
+			Node const & child = mNodes[node.children[i]];
+			Scalar grownPerimeter = GetPerimeter(GetUnion(child.box, leafBox));
+			childCosts[i] = (child.IsLeaf() ? grownPerimeter : grownPerimeter - GetPerimeter(child.box)) + inheritanceCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1]) {
+			break;
+		}
+		sibling = childCosts[0] < childCosts[1] ? node.children[0] : node.children[1];
+	}
+
+	int oldParent = mNodes[sibling].parent;
+	int newParent = AllocateNode();
+	mNodes[newParent].parent = oldParent;
+	mNodes[newParent].children[0] = sibling;
+	mNodes[newParent].children[1] = leaf;
+	mNodes[sibling].parent = newParent;
+	mNodes[leaf].parent = newParent;
+	ReplaceChild(oldParent, sibling, newParent);
+
+	for (int node = newParent; node != NullNode; node = mNodes[node].parent) {
+		node = Balance(node);
+		Refit(node);
+	}
+}
+
+void KEngine2D::AABBTree::RemoveLeaf(int leaf)
+{
+	if (leaf == mRoot) {
+		mRoot = NullNode;
+		return;
+	}
+
+	int parent = mNodes[leaf].parent;
+	int grandParent = mNodes[parent].parent;
+	int sibling = mNodes[parent].children[0] == leaf ? mNodes[parent].children[1] : mNodes[parent].children[0];
+
+	ReplaceChild(grandParent, parent, sibling);
+	mNodes[sibling].parent = grandParent;
+	FreeNode(parent);
+	mNodes[leaf].parent = NullNode;
+
+	for (int node = grandParent; node != NullNode; node = mNodes[node].parent) {
+		node = Balance(node);
+		Refit(node);
+	}
+}
+
+//If one child is more than one level taller than the other, rotate its taller grandchild up.  Returns the node now at this spot.
+int KEngine2D::AABBTree::Balance(int a)
+{
+	if (mNodes[a].IsLeaf() || mNodes[a].height < 2) {
+		return a;
+	}
+
+	int heavySide;
+	int balance = mNodes[mNodes[a].children[1]].height - mNodes[mNodes[a].children[0]].height;
+	if (balance > 1) {
+		heavySide = 1;
+	} else if (balance < -1) {
+		heavySide = 0;
+	} else {
+		return a;
+	}
+
+	int b = mNodes[a].children[heavySide]; //Moves up to a's spot
+	int f = mNodes[b].children[0];
+	int g = mNodes[b].children[1];
+
+	mNodes[b].parent = mNodes[a].parent;
+	ReplaceChild(mNodes[a].parent, a, b);
+	mNodes[a].parent = b;
+
+	//Keep the taller grandchild under b, hand the shorter one to a
+	int taller = mNodes[f].height > mNodes[g].height ? f : g;
+	int shorter = taller == f ? g : f;
+	mNodes[b].children[0] = a;
+	mNodes[b].children[1] = taller;
+	mNodes[a].children[heavySide] = shorter;
+	mNodes[shorter].parent = a;
+
+	Refit(a);
+	Refit(b);
+	return b;
+}
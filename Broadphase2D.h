@@ -0,0 +1,200 @@
+#pragma once
+#include "Boundaries2D.h"
+#include <vector>
+#include <cstddef>
+
+namespace KEngine2D
+{
+	struct BroadphasePair
+	{
+		int first;  //Always the lower proxy index
+		int second;
+	};
+
+	//Proxies are indices into the list of boxes handed to FindPairs.  Removing a proxy moves the last one into its index, the
+	//same way the physics system fills the hole in its own lists.
+	class Broadphase
+	{
+	public:
+		virtual ~Broadphase() {}
+
+		virtual void AddProxy(int proxy) = 0;
+		virtual void RemoveProxy(int proxy) = 0;
+		//Makes room up front, so adding up to this many proxies and finding their pairs doesn't allocate
+		virtual void Reserve(int proxyCount) = 0;
+
+		//Pairs come back sorted by first, then second
+		virtual void FindPairs(std::vector<AxisAlignedBoundingBox> const & boxes, std::vector<BroadphasePair> & pairs) = 0;
+
+		//Catches up with the boxes without finding any pairs, which FindPairs does anyway, so queries can be made before it
+		virtual void UpdateProxies(std::vector<AxisAlignedBoundingBox> const & boxes) = 0;
+		//Proxies whose boxes overlap the region, in no particular order.  Needs the boxes the broadphase was last brought up to date with.
+		virtual void QueryRegion(std::vector<AxisAlignedBoundingBox> const & boxes, AxisAlignedBoundingBox const & region, std::vector<int> & proxies) = 0;
+	};
+
+	enum class BroadphaseType
+	{
+		BruteForce,
+		SweepAndPrune,
+		SpatialGrid,
+		AABBTree
+	};
+
+	//Pairs everything with everything, mostly useful as a reference for the others
+	class BruteForce : public Broadphase
+	{
+	public:
+		BruteForce();
+		~BruteForce();
+
+		void Init();
+		void Deinit();
+
+		virtual void AddProxy(int proxy) override;
+		virtual void RemoveProxy(int proxy) override;
+		virtual void Reserve(int proxyCount) override;
+		virtual void FindPairs(std::vector<AxisAlignedBoundingBox> const & boxes, std::vector<BroadphasePair> & pairs) override;
+		virtual void UpdateProxies(std::vector<AxisAlignedBoundingBox> const & boxes) override;
+		virtual void QueryRegion(std::vector<AxisAlignedBoundingBox> const & boxes, AxisAlignedBoundingBox const & region, std::vector<int> & proxies) override;
+
+	private:
+		int mProxyCount;
+	};
+
+	class SweepAndPrune : public Broadphase
+	{
+	public:
+		SweepAndPrune();
+		~SweepAndPrune();
+
+		void Init();
+		void Deinit();
+
+		virtual void AddProxy(int proxy) override;
+		virtual void RemoveProxy(int proxy) override;
+		virtual void Reserve(int proxyCount) override;
+		virtual void FindPairs(std::vector<AxisAlignedBoundingBox> const & boxes, std::vector<BroadphasePair> & pairs) override;
+		virtual void UpdateProxies(std::vector<AxisAlignedBoundingBox> const & boxes) override;
+		virtual void QueryRegion(std::vector<AxisAlignedBoundingBox> const & boxes, AxisAlignedBoundingBox const & region, std::vector<int> & proxies) override;
+
+	private:
+		struct Endpoint
+		{
+			Scalar value;
+			int proxy;
+			bool isMin;
+		};
+
+		static bool Precedes(Endpoint const & endpoint, Endpoint const & other);
+
+		void ApplyRemovals();
+
+		//Endpoints hold keys rather than proxies, so removing doesn't have to find them.  Until the next FindPairs drops the
+		//removed ones, a key and the proxy it stands for can differ.
+		std::vector<Endpoint> mEndpoints; //Kept sorted along x between frames, so re-sorting is nearly linear
+		std::vector<int> mKeyProxies; //-1 once removed
+		std::vector<int> mProxyKeys;
+		bool mRemovalsPending;
+		std::vector<int> mActiveProxies;
+		Scalar mWidestBox; //Along x, so queries know how far back an overlapping box can start
+	};
+
+	//Hashes every proxy into each fixed size cell it covers.  Works best when the cell size is close to the size of a typical object.
+	class SpatialGrid : public Broadphase
+	{
+	public:
+		SpatialGrid();
+		~SpatialGrid();
+
+		void Init(Scalar cellSize);
+		void Deinit();
+
+		virtual void AddProxy(int proxy) override;
+		virtual void RemoveProxy(int proxy) override;
+		virtual void Reserve(int proxyCount) override;
+		virtual void FindPairs(std::vector<AxisAlignedBoundingBox> const & boxes, std::vector<BroadphasePair> & pairs) override;
+		virtual void UpdateProxies(std::vector<AxisAlignedBoundingBox> const & boxes) override;
+		virtual void QueryRegion(std::vector<AxisAlignedBoundingBox> const & boxes, AxisAlignedBoundingBox const & region, std::vector<int> & proxies) override;
+
+	private:
+		struct Entry
+		{
+			int proxy;
+			int cellX;
+			int cellY;
+		};
+
+		struct CellRange
+		{
+			int minX;
+			int minY;
+			int maxX;
+			int maxY;
+		};
+
+		CellRange GetCellRange(AxisAlignedBoundingBox const & box) const;
+		size_t GetBucket(int cellX, int cellY) const;
+
+		Scalar mCellSize;
+		int mProxyCount;
+		size_t mBucketMask;
+		//Bucket storage only ever grows, so steady state frames don't allocate
+		std::vector<Entry> mEntries; //Reserve assumes most boxes cover no more than 4 cells
+		std::vector<size_t> mBucketStarts;
+		std::vector<size_t> mBucketCursors;
+	};
+
+	//Dynamic bounding volume tree of fattened boxes, one leaf per proxy.  A leaf is only reinserted once its object leaves the fat box,
+	//and the tree is kept balanced with rotations.  Also answers region and ray queries.
+	class AABBTree : public Broadphase
+	{
+	public:
+		AABBTree();
+		~AABBTree();
+
+		void Init(Scalar margin);
+		void Deinit();
+
+		virtual void AddProxy(int proxy) override;
+		virtual void RemoveProxy(int proxy) override;
+		virtual void Reserve(int proxyCount) override;
+		virtual void FindPairs(std::vector<AxisAlignedBoundingBox> const & boxes, std::vector<BroadphasePair> & pairs) override;
+		virtual void UpdateProxies(std::vector<AxisAlignedBoundingBox> const & boxes) override;
+		virtual void QueryRegion(std::vector<AxisAlignedBoundingBox> const & boxes, AxisAlignedBoundingBox const & region, std::vector<int> & proxies) override;
+
+		//Queries test against the fat boxes as of the last FindPairs, so callers should check the results against exact boxes
+		void QueryRegion(AxisAlignedBoundingBox const & region, std::vector<int> & proxies);
+		void QueryRay(Point const & start, Point const & end, std::vector<int> & proxies);
+
+		int GetHeight() const;
+
+	private:
+		static constexpr int NullNode = -1;
+
+		struct Node
+		{
+			AxisAlignedBoundingBox box;
+			int parent;  //Next free node while on the free list
+			int children[2];
+			int height;  //Leaves are 0, free nodes are -1
+			int proxy;
+
+			bool IsLeaf() const { return children[0] == NullNode; }
+		};
+
+		int AllocateNode();
+		void FreeNode(int node);
+		void InsertLeaf(int leaf);
+		void RemoveLeaf(int leaf);
+		void Refit(int node);
+		int Balance(int node);
+		void ReplaceChild(int parent, int oldChild, int newChild);
+
+		Scalar mMargin;
+		int mRoot;
+		int mFreeList;
+		std::vector<Node> mNodes;
+		std::vector<int> mProxyLeaves;
+		std::vector<int> mStack;
+	};
+}
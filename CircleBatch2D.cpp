@@ -0,0 +1,153 @@
+#include "CircleBatch2D.h"
+#include <cassert>
+#include <math.h>
+#if defined(KENGINE2D_CIRCLE_BATCH_AVX2) || defined(KENGINE2D_CIRCLE_BATCH_SSE)
+#include <immintrin.h>
+#endif
+
+KEngine2D::CirclePairBatch::CirclePairBatch()
+{
+
+}
+
+KEngine2D::CirclePairBatch::~CirclePairBatch()
+{
+	Clear();
+}
+
+void KEngine2D::CirclePairBatch::Clear()
+{
+	//Clearing keeps the capacity, so refilling every frame doesn't allocate
+	mX.clear();
+	mY.clear();
+	mRadius.clear();
+	mOtherX.clear();
+	mOtherY.clear();
+	mOtherRadius.clear();
+}
+
+void KEngine2D::CirclePairBatch::Reserve(size_t pairCount)
+{
+	mX.reserve(pairCount);
+	mY.reserve(pairCount);
+	mRadius.reserve(pairCount);
+	mOtherX.reserve(pairCount);
+	mOtherY.reserve(pairCount);
+	mOtherRadius.reserve(pairCount);
+}
+
+void KEngine2D::CirclePairBatch::AddPair(Point const & center, Scalar radius, Point const & otherCenter, Scalar otherRadius)
+{
+	mX.push_back((float)center.x);
+	mY.push_back((float)center.y);
+	mRadius.push_back((float)radius);
+	mOtherX.push_back((float)otherCenter.x);
+	mOtherY.push_back((float)otherCenter.y);
+	mOtherRadius.push_back((float)otherRadius);
+}
+
+void KEngine2D::CirclePairBatch::AddPair(BoundingCircle const & circle, BoundingCircle const & other)
+{
+	AddPair(circle.GetCenter(), circle.GetRadius(), other.GetCenter(), other.GetRadius());
+}
+
+size_t KEngine2D::CirclePairBatch::GetSize() const
+{
+	return mX.size();
+}
+
+void KEngine2D::CirclePairBatch::Collide(std::vector<int> & hitPairs, std::vector<CollisionInfo> & hits) const
+{
+	CollideInto(hitPairs, hits);
+}
+
+void KEngine2D::CirclePairBatch::Collide(std::vector<int> & hitPairs, std::vector<ContactManifold> & hits) const
+{
+	CollideInto(hitPairs, hits);
+}
+
+template <typename Hit>
+void KEngine2D::CirclePairBatch::CollideInto(std::vector<int> & hitPairs, std::vector<Hit> & hits) const
+{
+	hitPairs.clear();
+	hits.clear();
+	size_t count = mX.size();
+	size_t i = 0;
+
+#if defined(KENGINE2D_CIRCLE_BATCH_AVX2)
+	for (; i + 8 <= count; i += 8) {
+		__m256 deltaX = _mm256_sub_ps(_mm256_loadu_ps(&mOtherX[i]), _mm256_loadu_ps(&mX[i]));
+		__m256 deltaY = _mm256_sub_ps(_mm256_loadu_ps(&mOtherY[i]), _mm256_loadu_ps(&mY[i]));
+		__m256 distance2 = _mm256_add_ps(_mm256_mul_ps(deltaX, deltaX), _mm256_mul_ps(deltaY, deltaY));
+		__m256 minDistance = _mm256_add_ps(_mm256_loadu_ps(&mRadius[i]), _mm256_loadu_ps(&mOtherRadius[i]));
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(distance2, _mm256_mul_ps(minDistance, minDistance), _CMP_LE_OQ));
+		for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+			if (mask & 1) {
+				AddHit(i + lane, hitPairs, hits);
+			}
+		}
+	}
+#endif
+
+#if defined(KENGINE2D_CIRCLE_BATCH_SSE)
+	for (; i + 4 <= count; i += 4) {
+		__m128 deltaX = _mm_sub_ps(_mm_loadu_ps(&mOtherX[i]), _mm_loadu_ps(&mX[i]));
+		__m128 deltaY = _mm_sub_ps(_mm_loadu_ps(&mOtherY[i]), _mm_loadu_ps(&mY[i]));
+		__m128 distance2 = _mm_add_ps(_mm_mul_ps(deltaX, deltaX), _mm_mul_ps(deltaY, deltaY));
+		__m128 minDistance = _mm_add_ps(_mm_loadu_ps(&mRadius[i]), _mm_loadu_ps(&mOtherRadius[i]));
+		int mask = _mm_movemask_ps(_mm_cmple_ps(distance2, _mm_mul_ps(minDistance, minDistance)));
+		for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+			if (mask & 1) {
+				AddHit(i + lane, hitPairs, hits);
+			}
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+		float deltaX = mOtherX[i] - mX[i];
+		float deltaY = mOtherY[i] - mY[i];
+		float minDistance = mRadius[i] + mOtherRadius[i];
+		if ((deltaX * deltaX) + (deltaY * deltaY) <= minDistance * minDistance) {
+			AddHit(i, hitPairs, hits);
+		}
+	}
+}
+
+//Same contact point and normal as BoundingCircle::Collides, only worked out for the hits
+void KEngine2D::CirclePairBatch::AddHit(size_t pair, std::vector<int> & hitPairs, std::vector<CollisionInfo> & hits) const
+{
+	CollisionInfo hit;
+	hit.collides = true;
+	hit.collisionNormal = { (Scalar)mOtherX[pair] - mX[pair], (Scalar)mOtherY[pair] - mY[pair] };
+	Scalar minDistance = (Scalar)mRadius[pair] + mOtherRadius[pair];
+	hit.collisionPoint = hit.collisionNormal;
+	if (minDistance > 0.0f) {
+		hit.collisionPoint *= mRadius[pair] / minDistance;
+	}
+	hit.collisionPoint += { (Scalar)mX[pair], (Scalar)mY[pair] };
+	hitPairs.push_back((int)pair);
+	hits.push_back(hit);
+}
+
+void KEngine2D::CirclePairBatch::AddHit(size_t pair, std::vector<int> & hitPairs, std::vector<ContactManifold> & hits) const
+{
+	ContactManifold hit;
+	hit.shape = 0;
+	hit.otherShape = 0;
+	Point delta = { (Scalar)mOtherX[pair] - mX[pair], (Scalar)mOtherY[pair] - mY[pair] };
+	Scalar distance = sqrt(DotProduct(delta, delta));
+	hit.normal = { 1.0f, 0.0f };
+	if (distance > 0.0f) {
+		hit.normal = delta;
+		hit.normal /= distance;
+	}
+	Scalar depth = (Scalar)mRadius[pair] + mOtherRadius[pair] - distance;
+	Point point = hit.normal;
+	point *= mRadius[pair] - (depth / 2.0f);
+	point += { (Scalar)mX[pair], (Scalar)mY[pair] };
+	hit.pointCount = 1;
+	hit.points[0] = { point, depth, 0, 0.0f };
+	hitPairs.push_back((int)pair);
+	hits.push_back(hit);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "Boundaries2D.h"
+#include <vector>
+#include <cstddef>
+
+#if defined(__AVX2__)
+#define KENGINE2D_CIRCLE_BATCH_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KENGINE2D_CIRCLE_BATCH_SSE
+#endif
+
+namespace KEngine2D
+{
+	//Circle pairs laid out as a structure of arrays, so many pairs can be tested at once.
+	//Tests 8 pairs at a time with AVX2, 4 with SSE, and falls back to one at a time everywhere else.
+	class CirclePairBatch
+	{
+	public:
+		CirclePairBatch();
+		~CirclePairBatch();
+
+		void Clear();
+		void Reserve(size_t pairCount);
+		void AddPair(Point const & center, Scalar radius, Point const & otherCenter, Scalar otherRadius);
+		void AddPair(BoundingCircle const & circle, BoundingCircle const & other);
+		size_t GetSize() const;
+
+		//Only colliding pairs are written out, each along with the order it was added in.
+		//The results match BoundingCircle::Collides, from the point of view of the first circle.
+		void Collide(std::vector<int> & hitPairs, std::vector<CollisionInfo> & hits) const;
+		//Same again, with manifolds matching BoundingCircle::GetManifold
+		void Collide(std::vector<int> & hitPairs, std::vector<ContactManifold> & hits) const;
+
+	private:
+		template <typename Hit>
+		void CollideInto(std::vector<int> & hitPairs, std::vector<Hit> & hits) const;
+		void AddHit(size_t pair, std::vector<int> & hitPairs, std::vector<CollisionInfo> & hits) const;
+		void AddHit(size_t pair, std::vector<int> & hitPairs, std::vector<ContactManifold> & hits) const;
+
+		std::vector<float> mX;
+		std::vector<float> mY;
+		std::vector<float> mRadius;
+		std::vector<float> mOtherX;
+		std::vector<float> mOtherY;
+		std::vector<float> mOtherRadius;
+	};
+}
@@ -0,0 +1,193 @@
+#include <cassert>
+#include "FixedTimestep2D.h"
+#include "Physics2D.h"
+
+KEngine2D::FixedTimestep::FixedTimestep()
+{
+	mMechanicsUpdater = nullptr;
+	mPhysicsSystem = nullptr;
+	mStepTime = 1.0f / 60.0f;
+	mMaxStepsPerUpdate = 4;
+	mAccumulator = 0.0f;
+	mDroppedStepCount = 0;
+}
+
+KEngine2D::FixedTimestep::~FixedTimestep()
+{
+	Deinit();
+}
+
+void KEngine2D::FixedTimestep::Init(MechanicsUpdater * mechanicsUpdater, PhysicsSystem * physicsSystem, double stepTime /*= 1.0f / 60.0f*/, int maxStepsPerUpdate /*= 4*/)
+{
+	assert(stepTime > 0.0f);
+	assert(maxStepsPerUpdate >= 1);
+	mMechanicsUpdater = mechanicsUpdater;
+	mPhysicsSystem = physicsSystem;
+	mStepTime = stepTime;
+	mMaxStepsPerUpdate = maxStepsPerUpdate;
+	mAccumulator = 0.0f;
+	mDroppedStepCount = 0;
+}
+
+void KEngine2D::FixedTimestep::Deinit()
+{
+	mMechanicsUpdater = nullptr;
+	mPhysicsSystem = nullptr;
+	mAccumulator = 0.0f;
+}
+
+int KEngine2D::FixedTimestep::Update(double fTime)
+{
+	assert(fTime >= 0.0f);
+	mAccumulator += fTime;
+	int stepCount = 0;
+	while (mAccumulator >= mStepTime && stepCount < mMaxStepsPerUpdate)
+	{
+		if (mMechanicsUpdater != nullptr)
+		{
+			mMechanicsUpdater->Update(mStepTime);
+		}
+		if (mPhysicsSystem != nullptr)
+		{
+			mPhysicsSystem->Update(mStepTime);
+		}
+		mAccumulator -= mStepTime;
+		stepCount++;
+	}
+	if (mAccumulator >= mStepTime)
+	{
+		//Fell behind, so give up on the missing time rather than trying to catch up next frame
+		int droppedSteps = (int)(mAccumulator / mStepTime);
+		mDroppedStepCount += droppedSteps;
+		mAccumulator -= droppedSteps * mStepTime;
+	}
+	return stepCount;
+}
+
+double KEngine2D::FixedTimestep::GetStepTime() const
+{
+	return mStepTime;
+}
+
+double KEngine2D::FixedTimestep::GetInterpolationAlpha() const
+{
+	return mAccumulator / mStepTime;
+}
+
+int KEngine2D::FixedTimestep::GetDroppedStepCount() const
+{
+	return mDroppedStepCount;
+}
+
+KEngine2D::InterpolatedTransform::InterpolatedTransform()
+{
+	mSource = nullptr;
+	mTimestep = nullptr;
+	mInterpolatedTransform = StaticTransform::Identity();
+	mSourceVersion = 0;
+	mAlpha = 0.0f;
+	mVersion = 0;
+}
+
+KEngine2D::InterpolatedTransform::~InterpolatedTransform()
+{
+	Deinit();
+}
+
+void KEngine2D::InterpolatedTransform::Init(MechanicalTransform const * source, FixedTimestep const * timestep)
+{
+	assert(source != nullptr);
+	assert(timestep != nullptr);
+	mSource = source;
+	mTimestep = timestep;
+	mSourceVersion = source->GetVersion();
+	mAlpha = timestep->GetInterpolationAlpha();
+	mInterpolatedTransform = source->GetInterpolatedTransform(mAlpha);
+	mVersion++;
+}
+
+void KEngine2D::InterpolatedTransform::Deinit()
+{
+	mSource = nullptr;
+	mTimestep = nullptr;
+}
+
+void KEngine2D::InterpolatedTransform::Update(double /*fTime*/)
+{
+	assert(mSource != nullptr);
+	double alpha = mTimestep->GetInterpolationAlpha();
+	if (mSource->GetVersion() == mSourceVersion && alpha == mAlpha)
+	{
+		return;
+	}
+	mSourceVersion = mSource->GetVersion();
+	mAlpha = alpha;
+	mInterpolatedTransform = mSource->GetInterpolatedTransform(alpha);
+	mVersion++;
+}
+
+KEngine2D::Point KEngine2D::InterpolatedTransform::GetTranslation() const
+{
+	assert(mSource != nullptr);
+	return mInterpolatedTransform.GetTranslation();
+}
+
+KEngine2D::Scalar KEngine2D::InterpolatedTransform::GetRotation() const
+{
+	assert(mSource != nullptr);
+	return mInterpolatedTransform.GetRotation();
+}
+
+KEngine2D::Scalar KEngine2D::InterpolatedTransform::GetScale() const
+{
+	assert(mSource != nullptr);
+	return mInterpolatedTransform.GetScale();
+}
+
+KEngine2D::Affine KEngine2D::InterpolatedTransform::GetAsAffine() const
+{
+	assert(mSource != nullptr);
+	return mInterpolatedTransform.GetAsAffine();
+}
+
+unsigned int KEngine2D::InterpolatedTransform::GetVersion() const
+{
+	return mVersion;
+}
+
+KEngine2D::Pose KEngine2D::InterpolatedTransform::GetPose() const
+{
+	assert(mSource != nullptr);
+	return mInterpolatedTransform.GetPose();
+}
+
+KEngine2D::Point KEngine2D::InterpolatedTransform::LocalToGlobal(Point const & point, bool asVector) const
+{
+	assert(mSource != nullptr);
+	return mInterpolatedTransform.LocalToGlobal(point, asVector);
+}
+
+KEngine2D::Point KEngine2D::InterpolatedTransform::GlobalToLocal(Point const & point) const
+{
+	assert(mSource != nullptr);
+	return mInterpolatedTransform.GlobalToLocal(point);
+}
+
+void KEngine2D::InterpolatedTransform::LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector) const
+{
+	assert(mSource != nullptr);
+	mInterpolatedTransform.LocalToGlobalBatch(points, results, count, asVector);
+}
+
+void KEngine2D::InterpolatedTransform::GlobalToLocalBatch(Point const * points, Point * results, size_t count) const
+{
+	assert(mSource != nullptr);
+	mInterpolatedTransform.GlobalToLocalBatch(points, results, count);
+}
+
+void KEngine2D::UpdatingInterpolatedTransform::Init(KEngineCore::Updater<InterpolatedTransform> * updater, MechanicalTransform const * source, FixedTimestep const * timestep)
+{
+	KEngineCore::Updating<InterpolatedTransform>::Init(updater);
+	InterpolatedTransform::Init(source, timestep);
+	Start();
+}
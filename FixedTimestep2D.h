@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Transform2D.h"
+#include "StaticTransform2D.h"
+#include "MechanicalTransform2D.h"
+#include "Updater.h"
+
+namespace KEngine2D
+{
+	class PhysicsSystem;
+
+	//Runs mechanics and physics in fixed steps out of an accumulator, however long the frames are.  Whatever time is left over
+	//becomes the interpolation alpha for rendering between the last two steps.
+	class FixedTimestep
+	{
+	public:
+		FixedTimestep();
+		~FixedTimestep();
+
+		//Either can be null to only step the other.  Frames needing more than maxStepsPerUpdate steps drop the extra time,
+		//so a slow frame can't make the next one slower still.
+		void Init(MechanicsUpdater * mechanicsUpdater, PhysicsSystem * physicsSystem, double stepTime = 1.0f / 60.0f, int maxStepsPerUpdate = 4);
+		void Deinit();
+
+		//Returns how many steps were taken
+		int Update(double fTime);
+
+		double GetStepTime() const;
+		double GetInterpolationAlpha() const; //0 at the previous step, 1 at the latest
+		int GetDroppedStepCount() const;      //Steps skipped by the cap since Init
+
+	private:
+		MechanicsUpdater * mMechanicsUpdater;
+		PhysicsSystem * mPhysicsSystem;
+		double mStepTime;
+		int mMaxStepsPerUpdate;
+		double mAccumulator;
+		int mDroppedStepCount;
+	};
+
+	//Follows a mechanical transform, blended between its last two steps for smooth rendering
+	class InterpolatedTransform : public Transform
+	{
+	public:
+		InterpolatedTransform();
+		~InterpolatedTransform();
+		void Init(MechanicalTransform const * source, FixedTimestep const * timestep);
+		void Deinit();
+
+		void Update(double fTime);
+
+		virtual Point GetTranslation() const override;
+		virtual Scalar GetRotation() const override;
+		virtual Scalar GetScale() const override;
+		virtual Affine GetAsAffine() const override;
+		virtual unsigned int GetVersion() const override;
+		virtual Pose GetPose() const override;
+
+		virtual Point LocalToGlobal(Point const & point, bool asVector = false) const override;
+		virtual Point GlobalToLocal(Point const & point) const override;
+		virtual void LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector = false) const override;
+		virtual void GlobalToLocalBatch(Point const * points, Point * results, size_t count) const override;
+
+	private:
+		MechanicalTransform const * mSource;
+		FixedTimestep const * mTimestep;
+		StaticTransform mInterpolatedTransform;
+		unsigned int mSourceVersion; //What the source and alpha were at the last blend, Update skips it if neither moved
+		double mAlpha;
+		unsigned int mVersion;
+	};
+
+	class UpdatingInterpolatedTransform : public KEngineCore::Updating<InterpolatedTransform>
+	{
+	public:
+		void Init(KEngineCore::Updater<InterpolatedTransform> * updater, MechanicalTransform const * source, FixedTimestep const * timestep);
+	};
+
+	//Update after the FixedTimestep each frame
+	class InterpolationUpdater : public KEngineCore::Updater<InterpolatedTransform> {};
+}
@@ -4,6 +4,12 @@
 KEngine2D::HierarchicalTransform::HierarchicalTransform()
 {
 	mParent = nullptr;
+	mHierarchy = nullptr;
+	mHierarchyParent = nullptr;
+	mDepth = -1;
+	mLevelIndex = -1;
+	mParentVersion = 0;
+	mVersion = 0;
 
 	mLocalTransform = StaticTransform::Identity();
 	mGlobalTransform = StaticTransform::Identity();
@@ -19,23 +25,70 @@ void KEngine2D::HierarchicalTransform::Init(Transform * parent, StaticTransform
 	assert(parent != nullptr);
 	mParent = parent;
 	mLocalTransform = localTransform;
-	Update(0.0f); ///Sets up mGlobalTransform
+	UpdateGlobalTransform(*mParent, mParent->GetVersion()); ///Sets up mGlobalTransform
+}
+
+void KEngine2D::HierarchicalTransform::Init(HierarchyUpdater * hierarchy, Transform * parent, StaticTransform const & localTransform /* = StaticTransform::Identity */)
+{
+	assert(hierarchy != nullptr);
+	assert(mHierarchy == nullptr);
+	Init(parent, localTransform);
+	mHierarchy = hierarchy;
+	hierarchy->Insert(this);
 }
 
 void KEngine2D::HierarchicalTransform::Deinit()
 {
+	if (mHierarchy != nullptr)
+	{
+		mHierarchy->Erase(this);
+	}
+	mHierarchy = nullptr;
+	mHierarchyParent = nullptr;
 	mParent = nullptr;
 }
 
 void KEngine2D::HierarchicalTransform::Update( double fTime )
 {
 	assert(mParent != nullptr);
-	Point globalTranslation = mParent->LocalToGlobal(mLocalTransform.GetTranslation());
-	double globalRotation = mParent->GetRotation() + mLocalTransform.GetRotation();
-	double globalScale = mParent->GetScale() * mLocalTransform.GetScale();
-	mGlobalTransform.SetTranslation(globalTranslation);
+	unsigned int parentVersion = mParent->GetVersion();
+	if (parentVersion != mParentVersion)
+	{
+		UpdateGlobalTransform(*mParent, parentVersion);
+	}
+}
+
+//Parents in the same hierarchy are read directly, without going through Transform
+void KEngine2D::HierarchicalTransform::UpdateInHierarchy()
+{
+	assert(mParent != nullptr);
+	unsigned int parentVersion = mHierarchyParent != nullptr ? mHierarchyParent->mVersion : mParent->GetVersion();
+	if (parentVersion == mParentVersion)
+	{
+		return;
+	}
+	if (mHierarchyParent != nullptr)
+	{
+		UpdateGlobalTransform(mHierarchyParent->mGlobalTransform, parentVersion);
+	}
+	else
+	{
+		UpdateGlobalTransform(*mParent, parentVersion);
+	}
+}
+
+template <typename ParentTransform>
+void KEngine2D::HierarchicalTransform::UpdateGlobalTransform(ParentTransform const & parent, unsigned int parentVersion)
+{
+	mParentVersion = parentVersion;
+	Affine globalAffine = parent.GetAsAffine() * mLocalTransform.GetAsAffine();
+	Scalar globalRotation = parent.GetRotation() + mLocalTransform.GetRotation();
+	Scalar globalScale = parent.GetScale() * mLocalTransform.GetScale();
+	mGlobalTransform.SetTranslation({ globalAffine.data[0][2], globalAffine.data[1][2] });
 	mGlobalTransform.SetRotation(globalRotation);
 	mGlobalTransform.SetScale(globalScale);
+	mGlobalTransform.UpdateTrig(); //Children in a hierarchy read it from several threads, so it's never left to be done lazily
+	mVersion++;
 }
 
 KEngine2D::Point KEngine2D::HierarchicalTransform::GetTranslation() const
@@ -44,24 +97,59 @@ KEngine2D::Point KEngine2D::HierarchicalTransform::GetTranslation() const
 	return mGlobalTransform.GetTranslation();
 }
 
-double KEngine2D::HierarchicalTransform::GetRotation() const
+KEngine2D::Scalar KEngine2D::HierarchicalTransform::GetRotation() const
 {
 	assert(mParent != nullptr);
 	return mGlobalTransform.GetRotation();
 }
 
-double KEngine2D::HierarchicalTransform::GetScale() const
+KEngine2D::Scalar KEngine2D::HierarchicalTransform::GetScale() const
 {
 	assert(mParent != nullptr);
 	return mGlobalTransform.GetScale();
 }
 
-const KEngine2D::Matrix& KEngine2D::HierarchicalTransform::GetAsMatrix() const
+KEngine2D::Affine KEngine2D::HierarchicalTransform::GetAsAffine() const
 {
-    assert(mParent != nullptr);
-    return mGlobalTransform.GetAsMatrix();
+	assert(mParent != nullptr);
+	return mGlobalTransform.GetAsAffine();
 }
 
+unsigned int KEngine2D::HierarchicalTransform::GetVersion() const
+{
+	return mVersion;
+}
+
+KEngine2D::Pose KEngine2D::HierarchicalTransform::GetPose() const
+{
+	assert(mParent != nullptr);
+	return mGlobalTransform.GetPose();
+}
+
+KEngine2D::Point KEngine2D::HierarchicalTransform::LocalToGlobal(Point const & point, bool asVector) const
+{
+	assert(mParent != nullptr);
+	return mGlobalTransform.LocalToGlobal(point, asVector);
+}
+
+KEngine2D::Point KEngine2D::HierarchicalTransform::GlobalToLocal(Point const & point) const
+{
+	assert(mParent != nullptr);
+	return mGlobalTransform.GlobalToLocal(point);
+}
+
+void KEngine2D::HierarchicalTransform::LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector) const
+{
+	assert(mParent != nullptr);
+	mGlobalTransform.LocalToGlobalBatch(points, results, count, asVector);
+}
+
+void KEngine2D::HierarchicalTransform::GlobalToLocalBatch(Point const * points, Point * results, size_t count) const
+{
+	assert(mParent != nullptr);
+	mGlobalTransform.GlobalToLocalBatch(points, results, count);
+}
+
 KEngine2D::StaticTransform const & KEngine2D::HierarchicalTransform::GetLocalTransform() const
 {
 	assert(mParent != nullptr);
@@ -72,7 +160,24 @@ void KEngine2D::HierarchicalTransform::SetLocalTransform( StaticTransform const
 {
 	assert(mParent != nullptr);
 	mLocalTransform = localTransform;
-	Update(0.0f);
+	UpdateGlobalTransform(*mParent, mParent->GetVersion());
+}
+
+KEngine2D::Transform const * KEngine2D::HierarchicalTransform::GetParent() const
+{
+	return mParent;
+}
+
+void KEngine2D::HierarchicalTransform::SetParent( Transform * parent )
+{
+	assert(mParent != nullptr);
+	assert(parent != nullptr);
+	mParent = parent;
+	if (mHierarchy != nullptr)
+	{
+		mHierarchy->Reparent(this);
+	}
+	UpdateGlobalTransform(*mParent, mParent->GetVersion());
 }
 
 void KEngine2D::UpdatingHierarchicalTransform::Init( KEngineCore::Updater<HierarchicalTransform> * updater, Transform * parent, StaticTransform const & localTransform /*= StaticTransform::Identity()*/ )
@@ -81,3 +186,181 @@ void KEngine2D::UpdatingHierarchicalTransform::Init( KEngineCore::Updater<Hierar
     HierarchicalTransform::Init(parent, localTransform);
 	Start();
 }
+
+KEngine2D::HierarchyUpdater::HierarchyUpdater()
+{
+
+}
+
+KEngine2D::HierarchyUpdater::~HierarchyUpdater()
+{
+	//Anything still in here goes back to being updated by hand
+	for (std::vector<HierarchicalTransform *> & level : mLevels)
+	{
+		for (HierarchicalTransform * transform : level)
+		{
+			transform->mHierarchy = nullptr;
+			transform->mHierarchyParent = nullptr;
+			transform->mDepth = -1;
+			transform->mLevelIndex = -1;
+		}
+	}
+	mLevels.clear();
+	mWorkerPool.Deinit();
+}
+
+void KEngine2D::HierarchyUpdater::Update(double fTime)
+{
+	for (size_t depth = 0; depth < mLevels.size(); depth++)
+	{
+		std::vector<HierarchicalTransform *> const & level = mLevels[depth];
+		if (depth == 0)
+		{
+			//Parents of the top level are outside the hierarchy, and might not be safe to read from several threads at once
+			for (HierarchicalTransform * transform : level)
+			{
+				transform->UpdateInHierarchy();
+			}
+		}
+		else
+		{
+			mWorkerPool.ParallelFor((int)level.size(), 64, [&level](int index) {
+				level[index]->UpdateInHierarchy();
+			});
+		}
+	}
+	KEngineCore::Updater<HierarchicalTransform>::Update(fTime);
+}
+
+void KEngine2D::HierarchyUpdater::SetThreadCount(int threadCount)
+{
+	assert(threadCount >= 1);
+	mWorkerPool.Deinit();
+	mWorkerPool.Init(threadCount);
+}
+
+int KEngine2D::HierarchyUpdater::GetThreadCount() const
+{
+	return mWorkerPool.GetThreadCount();
+}
+
+int KEngine2D::HierarchyUpdater::GetDepthCount() const
+{
+	return (int)mLevels.size();
+}
+
+size_t KEngine2D::HierarchyUpdater::GetSize() const
+{
+	size_t size = 0;
+	for (std::vector<HierarchicalTransform *> const & level : mLevels)
+	{
+		size += level.size();
+	}
+	return size;
+}
+
+void KEngine2D::HierarchyUpdater::Insert(HierarchicalTransform * transform)
+{
+	assert(transform->mHierarchy == this);
+	transform->mHierarchyParent = FindHierarchyParent(transform->mParent);
+	AddToLevel(transform);
+}
+
+void KEngine2D::HierarchyUpdater::Erase(HierarchicalTransform * transform)
+{
+	assert(transform->mHierarchy == this);
+#ifndef NDEBUG
+	if (transform->mDepth + 1 < (int)mLevels.size())
+	{
+		for (HierarchicalTransform const * child : mLevels[transform->mDepth + 1])
+		{
+			assert(child->mHierarchyParent != transform); //Children have to be deinitialized or reparented first
+		}
+	}
+#endif
+	RemoveFromLevel(transform);
+	TrimLevels();
+}
+
+//Only the moved transform and the levels below it are touched
+void KEngine2D::HierarchyUpdater::Reparent(HierarchicalTransform * transform)
+{
+	assert(transform->mHierarchy == this);
+	HierarchicalTransform const * hierarchyParent = FindHierarchyParent(transform->mParent);
+	int oldDepth = transform->mDepth;
+
+	//Pull out the transform and everything under it, a level at a time so parents come before their children
+	mMoving.clear();
+	RemoveFromLevel(transform);
+	transform->mDepth = MovingDepth;
+	mMoving.push_back(transform);
+	bool foundMoving = true;
+	for (size_t depth = oldDepth + 1; foundMoving && depth < mLevels.size(); depth++)
+	{
+		foundMoving = false;
+		std::vector<HierarchicalTransform *> & level = mLevels[depth];
+		for (int index = (int)level.size() - 1; index >= 0; index--)
+		{
+			HierarchicalTransform * descendant = level[index];
+			if (descendant->mHierarchyParent->mDepth == MovingDepth)
+			{
+				RemoveFromLevel(descendant);
+				descendant->mDepth = MovingDepth;
+				mMoving.push_back(descendant);
+				foundMoving = true;
+			}
+		}
+	}
+	assert(hierarchyParent == nullptr || hierarchyParent->mDepth != MovingDepth); //Can't be parented under itself
+
+	transform->mHierarchyParent = hierarchyParent;
+	for (HierarchicalTransform * moving : mMoving)
+	{
+		AddToLevel(moving);
+	}
+	TrimLevels();
+}
+
+KEngine2D::HierarchicalTransform const * KEngine2D::HierarchyUpdater::FindHierarchyParent(Transform const * parent) const
+{
+	HierarchicalTransform const * hierarchicalParent = dynamic_cast<HierarchicalTransform const *>(parent);
+	if (hierarchicalParent == nullptr || hierarchicalParent->mHierarchy != this)
+	{
+		return nullptr;
+	}
+	assert(hierarchicalParent->mDepth >= 0);
+	return hierarchicalParent;
+}
+
+void KEngine2D::HierarchyUpdater::AddToLevel(HierarchicalTransform * transform)
+{
+	int depth = transform->mHierarchyParent != nullptr ? transform->mHierarchyParent->mDepth + 1 : 0;
+	if ((int)mLevels.size() <= depth)
+	{
+		mLevels.resize(depth + 1);
+	}
+	transform->mDepth = depth;
+	transform->mLevelIndex = (int)mLevels[depth].size();
+	mLevels[depth].push_back(transform);
+}
+
+//Swaps the last transform on the level into the hole
+void KEngine2D::HierarchyUpdater::RemoveFromLevel(HierarchicalTransform * transform)
+{
+	std::vector<HierarchicalTransform *> & level = mLevels[transform->mDepth];
+	assert(level[transform->mLevelIndex] == transform);
+	HierarchicalTransform * last = level.back();
+	level[transform->mLevelIndex] = last;
+	last->mLevelIndex = transform->mLevelIndex;
+	level.pop_back();
+	transform->mDepth = -1;
+	transform->mLevelIndex = -1;
+}
+
+void KEngine2D::HierarchyUpdater::TrimLevels()
+{
+	while (!mLevels.empty() && mLevels.back().empty())
+	{
+		mLevels.pop_back();
+	}
+}
@@ -2,30 +2,58 @@
 
 #include "Transform2D.h"
 #include "StaticTransform2D.h"
+#include "WorkerPool2D.h"
 #include "Updater.h"
+#include <vector>
 
 namespace KEngine2D
 {
+	class HierarchyUpdater;
+
 	class HierarchicalTransform : public Transform
 	{
 	public:
 		HierarchicalTransform();
 		~HierarchicalTransform();
 		void Init(Transform * parent, StaticTransform const & localTransform = StaticTransform::Identity());
+		//Joins the hierarchy's flattened levels instead, so it's always updated after its parent.  Parents have to be initialized first.
+		void Init(HierarchyUpdater * hierarchy, Transform * parent, StaticTransform const & localTransform = StaticTransform::Identity());
 		void Deinit();
 
 		void Update(double fTime);
 
 		virtual Point GetTranslation() const override;
-		virtual double GetRotation() const override;
-		virtual double GetScale() const override;
-        virtual const Matrix& GetAsMatrix() const override;
+		virtual Scalar GetRotation() const override;
+		virtual Scalar GetScale() const override;
+		virtual Affine GetAsAffine() const override;
+		virtual unsigned int GetVersion() const override;
+		virtual Pose GetPose() const override;
+
+		virtual Point LocalToGlobal(Point const & point, bool asVector = false) const override;
+		virtual Point GlobalToLocal(Point const & point) const override;
+		virtual void LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector = false) const override;
+		virtual void GlobalToLocalBatch(Point const * points, Point * results, size_t count) const override;
 
 		StaticTransform const & GetLocalTransform() const;
 		void SetLocalTransform(StaticTransform const & localTransform);
 
+		//Children in a hierarchy move levels along with it
+		Transform const * GetParent() const;
+		void SetParent(Transform * parent);
+
 	private:
+		friend class HierarchyUpdater;
+		void UpdateInHierarchy();
+		template <typename ParentTransform>
+		void UpdateGlobalTransform(ParentTransform const & parent, unsigned int parentVersion);
+
 		Transform const * mParent;
+		HierarchyUpdater * mHierarchy;
+		HierarchicalTransform const * mHierarchyParent; //Same as mParent when the parent is in the same hierarchy, otherwise null
+		int mDepth;
+		int mLevelIndex;
+		unsigned int mParentVersion; //Update does nothing until the parent's version moves on from this
+		unsigned int mVersion;
 		StaticTransform mLocalTransform;
 		StaticTransform mGlobalTransform;
 	};
@@ -37,5 +65,37 @@ namespace KEngine2D
 		void Init(KEngineCore::Updater<HierarchicalTransform> * updater, Transform * parent, StaticTransform const & localTransform = StaticTransform::Identity());
 	};
 
-	class HierarchyUpdater : public KEngineCore::Updater<HierarchicalTransform> {};
+	//Transforms initialized with a HierarchyUpdater are kept in flat arrays, one per depth, and updated a level at a time
+	//so parents always go before their children.  Each level is split across the worker threads.  Transforms added as
+	//usual are updated one at a time afterwards, in whatever order they were added.
+	class HierarchyUpdater : public KEngineCore::Updater<HierarchicalTransform>
+	{
+	public:
+		HierarchyUpdater();
+		~HierarchyUpdater();
+
+		void Update(double fTime);
+
+		void SetThreadCount(int threadCount);
+		int GetThreadCount() const;
+
+		int GetDepthCount() const;
+		size_t GetSize() const;
+
+	private:
+		friend class HierarchicalTransform;
+		static constexpr int MovingDepth = -2;
+
+		void Insert(HierarchicalTransform * transform);
+		void Erase(HierarchicalTransform * transform);
+		void Reparent(HierarchicalTransform * transform);
+		HierarchicalTransform const * FindHierarchyParent(Transform const * parent) const;
+		void AddToLevel(HierarchicalTransform * transform);
+		void RemoveFromLevel(HierarchicalTransform * transform);
+		void TrimLevels();
+
+		std::vector<std::vector<HierarchicalTransform *>> mLevels;
+		std::vector<HierarchicalTransform *> mMoving;
+		WorkerPool mWorkerPool;
+	};
 }
@@ -0,0 +1,357 @@
+#include <cassert>
+#include <cmath>
+#include "KeyframedTransform2D.h"
+
+KEngine2D::KeyframedTransform::KeyframedTransform()
+{
+	mUpdater = nullptr;
+	mIndex = -1;
+	mCurrentTransform = StaticTransform::Identity();
+	mVersion = 0;
+}
+
+KEngine2D::KeyframedTransform::~KeyframedTransform()
+{
+	Deinit();
+}
+
+void KEngine2D::KeyframedTransform::Init(KeyframeUpdater * updater, StaticTransform const & restTransform /*= StaticTransform::Identity()*/)
+{
+	assert(updater != nullptr);
+	assert(mUpdater == nullptr);
+	mUpdater = updater;
+	mCurrentTransform = restTransform;
+	mVersion++;
+	mIndex = updater->Add(this);
+}
+
+void KEngine2D::KeyframedTransform::Deinit()
+{
+	if (mUpdater != nullptr)
+	{
+		mUpdater->Remove(mIndex);
+	}
+	mUpdater = nullptr;
+	mIndex = -1;
+	mVersion++;
+	mCurrentTransform = StaticTransform::Identity();
+}
+
+void KEngine2D::KeyframedTransform::AddKeyframe(Channel channel, double time, Scalar value, KeyframeInterpolation interpolation /*= KeyframeInterpolation::Linear*/)
+{
+	assert(mUpdater != nullptr);
+	assert(channel >= 0 && channel < ChannelCount);
+	mUpdater->AddKeyframe(mIndex, channel, { time, value, interpolation });
+}
+
+void KEngine2D::KeyframedTransform::ClearKeyframes()
+{
+	assert(mUpdater != nullptr);
+	mUpdater->ClearKeyframes(mIndex);
+}
+
+void KEngine2D::KeyframedTransform::Play(bool looping /*= false*/)
+{
+	assert(mUpdater != nullptr);
+	mUpdater->mPlaying[mIndex] = 1;
+	mUpdater->mLooping[mIndex] = looping ? 1 : 0;
+}
+
+void KEngine2D::KeyframedTransform::Stop()
+{
+	assert(mUpdater != nullptr);
+	mUpdater->mPlaying[mIndex] = 0;
+}
+
+bool KEngine2D::KeyframedTransform::IsPlaying() const
+{
+	assert(mUpdater != nullptr);
+	return mUpdater->mPlaying[mIndex] != 0;
+}
+
+//Jumps straight there, playing or not
+void KEngine2D::KeyframedTransform::SetTime(double time)
+{
+	assert(mUpdater != nullptr);
+	mUpdater->mTimes[mIndex] = time;
+	mUpdater->Evaluate(mIndex);
+}
+
+double KEngine2D::KeyframedTransform::GetTime() const
+{
+	assert(mUpdater != nullptr);
+	return mUpdater->mTimes[mIndex];
+}
+
+double KEngine2D::KeyframedTransform::GetDuration() const
+{
+	assert(mUpdater != nullptr);
+	return mUpdater->mDurations[mIndex];
+}
+
+KEngine2D::Point KEngine2D::KeyframedTransform::GetTranslation() const
+{
+	return mCurrentTransform.GetTranslation();
+}
+
+KEngine2D::Scalar KEngine2D::KeyframedTransform::GetRotation() const
+{
+	return mCurrentTransform.GetRotation();
+}
+
+KEngine2D::Scalar KEngine2D::KeyframedTransform::GetScale() const
+{
+	return mCurrentTransform.GetScale();
+}
+
+KEngine2D::Affine KEngine2D::KeyframedTransform::GetAsAffine() const
+{
+	return mCurrentTransform.GetAsAffine();
+}
+
+unsigned int KEngine2D::KeyframedTransform::GetVersion() const
+{
+	return mVersion;
+}
+
+KEngine2D::Pose KEngine2D::KeyframedTransform::GetPose() const
+{
+	return mCurrentTransform.GetPose();
+}
+
+KEngine2D::Point KEngine2D::KeyframedTransform::LocalToGlobal(Point const & point, bool asVector) const
+{
+	return mCurrentTransform.LocalToGlobal(point, asVector);
+}
+
+KEngine2D::Point KEngine2D::KeyframedTransform::GlobalToLocal(Point const & point) const
+{
+	return mCurrentTransform.GlobalToLocal(point);
+}
+
+void KEngine2D::KeyframedTransform::LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector) const
+{
+	mCurrentTransform.LocalToGlobalBatch(points, results, count, asVector);
+}
+
+void KEngine2D::KeyframedTransform::GlobalToLocalBatch(Point const * points, Point * results, size_t count) const
+{
+	mCurrentTransform.GlobalToLocalBatch(points, results, count);
+}
+
+//Only counts as a change if something actually moved, so a held pose doesn't make children recompute
+void KEngine2D::KeyframedTransform::SetCurrentValues(Point const & translation, Scalar rotation, Scalar scale)
+{
+	unsigned int version = mCurrentTransform.GetVersion();
+	mCurrentTransform.SetTranslation(translation);
+	mCurrentTransform.SetRotation(rotation);
+	mCurrentTransform.SetScale(scale);
+	if (mCurrentTransform.GetVersion() != version)
+	{
+		mVersion++;
+	}
+}
+
+KEngine2D::KeyframeUpdater::KeyframeUpdater()
+{
+
+}
+
+KEngine2D::KeyframeUpdater::~KeyframeUpdater()
+{
+	while (!mOwners.empty())
+	{
+		mOwners.back()->Deinit();
+	}
+}
+
+void KEngine2D::KeyframeUpdater::Update(double fTime)
+{
+	for (size_t index = 0; index < mOwners.size(); index++)
+	{
+		if (!mPlaying[index])
+		{
+			continue;
+		}
+		double time = mTimes[index] + fTime;
+		double duration = mDurations[index];
+		if (time >= duration)
+		{
+			if (mLooping[index] && duration > 0.0f)
+			{
+				time = std::fmod(time, duration);
+			}
+			else
+			{
+				time = duration;
+				mPlaying[index] = 0;
+			}
+		}
+		mTimes[index] = time;
+		Evaluate((int)index);
+	}
+}
+
+size_t KEngine2D::KeyframeUpdater::GetSize() const
+{
+	return mOwners.size();
+}
+
+int KEngine2D::KeyframeUpdater::Add(KeyframedTransform * owner)
+{
+	assert(owner != nullptr);
+	mOwners.push_back(owner);
+	mTimes.push_back(0.0f);
+	mDurations.push_back(0.0f);
+	mPlaying.push_back(0);
+	mLooping.push_back(0);
+	for (int channel = 0; channel < KeyframedTransform::ChannelCount; channel++)
+	{
+		mChannels.push_back({ (int)mKeyframes.size(), 0, 0 });
+	}
+	return (int)mOwners.size() - 1;
+}
+
+void KEngine2D::KeyframeUpdater::Remove(int index)
+{
+	assert(index >= 0 && index < (int)mOwners.size());
+	ClearKeyframes(index);
+	int last = (int)mOwners.size() - 1;
+	if (index != last)
+	{
+		mOwners[index] = mOwners[last];
+		mTimes[index] = mTimes[last];
+		mDurations[index] = mDurations[last];
+		mPlaying[index] = mPlaying[last];
+		mLooping[index] = mLooping[last];
+		for (int channel = 0; channel < KeyframedTransform::ChannelCount; channel++)
+		{
+			mChannels[(index * KeyframedTransform::ChannelCount) + channel] = mChannels[(last * KeyframedTransform::ChannelCount) + channel];
+		}
+		mOwners[index]->mIndex = index;
+	}
+	mOwners.pop_back();
+	mTimes.pop_back();
+	mDurations.pop_back();
+	mPlaying.pop_back();
+	mLooping.pop_back();
+	mChannels.resize(mOwners.size() * KeyframedTransform::ChannelCount);
+}
+
+//Keys go at the end of their channel's range, and every range stored after it moves along by one
+void KEngine2D::KeyframeUpdater::AddKeyframe(int index, KeyframedTransform::Channel channel, Keyframe const & keyframe)
+{
+	ChannelRange & range = mChannels[(index * KeyframedTransform::ChannelCount) + channel];
+	assert(range.count == 0 || mKeyframes[range.start + range.count - 1].time <= keyframe.time);
+	int position = range.start + range.count;
+	mKeyframes.insert(mKeyframes.begin() + position, keyframe);
+	for (ChannelRange & other : mChannels)
+	{
+		if (other.start >= position && &other != &range)
+		{
+			other.start++;
+		}
+	}
+	range.count++;
+	mDurations[index] = std::fmax(mDurations[index], keyframe.time);
+}
+
+void KEngine2D::KeyframeUpdater::ClearKeyframes(int index)
+{
+	for (int channel = 0; channel < KeyframedTransform::ChannelCount; channel++)
+	{
+		ChannelRange & range = mChannels[(index * KeyframedTransform::ChannelCount) + channel];
+		if (range.count == 0)
+		{
+			continue;
+		}
+		int start = range.start;
+		int count = range.count;
+		mKeyframes.erase(mKeyframes.begin() + start, mKeyframes.begin() + start + count);
+		range.count = 0;
+		range.cursor = 0;
+		for (ChannelRange & other : mChannels)
+		{
+			if (other.start > start)
+			{
+				other.start -= count;
+			}
+		}
+	}
+	mDurations[index] = 0.0f;
+}
+
+void KEngine2D::KeyframeUpdater::Evaluate(int index)
+{
+	KeyframedTransform * owner = mOwners[index];
+	double time = mTimes[index];
+	ChannelRange * ranges = &mChannels[index * KeyframedTransform::ChannelCount];
+	Point translation = owner->mCurrentTransform.GetTranslation();
+	Scalar rotation = owner->mCurrentTransform.GetRotation();
+	Scalar scale = owner->mCurrentTransform.GetScale();
+	if (ranges[KeyframedTransform::TranslationX].count > 0)
+	{
+		translation.x = EvaluateChannel(ranges[KeyframedTransform::TranslationX], time);
+	}
+	if (ranges[KeyframedTransform::TranslationY].count > 0)
+	{
+		translation.y = EvaluateChannel(ranges[KeyframedTransform::TranslationY], time);
+	}
+	if (ranges[KeyframedTransform::Rotation].count > 0)
+	{
+		rotation = EvaluateChannel(ranges[KeyframedTransform::Rotation], time);
+	}
+	if (ranges[KeyframedTransform::Scale].count > 0)
+	{
+		scale = EvaluateChannel(ranges[KeyframedTransform::Scale], time);
+	}
+	owner->SetCurrentValues(translation, rotation, scale);
+}
+
+KEngine2D::Scalar KEngine2D::KeyframeUpdater::EvaluateChannel(ChannelRange & range, double time) const
+{
+	Keyframe const * keys = &mKeyframes[range.start];
+	int last = range.count - 1;
+	if (time <= keys[0].time)
+	{
+		range.cursor = 0;
+		return keys[0].value;
+	}
+	if (time >= keys[last].time)
+	{
+		range.cursor = last;
+		return keys[last].value;
+	}
+
+	//Carries on from the last segment, only going back to the start after a loop or a jump backwards
+	int key = range.cursor < last && keys[range.cursor].time <= time ? range.cursor : 0;
+	while (keys[key + 1].time <= time)
+	{
+		key++;
+	}
+	range.cursor = key;
+
+	Keyframe const & from = keys[key];
+	Keyframe const & to = keys[key + 1];
+	Scalar t = (Scalar)((time - from.time) / (to.time - from.time));
+	switch (from.interpolation)
+	{
+	case KeyframeInterpolation::Step:
+		return from.value;
+	case KeyframeInterpolation::Linear:
+		return from.value + ((to.value - from.value) * t);
+	case KeyframeInterpolation::Cubic:
+	{
+		//Slopes through the neighbouring keys, scaled to this segment's length, so uneven key spacing doesn't kink the curve
+		Keyframe const & before = keys[key > 0 ? key - 1 : key];
+		Keyframe const & after = keys[key + 1 < last ? key + 2 : key + 1];
+		Scalar segmentLength = (Scalar)(to.time - from.time);
+		Scalar fromTangent = ((to.value - before.value) / (Scalar)(to.time - before.time)) * segmentLength;
+		Scalar toTangent = ((after.value - from.value) / (Scalar)(after.time - from.time)) * segmentLength;
+		Scalar t2 = t * t;
+		Scalar t3 = t2 * t;
+		return (((2.0f * t3) - (3.0f * t2) + 1.0f) * from.value) + ((t3 - (2.0f * t2) + t) * fromTangent) + (((-2.0f * t3) + (3.0f * t2)) * to.value) + ((t3 - t2) * toTangent);
+	}
+	}
+	return from.value;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Transform2D.h"
+#include "StaticTransform2D.h"
+#include <vector>
+
+namespace KEngine2D
+{
+	class KeyframeUpdater;
+
+	//How a channel gets from one keyframe to the next
+	enum class KeyframeInterpolation
+	{
+		Step,   //Holds the value until the next key
+		Linear,
+		Cubic   //Hermite, with tangents through the neighbouring keys so the curve is smooth across them
+	};
+
+	struct Keyframe
+	{
+		double time;
+		Scalar value;
+		KeyframeInterpolation interpolation;
+	};
+
+	//Plays keyframe curves for translation, rotation and scale.  The curves themselves live in the updater, which evaluates
+	//everything that's playing in one pass.  Update the KeyframeUpdater before any hierarchy these are parents in.
+	class KeyframedTransform : public Transform
+	{
+	public:
+		enum Channel
+		{
+			TranslationX,
+			TranslationY,
+			Rotation,
+			Scale,
+			ChannelCount
+		};
+
+		KeyframedTransform();
+		~KeyframedTransform();
+		//Channels without any keys hold on to the rest transform's values
+		void Init(KeyframeUpdater * updater, StaticTransform const & restTransform = StaticTransform::Identity());
+		void Deinit();
+
+		//Keys have to be added in time order
+		void AddKeyframe(Channel channel, double time, Scalar value, KeyframeInterpolation interpolation = KeyframeInterpolation::Linear);
+		void ClearKeyframes();
+
+		//Non-looping playback stops at the last key
+		void Play(bool looping = false);
+		void Stop();
+		bool IsPlaying() const;
+		void SetTime(double time);
+		double GetTime() const;
+		double GetDuration() const;
+
+		virtual Point GetTranslation() const override;
+		virtual Scalar GetRotation() const override;
+		virtual Scalar GetScale() const override;
+		virtual Affine GetAsAffine() const override;
+		virtual unsigned int GetVersion() const override;
+		virtual Pose GetPose() const override;
+
+		virtual Point LocalToGlobal(Point const & point, bool asVector = false) const override;
+		virtual Point GlobalToLocal(Point const & point) const override;
+		virtual void LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector = false) const override;
+		virtual void GlobalToLocalBatch(Point const * points, Point * results, size_t count) const override;
+
+	private:
+		friend class KeyframeUpdater;
+		void SetCurrentValues(Point const & translation, Scalar rotation, Scalar scale);
+
+		KeyframeUpdater * mUpdater;
+		int mIndex;
+		StaticTransform mCurrentTransform;
+		unsigned int mVersion;
+	};
+
+	//Keyframes for every transform are kept in one array, each transform's channels one after another.  Removing a transform
+	//swaps the last one into its place, the same as MechanicsBatch.
+	class KeyframeUpdater
+	{
+	public:
+		KeyframeUpdater();
+		~KeyframeUpdater();
+
+		void Update(double fTime);
+		size_t GetSize() const;
+
+	private:
+		friend class KeyframedTransform;
+
+		struct ChannelRange
+		{
+			int start;
+			int count;
+			int cursor; //Key the last evaluation started from, so playing forwards rarely has to search
+		};
+
+		int Add(KeyframedTransform * owner);
+		void Remove(int index);
+		void AddKeyframe(int index, KeyframedTransform::Channel channel, Keyframe const & keyframe);
+		void ClearKeyframes(int index);
+		void Evaluate(int index);
+		Scalar EvaluateChannel(ChannelRange & range, double time) const;
+
+		std::vector<KeyframedTransform *> mOwners;
+		std::vector<double> mTimes;
+		std::vector<double> mDurations;
+		std::vector<unsigned char> mPlaying;
+		std::vector<unsigned char> mLooping;
+		std::vector<ChannelRange> mChannels; //ChannelCount for each transform
+		std::vector<Keyframe> mKeyframes;
+	};
+}
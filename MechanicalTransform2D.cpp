@@ -3,9 +3,9 @@
 
 KEngine2D::MechanicalTransform::MechanicalTransform()
 {
-	mCurrentTransform = StaticTransform::Identity();
-	mVelocity = Point::Origin();
-	mAngularVelocity = 0.0f;
+	mBatch = nullptr;
+	mBatchIndex = -1;
+	mVersion = 0;
 }
 
 KEngine2D::MechanicalTransform::~MechanicalTransform()
@@ -13,80 +13,327 @@ KEngine2D::MechanicalTransform::~MechanicalTransform()
 	Deinit();
 }
 
-void KEngine2D::MechanicalTransform::Init( StaticTransform const & currentTransform /*= StaticTransform::Identity()*/, Point const & velocity /*= Point::Origin()*/, double angularVelocity /*= 0.0f*/ )
+void KEngine2D::MechanicalTransform::Init( StaticTransform const & currentTransform /*= StaticTransform::Identity()*/, Point const & velocity /*= Point::Origin()*/, Scalar angularVelocity /*= 0.0f*/ )
 {
-	mCurrentTransform = currentTransform;
-	mVelocity = velocity;
-	mAngularVelocity = angularVelocity;
+	assert(mBatch == nullptr);
+	ResetStandalone(currentTransform, velocity, angularVelocity);
+	mVersion++;
+}
+
+void KEngine2D::MechanicalTransform::Init( MechanicsBatch * batch, StaticTransform const & currentTransform /*= StaticTransform::Identity()*/, Point const & velocity /*= Point::Origin()*/, Scalar angularVelocity /*= 0.0f*/ )
+{
+	assert(batch != nullptr);
+	assert(mBatch == nullptr);
+	mStandalone.reset();
+	mBatch = batch;
+	mBatchIndex = batch->Add(this, currentTransform, velocity, angularVelocity);
 }
 
 void KEngine2D::MechanicalTransform::Deinit()
 {
-	mCurrentTransform = StaticTransform::Identity();
-	mVelocity = Point::Origin();
-	mAngularVelocity = 0.0f;
+	if (mBatch != nullptr)
+	{
+		mVersion = mBatch->GetVersion(mBatchIndex);
+		mBatch->Remove(mBatchIndex);
+	}
+	mBatch = nullptr;
+	mBatchIndex = -1;
+	mVersion++; //Never goes back, so nothing mistakes the next Init for what it had cached
+	if (mStandalone != nullptr)
+	{
+		ResetStandalone(StaticTransform::Identity(), Point::Origin(), 0.0f);
+	}
+}
+
+//Kept once made, so Deinit and Init again don't go back to the heap
+void KEngine2D::MechanicalTransform::ResetStandalone(StaticTransform const & currentTransform, Point const & velocity, Scalar angularVelocity)
+{
+	if (mStandalone == nullptr)
+	{
+		mStandalone.reset(new StandaloneState());
+	}
+	mStandalone->currentTransform = currentTransform;
+	mStandalone->previousTransform = currentTransform;
+	mStandalone->velocity = velocity;
+	mStandalone->angularVelocity = angularVelocity;
+	mStandalone->awake = true;
+}
+
+//Transforms without any state of their own, not Init'd yet or last used in a batch, read as resting at the origin
+KEngine2D::MechanicalTransform::StandaloneState const & KEngine2D::MechanicalTransform::GetStandalone() const
+{
+	static StandaloneState const resting = { StaticTransform::Identity(), StaticTransform::Identity(), Point::Origin(), 0.0f, true };
+	return mStandalone != nullptr ? *mStandalone : resting;
+}
+
+KEngine2D::MechanicalTransform::StandaloneState & KEngine2D::MechanicalTransform::GetStandalone()
+{
+	if (mStandalone == nullptr)
+	{
+		ResetStandalone(StaticTransform::Identity(), Point::Origin(), 0.0f);
+	}
+	return *mStandalone;
+}
+
+//Copies the batch's state back so the transform carries on by itself
+void KEngine2D::MechanicalTransform::Detach()
+{
+	assert(mBatch != nullptr);
+	MechanicsBatch * batch = mBatch;
+	int batchIndex = mBatchIndex;
+	ResetStandalone(batch->GetCurrentTransform(batchIndex), batch->GetVelocity(batchIndex), batch->GetAngularVelocity(batchIndex));
+	mStandalone->previousTransform = batch->GetPreviousTransform(batchIndex);
+	mStandalone->awake = batch->IsAwake(batchIndex);
+	mVersion = batch->GetVersion(batchIndex);
+	mBatch = nullptr;
+	mBatchIndex = -1;
+	batch->Remove(batchIndex);
 }
 
 void KEngine2D::MechanicalTransform::Update( double fTime )
 {
-	Point currentTranslation = mCurrentTransform.GetTranslation();
-	Point scaledVelocity = mVelocity;
+	if (mBatch != nullptr)
+	{
+		mBatch->Integrate(mBatchIndex, fTime);
+		return;
+	}
+	StandaloneState & state = GetStandalone();
+	state.previousTransform = state.currentTransform;
+	if (!state.awake)
+	{
+		return;
+	}
+	unsigned int previousVersion = state.currentTransform.GetVersion();
+	Point currentTranslation = state.currentTransform.GetTranslation();
+	Point scaledVelocity = state.velocity;
 	scaledVelocity *= fTime;
 	currentTranslation += scaledVelocity;
-	double currentRotation = mCurrentTransform.GetRotation();
-	currentRotation += fTime * mAngularVelocity;
-	mCurrentTransform.SetTranslation(currentTranslation);
-	mCurrentTransform.SetRotation(currentRotation);
+	Scalar currentRotation = state.currentTransform.GetRotation();
+	currentRotation += fTime * state.angularVelocity;
+	state.currentTransform.SetTranslation(currentTranslation);
+	state.currentTransform.SetRotation(currentRotation);
+	if (state.currentTransform.GetVersion() != previousVersion)
+	{
+		mVersion++;
+	}
 }
 
 KEngine2D::Point KEngine2D::MechanicalTransform::GetTranslation() const
 {
-	return mCurrentTransform.GetTranslation();
+	if (mBatch != nullptr)
+	{
+		return mBatch->GetTranslation(mBatchIndex);
+	}
+	return GetStandalone().currentTransform.GetTranslation();
 }
 
-double KEngine2D::MechanicalTransform::GetRotation() const
+KEngine2D::Scalar KEngine2D::MechanicalTransform::GetRotation() const
 {
-	return mCurrentTransform.GetRotation();
+	if (mBatch != nullptr)
+	{
+		return mBatch->GetRotation(mBatchIndex);
+	}
+	return GetStandalone().currentTransform.GetRotation();
 }
 
-double KEngine2D::MechanicalTransform::GetScale() const
+KEngine2D::Scalar KEngine2D::MechanicalTransform::GetScale() const
 {
-	return mCurrentTransform.GetScale();
+	if (mBatch != nullptr)
+	{
+		return mBatch->GetScale(mBatchIndex);
+	}
+	return GetStandalone().currentTransform.GetScale();
 }
 
-const KEngine2D::Matrix& KEngine2D::MechanicalTransform::GetAsMatrix() const
+KEngine2D::Affine KEngine2D::MechanicalTransform::GetAsAffine() const
 {
-    return mCurrentTransform.GetAsMatrix();
+	if (mBatch != nullptr)
+	{
+		return Transform::GetAsAffine();
+	}
+	return GetStandalone().currentTransform.GetAsAffine();
+}
+
+unsigned int KEngine2D::MechanicalTransform::GetVersion() const
+{
+	if (mBatch != nullptr)
+	{
+		return mBatch->GetVersion(mBatchIndex);
+	}
+	return mVersion;
+}
+
+KEngine2D::Pose KEngine2D::MechanicalTransform::GetPose() const
+{
+	if (mBatch != nullptr)
+	{
+		return mBatch->GetPose(mBatchIndex);
+	}
+	return GetStandalone().currentTransform.GetPose();
+}
+
+KEngine2D::Point KEngine2D::MechanicalTransform::LocalToGlobal(Point const & point, bool asVector) const
+{
+	if (mBatch != nullptr)
+	{
+		return Transform::LocalToGlobal(point, asVector);
+	}
+	return GetStandalone().currentTransform.LocalToGlobal(point, asVector);
+}
+
+KEngine2D::Point KEngine2D::MechanicalTransform::GlobalToLocal(Point const & point) const
+{
+	if (mBatch != nullptr)
+	{
+		return Transform::GlobalToLocal(point);
+	}
+	return GetStandalone().currentTransform.GlobalToLocal(point);
 }
 
-void KEngine2D::MechanicalTransform::SetCurrentTransform( StaticTransform const & currentTransform )
+void KEngine2D::MechanicalTransform::LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector) const
+{
+	if (mBatch != nullptr)
+	{
+		Transform::LocalToGlobalBatch(points, results, count, asVector);
+		return;
+	}
+	GetStandalone().currentTransform.LocalToGlobalBatch(points, results, count, asVector);
+}
+
+void KEngine2D::MechanicalTransform::GlobalToLocalBatch(Point const * points, Point * results, size_t count) const
+{
+	if (mBatch != nullptr)
+	{
+		Transform::GlobalToLocalBatch(points, results, count);
+		return;
+	}
+	GetStandalone().currentTransform.GlobalToLocalBatch(points, results, count);
+}
+
+void KEngine2D::MechanicalTransform::SetCurrentTransform( StaticTransform const & currentTransform, bool resetPrevious /*= true*/ )
 {
-	mCurrentTransform = currentTransform;
+	if (mBatch != nullptr)
+	{
+		mBatch->SetCurrentTransform(mBatchIndex, currentTransform, resetPrevious);
+	}
+	else
+	{
+		StandaloneState & state = GetStandalone();
+		state.currentTransform = currentTransform;
+		if (resetPrevious)
+		{
+			state.previousTransform = currentTransform;
+		}
+		mVersion++;
+	}
+	SetAwake(true);
 }
 
 void KEngine2D::MechanicalTransform::SetVelocity( Point const & veloctiy )
 {
-	mVelocity = veloctiy;
+	if (mBatch != nullptr)
+	{
+		mBatch->SetVelocity(mBatchIndex, veloctiy);
+	}
+	else
+	{
+		GetStandalone().velocity = veloctiy;
+	}
+	if (veloctiy.x != 0.0f || veloctiy.y != 0.0f)
+	{
+		SetAwake(true);
+	}
+}
+
+void KEngine2D::MechanicalTransform::SetAngularVelocity( Scalar angularVelocity )
+{
+	if (mBatch != nullptr)
+	{
+		mBatch->SetAngularVelocity(mBatchIndex, angularVelocity);
+	}
+	else
+	{
+		GetStandalone().angularVelocity = angularVelocity;
+	}
+	if (angularVelocity != 0.0f)
+	{
+		SetAwake(true);
+	}
+}
+
+KEngine2D::Point KEngine2D::MechanicalTransform::GetVelocity() const
+{
+	if (mBatch != nullptr)
+	{
+		return mBatch->GetVelocity(mBatchIndex);
+	}
+	return GetStandalone().velocity;
 }
 
-void KEngine2D::MechanicalTransform::SetAngularVelocity( double angularVelocity )
+KEngine2D::Scalar KEngine2D::MechanicalTransform::GetAngularVelocity() const
 {
-	mAngularVelocity = angularVelocity;
+	if (mBatch != nullptr)
+	{
+		return mBatch->GetAngularVelocity(mBatchIndex);
+	}
+	return GetStandalone().angularVelocity;
 }
 
-KEngine2D::Point const & KEngine2D::MechanicalTransform::GetVelocity() const
+KEngine2D::StaticTransform KEngine2D::MechanicalTransform::GetPreviousTransform() const
 {
-	return mVelocity;
+	if (mBatch != nullptr)
+	{
+		return mBatch->GetPreviousTransform(mBatchIndex);
+	}
+	return GetStandalone().previousTransform;
 }
 
-double KEngine2D::MechanicalTransform::GetAngularVelocity() const
+KEngine2D::StaticTransform KEngine2D::MechanicalTransform::GetInterpolatedTransform( Scalar alpha ) const
 {
-	return mAngularVelocity;
+	StaticTransform previousTransform = GetPreviousTransform();
+	Point translation = previousTransform.GetTranslation();
+	Point delta = GetTranslation();
+	delta -= translation;
+	delta *= alpha;
+	translation += delta;
+	Scalar rotation = previousTransform.GetRotation() + (alpha * (GetRotation() - previousTransform.GetRotation()));
+	Scalar scale = previousTransform.GetScale() + (alpha * (GetScale() - previousTransform.GetScale()));
+	return StaticTransform(translation, rotation, scale);
 }
 
-void KEngine2D::UpdatingMechanicalTransform::Init( KEngineCore::Updater<MechanicalTransform> * updater, StaticTransform const & currentTransform /*= StaticTransform::Identity()*/, Point const & velocity /*= Point::Origin()*/, double angularVelocity /*= 0.0f*/ )
+void KEngine2D::MechanicalTransform::SetAwake( bool awake )
+{
+	if (mBatch != nullptr)
+	{
+		mBatch->SetAwake(mBatchIndex, awake);
+		return;
+	}
+	GetStandalone().awake = awake;
+}
+
+bool KEngine2D::MechanicalTransform::IsAwake() const
+{
+	if (mBatch != nullptr)
+	{
+		return mBatch->IsAwake(mBatchIndex);
+	}
+	return GetStandalone().awake;
+}
+
+void KEngine2D::UpdatingMechanicalTransform::Init( KEngineCore::Updater<MechanicalTransform> * updater, StaticTransform const & currentTransform /*= StaticTransform::Identity()*/, Point const & velocity /*= Point::Origin()*/, Scalar angularVelocity /*= 0.0f*/ )
 {
 	KEngineCore::Updating<MechanicalTransform>::Init(updater);
     MechanicalTransform::Init(currentTransform, velocity, angularVelocity);
 	Start();
 }
+
+void KEngine2D::MechanicsUpdater::Update( double fTime )
+{
+	mBatch.Integrate(fTime);
+	KEngineCore::Updater<MechanicalTransform>::Update(fTime);
+}
+
+KEngine2D::MechanicsBatch * KEngine2D::MechanicsUpdater::GetBatch()
+{
+	return &mBatch;
+}
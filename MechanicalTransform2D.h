@@ -1,7 +1,9 @@
 #pragma  once
 
+#include <memory>
 #include "Transform2D.h"
 #include "StaticTransform2D.h"
+#include "MechanicsBatch2D.h"
 #include "Updater.h"
 
 namespace KEngine2D
@@ -11,35 +13,78 @@ namespace KEngine2D
 	public:
 		MechanicalTransform();
 		~MechanicalTransform();
-		void Init(StaticTransform const & currentTransform = StaticTransform::Identity(), Point const & velocity = Point::Origin(), double angularVelocity = 0.0f);
+		void Init(StaticTransform const & currentTransform = StaticTransform::Identity(), Point const & velocity = Point::Origin(), Scalar angularVelocity = 0.0f);
+		//Keeps its motion in the batch instead, and gets integrated along with everything else in it.  The transform is then
+		//just a handle on its entry, and a transform of its own only gets room for its motion when it's Init'd without one.
+		void Init(MechanicsBatch * batch, StaticTransform const & currentTransform = StaticTransform::Identity(), Point const & velocity = Point::Origin(), Scalar angularVelocity = 0.0f);
 		void Deinit();
 
 		void Update(double fTime);
 
 		virtual Point GetTranslation() const override;
-		virtual double GetRotation() const override;
-		virtual double GetScale() const override;
-        virtual const Matrix& GetAsMatrix() const override;
+		virtual Scalar GetRotation() const override;
+		virtual Scalar GetScale() const override;
+		virtual Affine GetAsAffine() const override;
+		virtual unsigned int GetVersion() const override;
+		virtual Pose GetPose() const override;
 
-		void SetCurrentTransform(StaticTransform const & currentTransform);
+		virtual Point LocalToGlobal(Point const & point, bool asVector = false) const override;
+		virtual Point GlobalToLocal(Point const & point) const override;
+		virtual void LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector = false) const override;
+		virtual void GlobalToLocalBatch(Point const * points, Point * results, size_t count) const override;
+
+		//Normally also resets the previous transform, so a teleport doesn't get blended across. Wakes the object, like a new velocity does
+		void SetCurrentTransform(StaticTransform const & currentTransform, bool resetPrevious = true);
 		void SetVelocity(Point const & velocity);
-		void SetAngularVelocity(double angularVelocity);
+		void SetAngularVelocity(Scalar angularVelocity);
+
+		Point GetVelocity() const;
+		Scalar GetAngularVelocity() const;
+
+		//Where the transform was before the last Update, and a blend from there to where it is now
+		StaticTransform GetPreviousTransform() const;
+		StaticTransform GetInterpolatedTransform(Scalar alpha) const;
 
-		Point const & GetVelocity() const;
-		double GetAngularVelocity() const;
+		//Asleep transforms skip Update.  Giving one any velocity wakes it back up.
+		void SetAwake(bool awake);
+		bool IsAwake() const;
 
 	private:
-		StaticTransform mCurrentTransform;
-		Point			mVelocity;
-		double			mAngularVelocity;
-		
+		friend class MechanicsBatch;
+		void Detach();
+
+		struct StandaloneState
+		{
+			StaticTransform currentTransform;
+			StaticTransform previousTransform;
+			Point			velocity;
+			Scalar			angularVelocity;
+			bool			awake;
+		};
+		void ResetStandalone(StaticTransform const & currentTransform, Point const & velocity, Scalar angularVelocity);
+		StandaloneState const & GetStandalone() const;
+		StandaloneState & GetStandalone(); //Makes it if there isn't one yet
+
+		std::unique_ptr<StandaloneState> mStandalone; //Only used when there's no batch
+		MechanicsBatch * mBatch;
+		int				mBatchIndex;
+		unsigned int	mVersion;
 	};
 
 	class UpdatingMechanicalTransform : public KEngineCore::Updating<MechanicalTransform>
 	{
 	public:
-		void Init(KEngineCore::Updater<MechanicalTransform> * updater, StaticTransform const & currentTransform = KEngine2D::StaticTransform::Identity(), KEngine2D::Point const & velocity = KEngine2D::Point::Origin(), double angularVelocity = 0.0f);
+		void Init(KEngineCore::Updater<MechanicalTransform> * updater, StaticTransform const & currentTransform = KEngine2D::StaticTransform::Identity(), KEngine2D::Point const & velocity = KEngine2D::Point::Origin(), Scalar angularVelocity = 0.0f);
 	};
 
-	class MechanicsUpdater : public  KEngineCore::Updater<MechanicalTransform> {};
+	//Transforms added as usual are updated one at a time, those initialized with GetBatch are all integrated first in one pass
+	class MechanicsUpdater : public  KEngineCore::Updater<MechanicalTransform>
+	{
+	public:
+		void Update(double fTime);
+		MechanicsBatch * GetBatch();
+
+	private:
+		MechanicsBatch mBatch;
+	};
 }
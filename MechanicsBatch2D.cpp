@@ -0,0 +1,220 @@
+#include "MechanicsBatch2D.h"
+#include "MechanicalTransform2D.h"
+#include <cassert>
+#include <cmath>
+#include "ScalarSimd2D.h"
+
+KEngine2D::MechanicsBatch::MechanicsBatch()
+{
+
+}
+
+KEngine2D::MechanicsBatch::~MechanicsBatch()
+{
+	//Anything still in here goes back to looking after itself
+	while (!mOwners.empty())
+	{
+		mOwners.back()->Detach();
+	}
+}
+
+int KEngine2D::MechanicsBatch::Add(MechanicalTransform * owner, StaticTransform const & currentTransform, Point const & velocity, Scalar angularVelocity)
+{
+	assert(owner != nullptr);
+	Point translation = currentTransform.GetTranslation();
+	mOwners.push_back(owner);
+	mX.push_back(translation.x);
+	mY.push_back(translation.y);
+	mRotation.push_back(currentTransform.GetRotation());
+	mScale.push_back(currentTransform.GetScale());
+	mVelocityX.push_back(velocity.x);
+	mVelocityY.push_back(velocity.y);
+	mAngularVelocity.push_back(angularVelocity);
+	mAwake.push_back(1.0f);
+	mPreviousX.push_back(translation.x);
+	mPreviousY.push_back(translation.y);
+	mPreviousRotation.push_back(currentTransform.GetRotation());
+	mVersions.push_back(owner->mVersion + 1);
+	return (int)mOwners.size() - 1;
+}
+
+void KEngine2D::MechanicsBatch::Remove(int index)
+{
+	assert(index >= 0 && index < (int)mOwners.size());
+	int last = (int)mOwners.size() - 1;
+	if (index != last)
+	{
+		mOwners[index] = mOwners[last];
+		mX[index] = mX[last];
+		mY[index] = mY[last];
+		mRotation[index] = mRotation[last];
+		mScale[index] = mScale[last];
+		mVelocityX[index] = mVelocityX[last];
+		mVelocityY[index] = mVelocityY[last];
+		mAngularVelocity[index] = mAngularVelocity[last];
+		mAwake[index] = mAwake[last];
+		mPreviousX[index] = mPreviousX[last];
+		mPreviousY[index] = mPreviousY[last];
+		mPreviousRotation[index] = mPreviousRotation[last];
+		mVersions[index] = mVersions[last];
+		mOwners[index]->mBatchIndex = index;
+	}
+	mOwners.pop_back();
+	mX.pop_back();
+	mY.pop_back();
+	mRotation.pop_back();
+	mScale.pop_back();
+	mVelocityX.pop_back();
+	mVelocityY.pop_back();
+	mAngularVelocity.pop_back();
+	mAwake.pop_back();
+	mPreviousX.pop_back();
+	mPreviousY.pop_back();
+	mPreviousRotation.pop_back();
+	mVersions.pop_back();
+}
+
+size_t KEngine2D::MechanicsBatch::GetSize() const
+{
+	return mOwners.size();
+}
+
+void KEngine2D::MechanicsBatch::Integrate(double fTime)
+{
+	size_t count = mOwners.size();
+	for (size_t entry = 0; entry < count; entry++) {
+		mVersions[entry] += mAwake[entry] != 0.0f ? 1 : 0;
+	}
+
+	size_t i = 0;
+
+#if defined(KENGINE2D_SCALAR_AVX)
+	i = IntegrateRange<WideScalars>(i, count, fTime);
+#endif
+#if defined(KENGINE2D_SCALAR_SSE)
+	i = IntegrateRange<NarrowScalars>(i, count, fTime);
+#endif
+
+	for (; i < count; i++) {
+		IntegrateMotion((int)i, fTime);
+	}
+}
+
+template <typename Registers>
+size_t KEngine2D::MechanicsBatch::IntegrateRange(size_t begin, size_t count, double fTime)
+{
+	typename Registers::Register step = Registers::Set((Scalar)fTime);
+	size_t i = begin;
+	for (; i + Registers::Count <= count; i += Registers::Count) {
+		typename Registers::Register scaledStep = Registers::Multiply(step, Registers::Load(&mAwake[i]));
+		typename Registers::Register x = Registers::Load(&mX[i]);
+		typename Registers::Register y = Registers::Load(&mY[i]);
+		typename Registers::Register rotation = Registers::Load(&mRotation[i]);
+		Registers::Store(&mPreviousX[i], x);
+		Registers::Store(&mPreviousY[i], y);
+		Registers::Store(&mPreviousRotation[i], rotation);
+		Registers::Store(&mX[i], Registers::Add(x, Registers::Multiply(Registers::Load(&mVelocityX[i]), scaledStep)));
+		Registers::Store(&mY[i], Registers::Add(y, Registers::Multiply(Registers::Load(&mVelocityY[i]), scaledStep)));
+		Registers::Store(&mRotation[i], Registers::Add(rotation, Registers::Multiply(Registers::Load(&mAngularVelocity[i]), scaledStep)));
+	}
+	return i;
+}
+
+void KEngine2D::MechanicsBatch::Integrate(int index, double fTime)
+{
+	mVersions[index] += mAwake[index] != 0.0f ? 1 : 0;
+	IntegrateMotion(index, fTime);
+}
+
+void KEngine2D::MechanicsBatch::IntegrateMotion(int index, double fTime)
+{
+	Scalar scaledStep = (Scalar)fTime * mAwake[index];
+	mPreviousX[index] = mX[index];
+	mPreviousY[index] = mY[index];
+	mPreviousRotation[index] = mRotation[index];
+	mX[index] += mVelocityX[index] * scaledStep;
+	mY[index] += mVelocityY[index] * scaledStep;
+	mRotation[index] += mAngularVelocity[index] * scaledStep;
+}
+
+KEngine2D::StaticTransform KEngine2D::MechanicsBatch::GetCurrentTransform(int index) const
+{
+	return StaticTransform({ mX[index], mY[index] }, mRotation[index], mScale[index]);
+}
+
+KEngine2D::StaticTransform KEngine2D::MechanicsBatch::GetPreviousTransform(int index) const
+{
+	return StaticTransform({ mPreviousX[index], mPreviousY[index] }, mPreviousRotation[index], mScale[index]);
+}
+
+KEngine2D::Point KEngine2D::MechanicsBatch::GetTranslation(int index) const
+{
+	return { mX[index], mY[index] };
+}
+
+KEngine2D::Scalar KEngine2D::MechanicsBatch::GetRotation(int index) const
+{
+	return mRotation[index];
+}
+
+KEngine2D::Scalar KEngine2D::MechanicsBatch::GetScale(int index) const
+{
+	return mScale[index];
+}
+
+KEngine2D::Point KEngine2D::MechanicsBatch::GetVelocity(int index) const
+{
+	return { mVelocityX[index], mVelocityY[index] };
+}
+
+KEngine2D::Scalar KEngine2D::MechanicsBatch::GetAngularVelocity(int index) const
+{
+	return mAngularVelocity[index];
+}
+
+bool KEngine2D::MechanicsBatch::IsAwake(int index) const
+{
+	return mAwake[index] != 0.0f;
+}
+
+unsigned int KEngine2D::MechanicsBatch::GetVersion(int index) const
+{
+	return mVersions[index];
+}
+
+KEngine2D::Pose KEngine2D::MechanicsBatch::GetPose(int index) const
+{
+	return { { mX[index], mY[index] }, mScale[index], std::cos(mRotation[index]), std::sin(mRotation[index]) };
+}
+
+void KEngine2D::MechanicsBatch::SetCurrentTransform(int index, StaticTransform const & currentTransform, bool resetPrevious)
+{
+	Point translation = currentTransform.GetTranslation();
+	mX[index] = translation.x;
+	mY[index] = translation.y;
+	mRotation[index] = currentTransform.GetRotation();
+	mScale[index] = currentTransform.GetScale();
+	if (resetPrevious)
+	{
+		mPreviousX[index] = translation.x;
+		mPreviousY[index] = translation.y;
+		mPreviousRotation[index] = currentTransform.GetRotation();
+	}
+	mVersions[index]++;
+}
+
+void KEngine2D::MechanicsBatch::SetVelocity(int index, Point const & velocity)
+{
+	mVelocityX[index] = velocity.x;
+	mVelocityY[index] = velocity.y;
+}
+
+void KEngine2D::MechanicsBatch::SetAngularVelocity(int index, Scalar angularVelocity)
+{
+	mAngularVelocity[index] = angularVelocity;
+}
+
+void KEngine2D::MechanicsBatch::SetAwake(int index, bool awake)
+{
+	mAwake[index] = awake ? 1.0f : 0.0f;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Transform2D.h"
+#include "StaticTransform2D.h"
+#include <vector>
+#include <cstddef>
+
+namespace KEngine2D
+{
+	class MechanicalTransform;
+
+	//Motion for many mechanical transforms laid out as a structure of arrays, so they can all be integrated in one pass.
+	//Integrates 4 at a time with AVX, 2 with SSE (twice that in a float build), and one at a time everywhere else.
+	class MechanicsBatch
+	{
+	public:
+		MechanicsBatch();
+		~MechanicsBatch();
+
+		//Removing swaps the last entry into the hole, and tells its transform where it went
+		int Add(MechanicalTransform * owner, StaticTransform const & currentTransform, Point const & velocity, Scalar angularVelocity);
+		void Remove(int index);
+		size_t GetSize() const;
+
+		void Integrate(double fTime);
+		void Integrate(int index, double fTime);
+
+		StaticTransform GetCurrentTransform(int index) const;
+		StaticTransform GetPreviousTransform(int index) const;
+		Point GetTranslation(int index) const;
+		Scalar GetRotation(int index) const;
+		Scalar GetScale(int index) const;
+		Point GetVelocity(int index) const;
+		Scalar GetAngularVelocity(int index) const;
+		bool IsAwake(int index) const;
+		unsigned int GetVersion(int index) const; //Goes up each time the entry moves
+		Pose GetPose(int index) const;
+
+		void SetCurrentTransform(int index, StaticTransform const & currentTransform, bool resetPrevious);
+		void SetVelocity(int index, Point const & velocity);
+		void SetAngularVelocity(int index, Scalar angularVelocity);
+		void SetAwake(int index, bool awake);
+
+	private:
+		void IntegrateMotion(int index, double fTime);
+		//Returns how far it got, leaving the rest for a narrower register or IntegrateMotion
+		template <typename Registers>
+		size_t IntegrateRange(size_t begin, size_t count, double fTime);
+
+		std::vector<MechanicalTransform *> mOwners;
+		std::vector<Scalar> mX;
+		std::vector<Scalar> mY;
+		std::vector<Scalar> mRotation;
+		std::vector<Scalar> mScale;
+		std::vector<Scalar> mVelocityX;
+		std::vector<Scalar> mVelocityY;
+		std::vector<Scalar> mAngularVelocity;
+		std::vector<Scalar> mAwake; //1 or 0, so asleep entries can be integrated along with the rest without moving
+		std::vector<Scalar> mPreviousX;
+		std::vector<Scalar> mPreviousY;
+		std::vector<Scalar> mPreviousRotation;
+		std::vector<unsigned int> mVersions;
+	};
+}
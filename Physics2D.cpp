@@ -1,11 +1,28 @@
 #include "Physics2D.h"
+#include "AllocationCounter2D.h"
+#include <cassert>
 #include <algorithm>
+#include <functional>
+#include <cmath>
 #include <math.h>
 
+//Needs a definition before C++17, since push_back takes it by reference
+constexpr long long KEngine2D::PhysicsSystem::NoSleepGroup;
+
 KEngine2D::PhysicalObject::PhysicalObject()
 {
 	mMass = 0.0f;
+	mInverseMass = 0.0f;
+	mMomentOfInertia = 0.0f;
+	mInverseMomentOfInertia = 0.0f;
+	mMassPropertiesValid = false;
+	mMassShapeVersion = 0;
+	mMassScale = 0.0f;
 	mMechanics = 0;
+	mPhysicsSystem = nullptr;
+	mCollisionVolume = nullptr;
+	mContinuousCollision = false;
+	mSystemIndex = -1;
 }
 
 KEngine2D::PhysicalObject::~PhysicalObject()
@@ -13,14 +30,14 @@ KEngine2D::PhysicalObject::~PhysicalObject()
 	Deinit();
 }
 
-void KEngine2D::PhysicalObject::Init( PhysicsSystem * physicsSystem, MechanicalTransform * mechanics, BoundingArea * collisionVolume, double mass )
+void KEngine2D::PhysicalObject::Init( PhysicsSystem * physicsSystem, MechanicalTransform * mechanics, BoundingArea * collisionVolume, Scalar mass )
 {
 	assert(physicsSystem != 0);
 	assert(mechanics != 0);
-	assert(mass >= 0.0f); //Not supporting zero mass
+	assert(collisionVolume != 0);
 	mMechanics = mechanics;
 	mCollisionVolume = collisionVolume;
-	mMass = mass;
+	SetMass(mass);
 	mPhysicsSystem = physicsSystem;
 	physicsSystem->AddPhysicalObject(this);
 }
@@ -33,37 +50,122 @@ void KEngine2D::PhysicalObject::Deinit()
 	}
 	mPhysicsSystem = nullptr;
 	mMass = 0.0f;
+	mInverseMass = 0.0f;
+	mMassPropertiesValid = false;
 	mMechanics = nullptr;
 	mCollisionVolume = nullptr;
+	mContinuousCollision = false;
 }
 
-double KEngine2D::PhysicalObject::GetMass() const
+KEngine2D::Scalar KEngine2D::PhysicalObject::GetMass() const
 {
 	return mMass;
 }
 
-void KEngine2D::PhysicalObject::SetMass( double mass )
+KEngine2D::Scalar KEngine2D::PhysicalObject::GetInverseMass() const
 {
-	mMass = mass;
+	return mInverseMass;
 }
 
+KEngine2D::Scalar KEngine2D::PhysicalObject::GetMomentOfInertia() const
+{
+	UpdateMassProperties();
+	return mMomentOfInertia;
+}
 
-double KEngine2D::PhysicalObject::GetMomentOfInertia() const
+KEngine2D::Scalar KEngine2D::PhysicalObject::GetInverseMomentOfInertia() const
 {
-	return mCollisionVolume->GetAreaMomentOfInertia() * GetMass();
+	UpdateMassProperties();
+	return mInverseMomentOfInertia;
 }
 
+bool KEngine2D::PhysicalObject::HasInfiniteMass() const
+{
+	return mInverseMass == 0.0f;
+}
 
-double KEngine2D::PhysicalObject::GetEnergy() const
+void KEngine2D::PhysicalObject::SetMass( Scalar mass )
 {
+	assert(mass >= 0.0f);
+	mMass = mass;
+	mInverseMass = mass > 0.0f && std::isfinite(mass) ? 1.0f / mass : 0.0f;
+	mMassPropertiesValid = false;
+}
+
+//Only the shapes and the scale go into the inertia, since the shapes' offsets from the centre don't change as it moves or turns
+void KEngine2D::PhysicalObject::UpdateMassProperties() const
+{
+	unsigned int shapeVersion = mCollisionVolume->GetShapeVersion();
+	Scalar scale = mMechanics->GetScale();
+	if (mMassPropertiesValid && shapeVersion == mMassShapeVersion && scale == mMassScale)
+	{
+		return;
+	}
+	mMassPropertiesValid = true;
+	mMassShapeVersion = shapeVersion;
+	mMassScale = scale;
+	if (HasInfiniteMass())
+	{
+		mMomentOfInertia = mMass; //Zero or infinite, the same as the mass
+		mInverseMomentOfInertia = 0.0f;
+		return;
+	}
+	//The area's moment is per unit of area, so with the mass spread evenly over the shapes this is the body's
+	mCollisionVolume->UpdatePoses();
+	mMomentOfInertia = mCollisionVolume->GetAreaMomentOfInertia() * mMass;
+	mInverseMomentOfInertia = mMomentOfInertia > 0.0f ? 1.0f / mMomentOfInertia : 0.0f;
+}
+
+//Nothing with infinite mass is counted, since it can't be moving
+KEngine2D::Scalar KEngine2D::PhysicalObject::GetEnergy() const
+{
+	if (HasInfiniteMass())
+	{
+		return 0.0f;
+	}
 	Point linearVelocity = mMechanics->GetVelocity();
-	double angularVelocity = mMechanics->GetAngularVelocity();
+	Scalar angularVelocity = mMechanics->GetAngularVelocity();
 	return 0.5f * ((GetMass() * DotProduct(linearVelocity, linearVelocity)) + (GetMomentOfInertia() * (angularVelocity * angularVelocity)));
 }
 
+KEngine2D::AxisAlignedBoundingBox KEngine2D::PhysicalObject::GetAxisAlignedBoundingBox() const
+{
+	return mCollisionVolume->GetAxisAlignedBoundingBox();
+}
+
+KEngine2D::BoundingArea * KEngine2D::PhysicalObject::GetCollisionVolume() const
+{
+	return mCollisionVolume;
+}
+
+KEngine2D::MechanicalTransform * KEngine2D::PhysicalObject::GetMechanics() const
+{
+	return mMechanics;
+}
+
+bool KEngine2D::PhysicalObject::IsAwake() const
+{
+	return mMechanics->IsAwake();
+}
+
+void KEngine2D::PhysicalObject::WakeUp()
+{
+	mMechanics->SetAwake(true);
+}
+
+void KEngine2D::PhysicalObject::SetContinuousCollision(bool continuousCollision)
+{
+	mContinuousCollision = continuousCollision;
+}
+
+bool KEngine2D::PhysicalObject::GetContinuousCollision() const
+{
+	return mContinuousCollision;
+}
+
 KEngine2D::Point KEngine2D::PhysicalObject::GetVelocity( KEngine2D::Point const & offset /*= KEngine2D::Point::Origin()*/ ) const
 {
-	double angularVelocity = mMechanics->GetAngularVelocity();
+	Scalar angularVelocity = mMechanics->GetAngularVelocity();
 	//Technically tangentialVelocity, simplified from definition of angular velocity as cross product of vector along axis of rotation and radius
 	KEngine2D::Point linearVelocity = {-angularVelocity * offset.y, angularVelocity * offset.x};
 	linearVelocity += mMechanics->GetVelocity();
@@ -72,10 +174,12 @@ KEngine2D::Point KEngine2D::PhysicalObject::GetVelocity( KEngine2D::Point const
 
 void KEngine2D::PhysicalObject::ApplyImpulse( KEngine2D::Point const & impulse, KEngine2D::Point const & offset /*= KEngine2D::Point::Origin()*/ )
 {
+	WakeUp();
+
 	//Decompose the impulse vector into the component parallel to the offset (which will be applied directly to velocity)
 	//and the component perpendicular to the offset (which will be applied to angular velocity)
 	KEngine2D::Point deltaVelocity = impulse;
-	double deltaAngularVelocity = /*0.3f **/ ((offset.x*impulse.y) - (offset.y*impulse.x)); //.3 is a complete hack, and doesn't really work
+	Scalar deltaAngularVelocity = /*0.3f **/ ((offset.x*impulse.y) - (offset.y*impulse.x)); //.3 is a complete hack, and doesn't really work
 	
 	if (offset.x != 0.0f || offset.y != 0.0f)
 	{
@@ -99,14 +203,11 @@ void KEngine2D::PhysicalObject::ApplyImpulse( KEngine2D::Point const & impulse,
 		} */
 	}
 
-	double invertedMass = 1.0f / mMass; //Safe because of assert in Init
-	double invertedMomentOfInertia = 1 / GetMomentOfInertia();
-
-	deltaVelocity *= invertedMass;
-	deltaAngularVelocity *= invertedMomentOfInertia;
+	deltaVelocity *= mInverseMass;
+	deltaAngularVelocity *= GetInverseMomentOfInertia();
 
 	KEngine2D::Point velocity = mMechanics->GetVelocity();
-	double angularVelocity = mMechanics->GetAngularVelocity();
+	Scalar angularVelocity = mMechanics->GetAngularVelocity();
 
 	velocity += deltaVelocity;
 	angularVelocity += deltaAngularVelocity;
@@ -117,77 +218,90 @@ void KEngine2D::PhysicalObject::ApplyImpulse( KEngine2D::Point const & impulse,
 
 bool KEngine2D::PhysicalObject::CheckAndResolveCollision( PhysicalObject & other )
 {
-	constexpr float coefficientOfRestitution = 1.0f;
+	mCollisionVolume->UpdatePoses();
+	other.mCollisionVolume->UpdatePoses();
 	CollisionInfo possibleCollision = mCollisionVolume->Collides(*other.mCollisionVolume);
 	if (possibleCollision.collides) {
-		Point offset = possibleCollision.collisionPoint;
-		offset -= mMechanics->GetTranslation();
-		Point otherOffset = possibleCollision.collisionPoint;
-		otherOffset -= other.mMechanics->GetTranslation();
-		Point collisionNormal = possibleCollision.collisionNormal;
-		collisionNormal /= sqrt(DotProduct(collisionNormal, collisionNormal));
+		ResolveCollision(other, possibleCollision);
+		return true;
+	}
+	return false;
+}
 
-		//assert(DotProduct(collisionNormal, collisionNormal) == 1.0f);
+void KEngine2D::PhysicalObject::ResolveCollision( PhysicalObject & other, CollisionInfo const & collision )
+{
+	constexpr Scalar coefficientOfRestitution = 1.0f;
+	assert(collision.collides);
+	Point offset = collision.collisionPoint;
+	offset -= mMechanics->GetTranslation();
+	Point otherOffset = collision.collisionPoint;
+	otherOffset -= other.mMechanics->GetTranslation();
+	Point collisionNormal = collision.collisionNormal;
+	collisionNormal /= sqrt(DotProduct(collisionNormal, collisionNormal));
 
-		double mass = GetMass();
-		double otherMass = other.GetMass();
-		double momentOfInertia = GetMomentOfInertia();
-		double otherMomentOfInertia = other.GetMomentOfInertia();
-		
-		KEngine2D::Point velocity = GetVelocity(offset);
-		KEngine2D::Point otherVelocity = other.GetVelocity(otherOffset);
-		KEngine2D::Point relativeVelocity = otherVelocity;
-		relativeVelocity -= velocity;
+	//assert(DotProduct(collisionNormal, collisionNormal) == 1.0f);
 
-		double oldImpulseCoefficient = (2 * mass * otherMass) / (mass + otherMass); //masses asserted positive, total can't be zero
-		double offsetCrossNormal = PseudoCrossProduct(offset, collisionNormal);
-		Point offsetCrossNormalCrossOffset = PseudoCrossProduct(collisionNormal, offsetCrossNormal);
-		offsetCrossNormalCrossOffset /= momentOfInertia;
+	Scalar inverseMass = GetInverseMass();
+	Scalar otherInverseMass = other.GetInverseMass();
+	Scalar inverseMomentOfInertia = GetInverseMomentOfInertia();
+	Scalar otherInverseMomentOfInertia = other.GetInverseMomentOfInertia();
+	
+	KEngine2D::Point velocity = GetVelocity(offset);
+	KEngine2D::Point otherVelocity = other.GetVelocity(otherOffset);
+	KEngine2D::Point relativeVelocity = otherVelocity;
+	relativeVelocity -= velocity;
 
+	Scalar offsetCrossNormal = PseudoCrossProduct(offset, collisionNormal);
+	Point offsetCrossNormalCrossOffset = PseudoCrossProduct(collisionNormal, offsetCrossNormal);
+	offsetCrossNormalCrossOffset *= inverseMomentOfInertia;
 
-		double otherOffsetCrossNormal = PseudoCrossProduct(otherOffset, collisionNormal);
-		Point otheroffsetCrossNormalCrossOffset = PseudoCrossProduct(collisionNormal, otherOffsetCrossNormal);
-		otheroffsetCrossNormalCrossOffset /= otherMomentOfInertia;
 
-		offsetCrossNormalCrossOffset += otheroffsetCrossNormalCrossOffset;
+	Scalar otherOffsetCrossNormal = PseudoCrossProduct(otherOffset, collisionNormal);
+	Point otheroffsetCrossNormalCrossOffset = PseudoCrossProduct(collisionNormal, otherOffsetCrossNormal);
+	otheroffsetCrossNormalCrossOffset *= otherInverseMomentOfInertia;
 
-		double idontevenknowanymore = DotProduct(offsetCrossNormalCrossOffset, collisionNormal);
+	offsetCrossNormalCrossOffset += otheroffsetCrossNormalCrossOffset;
 
-		double impulseCoefficient = -(1 + coefficientOfRestitution) / ((1 / mass) + (1 / otherMass) + idontevenknowanymore);
+	Scalar idontevenknowanymore = DotProduct(offsetCrossNormalCrossOffset, collisionNormal);
 
-		//double impulseCoefficient = (1 + coefficientOfRestitution) / ((1 / mass) + (1 / otherMass) + (offsetCrossNormal / momentOfInertia) + (otherOffsetCrossNormal / otherMomentOfInertia));
+	Scalar inverseEffectiveMass = inverseMass + otherInverseMass + idontevenknowanymore;
+	if (inverseEffectiveMass == 0.0f)
+	{
+		return; //Neither can move
+	}
+	Scalar impulseCoefficient = -(1 + coefficientOfRestitution) / inverseEffectiveMass;
 
+	//Scalar impulseCoefficient = (1 + coefficientOfRestitution) / ((1 / mass) + (1 / otherMass) + (offsetCrossNormal / momentOfInertia) + (otherOffsetCrossNormal / otherMomentOfInertia));
 
-		
-		//KEngine2D::Point impulse = Project(collisionNormal, relativeVelocity);
-		KEngine2D::Point impulse = collisionNormal;
-		impulse *= impulseCoefficient;
-		
-		KEngine2D::Point otherImpulse = -impulse;
-		float kinetic1 = GetEnergy() + other.GetEnergy();
-		ApplyImpulse(impulse, offset);
-		other.ApplyImpulse(otherImpulse, otherOffset);
 
-		KEngine2D::Point postVelocity = KEngine2D::Project(collisionNormal, GetVelocity(offset));
-		KEngine2D::Point postOtherVelocity = KEngine2D::Project(collisionNormal, other.GetVelocity(otherOffset));
-		KEngine2D::Point postRelativeVelocity = postOtherVelocity;
-		postRelativeVelocity -= postVelocity;
+	
+	//KEngine2D::Point impulse = Project(collisionNormal, relativeVelocity);
+	KEngine2D::Point impulse = collisionNormal;
+	impulse *= impulseCoefficient;
+	
+	KEngine2D::Point otherImpulse = -impulse;
+	Scalar kinetic1 = GetEnergy() + other.GetEnergy();
+	ApplyImpulse(impulse, offset);
+	other.ApplyImpulse(otherImpulse, otherOffset);
+
+	KEngine2D::Point postVelocity = KEngine2D::Project(collisionNormal, GetVelocity(offset));
+	KEngine2D::Point postOtherVelocity = KEngine2D::Project(collisionNormal, other.GetVelocity(otherOffset));
+	KEngine2D::Point postRelativeVelocity = postOtherVelocity;
+	postRelativeVelocity -= postVelocity;
 
-		float kinetic2 = GetEnergy() + other.GetEnergy();
-		float left = DotProduct(postRelativeVelocity, collisionNormal);
-		float right = -coefficientOfRestitution * DotProduct(relativeVelocity, collisionNormal);
-		assert(left - right < 5.0 && left - right > -5.0);
+	Scalar kinetic2 = GetEnergy() + other.GetEnergy();
+	Scalar left = DotProduct(postRelativeVelocity, collisionNormal);
+	Scalar right = -coefficientOfRestitution * DotProduct(relativeVelocity, collisionNormal);
+	assert(left - right < 5.0 && left - right > -5.0);
 
-		//assert(kinetic2 < 1.1 * kinetic1 && kinetic1 < 1.1 * kinetic2);
-		return true;
-	}
-	return false;
+	//assert(kinetic2 < 1.1 * kinetic1 && kinetic1 < 1.1 * kinetic2);
 }
 
 bool KEngine2D::PhysicalObject::CheckAndResolveCollision( KEngine2D::BoundaryLine const & other )
 {
+	mCollisionVolume->UpdatePoses();
 	CollisionInfo possibleCollision = mCollisionVolume->Collides(other);
-	if (possibleCollision.collides)
+	if (possibleCollision.collides && !HasInfiniteMass())
 	{
 		Point offset = possibleCollision.collisionPoint;
 		offset -= mMechanics->GetTranslation();
@@ -196,9 +310,9 @@ bool KEngine2D::PhysicalObject::CheckAndResolveCollision( KEngine2D::BoundaryLin
 		Point impulse = KEngine2D::Project(collisionNormal, deltaVelocity, true);
 		impulse *= (2.0f * GetMass());
 
-		float kinetic1 = GetEnergy();
+		Scalar kinetic1 = GetEnergy();
 		ApplyImpulse(impulse, offset);
-		float kinetic2 = GetEnergy();
+		Scalar kinetic2 = GetEnergy();
 		//assert(kinetic2 < 1.5 * kinetic1 && kinetic1 < 1.5 * kinetic2);
 		return true;
 	}
@@ -207,7 +321,19 @@ bool KEngine2D::PhysicalObject::CheckAndResolveCollision( KEngine2D::BoundaryLin
 
 KEngine2D::PhysicsSystem::PhysicsSystem()
 {
-	
+	mBroadphase = &mSweepAndPrune;
+	mBatching = false;
+	mStaticBody = { Point::Origin(), Point::Origin(), 0.0f, 0.0f, 0.0f };
+	mThreadCount = 1;
+	mVelocityIterations = 8;
+	mTimeStep = 0.0f;
+	mAllocationsAllowed = true;
+	mNextSleepGroup = 0;
+	mLinearSleepVelocity = 0.01f;
+	mAngularSleepVelocity = 0.035f; //About two degrees a second
+	mTimeToSleep = 0.5f;
+	mSleepingEnabled = true;
+	mStatistics = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 }
 
 KEngine2D::PhysicsSystem::~PhysicsSystem()
@@ -215,45 +341,1071 @@ KEngine2D::PhysicsSystem::~PhysicsSystem()
 	Deinit();
 }
 
-void KEngine2D::PhysicsSystem::Init()
+void KEngine2D::PhysicsSystem::Init(BroadphaseType broadphaseType /*= BroadphaseType::SweepAndPrune*/, Scalar gridCellSize /*= 1.0f*/, Scalar treeMargin /*= 0.1f*/)
 {
-	
+	switch (broadphaseType)
+	{
+	case BroadphaseType::BruteForce:
+		mBruteForce.Init();
+		mBroadphase = &mBruteForce;
+		break;
+	case BroadphaseType::SweepAndPrune:
+		mSweepAndPrune.Init();
+		mBroadphase = &mSweepAndPrune;
+		break;
+	case BroadphaseType::SpatialGrid:
+		mSpatialGrid.Init(gridCellSize);
+		mBroadphase = &mSpatialGrid;
+		break;
+	case BroadphaseType::AABBTree:
+		mAABBTree.Init(treeMargin);
+		mBroadphase = &mAABBTree;
+		break;
+	}
+	for (size_t i = 0; i < mPhysicalObjects.size(); i++)  //In case anything was added before Init
+	{
+		mBroadphase->AddProxy((int)i);
+	}
+	if (mWorkerPool.GetThreadCount() != mThreadCount)  //Deinit let the workers go
+	{
+		mWorkerPool.Deinit();
+		mWorkerPool.Init(mThreadCount);
+	}
+	mStatistics = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 }
 
 void KEngine2D::PhysicsSystem::Deinit()
 {
 	mBoundaries.clear();
+	for (PhysicalObject * physicalObject : mPhysicalObjects)
+	{
+		if (physicalObject != nullptr)
+		{
+			physicalObject->mSystemIndex = -1;
+		}
+	}
 	mPhysicalObjects.clear();
+	mBatching = false;
+	mBatchedAdds.clear();
+	mBatchedRemoves.clear();
+	for (int body = 0; body < mBodyPool.GetCapacity(); body++)
+	{
+		if (mBodyPool.IsLive(body))
+		{
+			DestroyBody({ body, mBodyPool.GetGeneration(body) });
+		}
+	}
+	mBruteForce.Deinit();
+	mSweepAndPrune.Deinit();
+	mSpatialGrid.Deinit();
+	mAABBTree.Deinit();
+	mQueryProxies.clear();
+	mWorkerPool.Deinit();
+	mPairManifoldStarts.clear();
+	mPairManifoldCursors.clear();
+	mManifolds.clear();
+	mManifoldOwners.clear();
+	mContactCache.clear();
+	mCircleBatch.Clear();
+	mBatchedPairs.clear();
+	mGeneralPairs.clear();
+	mBatchHitIndices.clear();
+	mBatchHits.clear();
+	mNarrowphaseChunks.clear();
+	mIslandParents.clear();
+	mObjectIslands.clear();
+	mIslandStarts.clear();
+	mIslandCursors.clear();
+	mIslandObjects.clear();
+	mSolverBodies.clear();
+	mConstraints.clear();
+	mIslandConstraintStarts.clear();
+	mIslandConstraintCursors.clear();
+	mSleepTimes.clear();
+	mSleepGroups.clear();
+	mWokenSleepGroups.clear();
+	mBoundingBoxes.clear();
+	mPairs.clear();
+	mContinuousImpacts.clear();
 }
 
 void KEngine2D::PhysicsSystem::Update( double fTime )
 {
-	for (auto it = mPhysicalObjects.begin(); it != mPhysicalObjects.end(); it++)
+	assert(!mBatching);
+	AllocationCounter::Begin();
+	mTimeStep = fTime;
+	WakeSleepGroups();
+
+	//Asleep objects haven't moved, so their poses and boxes are still good.  Everything after this works from the snapshots.
+	//Mass properties are checked here as well, so the islands, which run in parallel, only ever read them.
+	for (size_t i = 0; i < mPhysicalObjects.size(); i++)
 	{
-		PhysicalObject * physicalObject = *it;
-		bool foundCollision = false;
-		for (auto boundaryIt = mBoundaries.begin(); boundaryIt != mBoundaries.end() && !foundCollision; boundaryIt++)
+		if (mPhysicalObjects[i]->IsAwake())
+		{
+			mPhysicalObjects[i]->GetCollisionVolume()->UpdatePoses();
+			mBoundingBoxes[i] = mPhysicalObjects[i]->GetAxisAlignedBoundingBox();
+		}
+		mPhysicalObjects[i]->UpdateMassProperties();
+	}
+	SweepContinuousObjects();
+	mBroadphase->FindPairs(mBoundingBoxes, mPairs);
+	mPairs.erase(std::remove_if(mPairs.begin(), mPairs.end(), [this](BroadphasePair const & pair) {
+		return !mPhysicalObjects[pair.first]->IsAwake() && !mPhysicalObjects[pair.second]->IsAwake();
+	}), mPairs.end());
+
+	//Nothing in here moves objects, so every contact can be found up front.  Boundaries don't join islands, so their
+	//contacts are found once the islands are built and woken, so anything woken this step still gets them.
+	RunNarrowphase();
+	BuildIslands();
+	WakeTouchedIslands();
+	RunBoundaryNarrowphase();
+	WarmStart();
+	BuildConstraints();
+
+	//Islands don't share any objects, so they can be solved in any order on any thread and still get the same answer
+	int islandCount = (int)mIslandStarts.size() - 1;
+	mWorkerPool.ParallelFor(islandCount, 16, [this](int island) {
+		SolveIsland(island);
+		UpdateSleep(island);
+	});
+	mNextSleepGroup += islandCount;
+	UpdateContactCache();
+	AdvanceContinuousObjects();
+
+	mStatistics.objectCount = (int)mPhysicalObjects.size();
+	mStatistics.candidatePairCount = (int)mPairs.size();
+	mStatistics.collisionCount = (int)mManifolds.size();
+	mStatistics.islandCount = islandCount;
+	mStatistics.contactPointCount = 0;
+	for (ContactManifold const & manifold : mManifolds)
+	{
+		mStatistics.contactPointCount += manifold.pointCount;
+	}
+	mStatistics.awakeCount = 0;
+	for (PhysicalObject const * physicalObject : mPhysicalObjects)
+	{
+		if (physicalObject->IsAwake())
+		{
+			mStatistics.awakeCount++;
+		}
+	}
+	mStatistics.asleepCount = mStatistics.objectCount - mStatistics.awakeCount;
+	mStatistics.continuousImpactCount = (int)mContinuousImpacts.size();
+	mStatistics.allocationCount = (int)AllocationCounter::End();
+	assert(mAllocationsAllowed || mStatistics.allocationCount == 0);
+}
+
+void KEngine2D::PhysicsSystem::Reserve(int objectCount, int pairCount)
+{
+	constexpr int chunkSize = NarrowphaseChunkSize;
+	assert(objectCount >= 0 && pairCount >= 0);
+	mPhysicalObjects.reserve(objectCount);
+	mBoundingBoxes.reserve(objectCount);
+	mSleepTimes.reserve(objectCount);
+	mSleepGroups.reserve(objectCount);
+	mWokenSleepGroups.reserve(objectCount);
+	mContinuousImpacts.reserve(objectCount);
+	mSweepProxies.reserve(objectCount);
+	mBroadphase->Reserve(objectCount);
+
+	mPairs.reserve(pairCount);
+	mCircleBatch.Reserve(pairCount);
+	mBatchedPairs.reserve(pairCount);
+	mGeneralPairs.reserve(pairCount);
+	mBatchHitIndices.reserve(pairCount);
+	mBatchHits.reserve(pairCount);
+	int chunkCount = (std::max(pairCount, objectCount) + chunkSize - 1) / chunkSize;
+	if ((int)mNarrowphaseChunks.size() < chunkCount)
+	{
+		mNarrowphaseChunks.resize(chunkCount);
+	}
+	for (NarrowphaseChunk & chunk : mNarrowphaseChunks)
+	{
+		chunk.pairs.reserve(chunkSize);
+		chunk.manifolds.reserve(chunkSize);
+		chunk.boundaryObjects.reserve(chunkSize);
+		chunk.boundaries.reserve(chunkSize);
+		chunk.boundaryManifolds.reserve(chunkSize);
+	}
+
+	//Boundary contacts come on top of the pair contacts, so leave room for one for each object as well
+	int manifoldCount = pairCount + objectCount;
+	mPairManifoldStarts.reserve(pairCount + 1);
+	mPairManifoldCursors.reserve(pairCount);
+	mManifolds.reserve(manifoldCount);
+	mManifoldOwners.reserve(manifoldCount);
+	mContactCache.reserve(manifoldCount);
+	mConstraints.reserve(manifoldCount);
+
+	mIslandParents.reserve(objectCount);
+	mObjectIslands.reserve(objectCount);
+	mIslandStarts.reserve(objectCount + 1);
+	mIslandCursors.reserve(objectCount);
+	mIslandObjects.reserve(objectCount);
+	mIslandConstraintStarts.reserve(objectCount + 1);
+	mIslandConstraintCursors.reserve(objectCount);
+	mSolverBodies.reserve(objectCount);
+}
+
+void KEngine2D::PhysicsSystem::SetAllocationsAllowed(bool allocationsAllowed)
+{
+	mAllocationsAllowed = allocationsAllowed;
+}
+
+void KEngine2D::PhysicsSystem::SweepContinuousObjects()
+{
+	mContinuousImpacts.clear();
+	bool broadphaseUpdated = false;
+	for (int object = 0; object < (int)mPhysicalObjects.size(); object++)
+	{
+		PhysicalObject * physicalObject = mPhysicalObjects[object];
+		if (!physicalObject->GetContinuousCollision() || !physicalObject->IsAwake())
+		{
+			continue;
+		}
+		if (!broadphaseUpdated)
+		{
+			//Sweeps ask the broadphase what's in their way, so it has to know where everything is before it finds this update's pairs
+			mBroadphase->UpdateProxies(mBoundingBoxes);
+			broadphaseUpdated = true;
+		}
+		MechanicalTransform * mechanics = physicalObject->GetMechanics();
+		Point start = mechanics->GetPreviousTransform().GetTranslation();
+		Point end = mechanics->GetTranslation();
+		Scalar fraction;
+		if ((start.x != end.x || start.y != end.y) && SweepObject(object, start, end, fraction))
+		{
+			mechanics->SetCurrentTransform(mechanics->GetInterpolatedTransform(fraction), false);
+			physicalObject->GetCollisionVolume()->UpdatePoses();
+			mBoundingBoxes[object] = physicalObject->GetAxisAlignedBoundingBox();
+			mContinuousImpacts.push_back({ object, 1.0f - fraction });
+		}
+	}
+}
+
+//Moves on with the solved velocity for the rest of the step, stopping short of anything else in the way until the next update
+void KEngine2D::PhysicsSystem::AdvanceContinuousObjects()
+{
+	for (ContinuousImpact const & impact : mContinuousImpacts)
+	{
+		MechanicalTransform * mechanics = mPhysicalObjects[impact.object]->GetMechanics();
+		if (!mechanics->IsAwake())
+		{
+			continue;
+		}
+		double remainingTime = impact.remainingFraction * mTimeStep;
+		Point start = mechanics->GetTranslation();
+		Point delta = mechanics->GetVelocity();
+		delta *= remainingTime;
+		Point end = start;
+		end += delta;
+		Scalar fraction = 1.0f;
+		SweepObject(impact.object, start, end, fraction);
+		delta *= fraction;
+		start += delta;
+		Scalar rotation = mechanics->GetRotation() + (mechanics->GetAngularVelocity() * remainingTime * fraction);
+		mechanics->SetCurrentTransform(StaticTransform(start, rotation, mechanics->GetScale()), false);
+	}
+}
+
+struct ShapeCenterVisitor
+{
+	typedef KEngine2D::Point Result;
+
+	template <typename Shape>
+	Result operator()(Shape const & shape) const { return shape.GetCenter(); }
+};
+
+struct InnerRadiusVisitor
+{
+	typedef KEngine2D::Scalar Result;
+
+	template <typename Shape>
+	Result operator()(Shape const & shape) const { return shape.GetInnerRadius(); }
+};
+
+//Shapes are swept as the largest circle that fits inside them, which is enough to keep them from passing through things
+bool KEngine2D::PhysicsSystem::SweepObject(int object, Point const & start, Point const & end, Scalar & fraction)
+{
+	BoundingArea * area = mPhysicalObjects[object]->GetCollisionVolume();
+	Point translation = mPhysicalObjects[object]->GetMechanics()->GetTranslation();
+	bool hit = false;
+	Scalar shapeFraction;
+	for (BoundingShape const & shape : area->GetShapes())
+	{
+		Point offset = shape.Visit(ShapeCenterVisitor());
+		offset -= translation;
+		Point shapeStart = start;
+		shapeStart += offset;
+		Point shapeEnd = end;
+		shapeEnd += offset;
+		Scalar radius = shape.Visit(InnerRadiusVisitor());
+		if (SweepCircle(object, shapeStart, shapeEnd, radius, shapeFraction) && (!hit || shapeFraction < fraction))
+		{
+			fraction = shapeFraction;
+			hit = true;
+		}
+	}
+	return hit;
+}
+
+//Everything else is taken to be standing still where it ended up this step
+bool KEngine2D::PhysicsSystem::SweepCircle(int object, Point const & start, Point const & end, Scalar radius, Scalar & fraction)
+{
+	constexpr Scalar allowedPenetration = 0.005f; //Stops just inside, so the narrowphase sees the contact
+	radius = std::max(radius - allowedPenetration, (Scalar)0.0);
+	AxisAlignedBoundingBox sweptBox = { { std::min(start.x, end.x) - radius, std::min(start.y, end.y) - radius }, { std::max(start.x, end.x) + radius, std::max(start.y, end.y) + radius } };
+
+	bool hit = false;
+	Scalar targetFraction;
+	for (BoundaryLine const * boundary : mBoundaries)
+	{
+		if (boundary->SweepCircle(start, end, radius, targetFraction) && (!hit || targetFraction < fraction))
+		{
+			fraction = targetFraction;
+			hit = true;
+		}
+	}
+	mBroadphase->QueryRegion(mBoundingBoxes, sweptBox, mSweepProxies);
+	for (int other : mSweepProxies)
+	{
+		if (other != object &&
+			mPhysicalObjects[other]->GetCollisionVolume()->SweepCircle(start, end, radius, targetFraction) && (!hit || targetFraction < fraction))
+		{
+			fraction = targetFraction;
+			hit = true;
+		}
+	}
+	//Objects already caught this update may have been moved since the broadphase last saw them
+	for (ContinuousImpact const & impact : mContinuousImpacts)
+	{
+		if (impact.object != object &&
+			mPhysicalObjects[impact.object]->GetCollisionVolume()->SweepCircle(start, end, radius, targetFraction) && (!hit || targetFraction < fraction))
+		{
+			fraction = targetFraction;
+			hit = true;
+		}
+	}
+	return hit;
+}
+
+void KEngine2D::PhysicsSystem::RunNarrowphase()
+{
+	constexpr int chunkSize = NarrowphaseChunkSize;
+
+	mCircleBatch.Clear();
+	mBatchedPairs.clear();
+	mGeneralPairs.clear();
+	for (size_t pairIndex = 0; pairIndex < mPairs.size(); pairIndex++)
+	{
+		BoundingArea * area = mPhysicalObjects[mPairs[pairIndex].first]->GetCollisionVolume();
+		BoundingArea * otherArea = mPhysicalObjects[mPairs[pairIndex].second]->GetCollisionVolume();
+		std::vector<BoundingShape> const & shapes = area->GetShapes();
+		std::vector<BoundingShape> const & otherShapes = otherArea->GetShapes();
+		if (shapes.size() == 1 && shapes[0].GetType() == ShapeType::Circle && otherShapes.size() == 1 && otherShapes[0].GetType() == ShapeType::Circle)
+		{
+			mBatchedPairs.push_back((int)pairIndex);
+			mCircleBatch.AddPair(shapes[0].GetCircle(), otherShapes[0].GetCircle());
+		}
+		else
+		{
+			mGeneralPairs.push_back((int)pairIndex);
+		}
+	}
+
+	mCircleBatch.Collide(mBatchHitIndices, mBatchHits);
+
+	//Each chunk takes a run of the general pairs, and later a run of objects to test against the boundaries.
+	//Chunks are fixed no matter how many threads there are, and only ever grow, so their storage gets reused frame to frame.
+	int chunkCount = ((int)mGeneralPairs.size() + chunkSize - 1) / chunkSize;
+	if ((int)mNarrowphaseChunks.size() < chunkCount)
+	{
+		mNarrowphaseChunks.resize(chunkCount);
+	}
+	mWorkerPool.ParallelFor(chunkCount, 1, [this, chunkSize](int chunkIndex) {
+		NarrowphaseChunk & chunk = mNarrowphaseChunks[chunkIndex];
+		chunk.pairs.clear();
+		chunk.manifolds.clear();
+		int end = std::min((chunkIndex + 1) * chunkSize, (int)mGeneralPairs.size());
+		for (int generalPair = chunkIndex * chunkSize; generalPair < end; generalPair++)
+		{
+			int pairIndex = mGeneralPairs[generalPair];
+			BoundingArea const * area = mPhysicalObjects[mPairs[pairIndex].first]->GetCollisionVolume();
+			BoundingArea const * otherArea = mPhysicalObjects[mPairs[pairIndex].second]->GetCollisionVolume();
+			area->GetManifolds(*otherArea, chunk.manifolds);
+			chunk.pairs.resize(chunk.manifolds.size(), pairIndex);
+		}
+	});
+
+	//Gather everything back in pair order.  Each pair's manifolds all come from one place, so their order is kept.
+	mPairManifoldStarts.assign(mPairs.size() + 1, 0);
+	for (int hitIndex : mBatchHitIndices)
+	{
+		mPairManifoldStarts[mBatchedPairs[hitIndex] + 1]++;
+	}
+	for (int chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+	{
+		for (int pairIndex : mNarrowphaseChunks[chunkIndex].pairs)
+		{
+			mPairManifoldStarts[pairIndex + 1]++;
+		}
+	}
+	for (size_t i = 1; i < mPairManifoldStarts.size(); i++)
+	{
+		mPairManifoldStarts[i] += mPairManifoldStarts[i - 1];
+	}
+	int pairManifoldCount = mPairManifoldStarts.back();
+	mPairManifoldCursors.assign(mPairManifoldStarts.begin(), mPairManifoldStarts.end() - 1);
+	mManifolds.resize(pairManifoldCount);
+	mManifoldOwners.resize(pairManifoldCount);
+	for (size_t hit = 0; hit < mBatchHitIndices.size(); hit++)
+	{
+		mManifolds[mPairManifoldCursors[mBatchedPairs[mBatchHitIndices[hit]]]++] = mBatchHits[hit];
+	}
+	for (int chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+	{
+		NarrowphaseChunk const & chunk = mNarrowphaseChunks[chunkIndex];
+		for (size_t i = 0; i < chunk.pairs.size(); i++)
+		{
+			mManifolds[mPairManifoldCursors[chunk.pairs[i]]++] = chunk.manifolds[i];
+		}
+	}
+	for (size_t pairIndex = 0; pairIndex < mPairs.size(); pairIndex++)
+	{
+		for (int manifold = mPairManifoldStarts[pairIndex]; manifold < mPairManifoldStarts[pairIndex + 1]; manifold++)
+		{
+			mManifoldOwners[manifold] = { mPairs[pairIndex].first, mPairs[pairIndex].second, -1 };
+		}
+	}
+
+}
+
+//Every awake object against every boundary, in the same fixed chunks as the pairs.  The manifolds go after the pairs'.
+void KEngine2D::PhysicsSystem::RunBoundaryNarrowphase()
+{
+	constexpr int chunkSize = NarrowphaseChunkSize;
+	int objectCount = (int)mPhysicalObjects.size();
+	int chunkCount = (objectCount + chunkSize - 1) / chunkSize;
+	if ((int)mNarrowphaseChunks.size() < chunkCount)
+	{
+		mNarrowphaseChunks.resize(chunkCount);
+	}
+	mWorkerPool.ParallelFor(chunkCount, 1, [this, chunkSize, objectCount](int chunkIndex) {
+		NarrowphaseChunk & chunk = mNarrowphaseChunks[chunkIndex];
+		chunk.boundaryObjects.clear();
+		chunk.boundaries.clear();
+		chunk.boundaryManifolds.clear();
+		int end = std::min((chunkIndex + 1) * chunkSize, objectCount);
+		for (int object = chunkIndex * chunkSize; object < end; object++)
+		{
+			if (!mPhysicalObjects[object]->IsAwake())
+			{
+				continue;
+			}
+			BoundingArea const * area = mPhysicalObjects[object]->GetCollisionVolume();
+			for (int boundary = 0; boundary < (int)mBoundaries.size(); boundary++)
+			{
+				area->GetManifolds(*mBoundaries[boundary], chunk.boundaryManifolds);
+				chunk.boundaryObjects.resize(chunk.boundaryManifolds.size(), object);
+				chunk.boundaries.resize(chunk.boundaryManifolds.size(), boundary);
+			}
+		}
+	});
+
+	//Chunks cover objects in order, so the boundary manifolds come out in object order already
+	int manifold = (int)mManifolds.size();
+	int manifoldCount = manifold;
+	for (int chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+	{
+		manifoldCount += (int)mNarrowphaseChunks[chunkIndex].boundaryManifolds.size();
+	}
+	mManifolds.resize(manifoldCount);
+	mManifoldOwners.resize(manifoldCount);
+	for (int chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+	{
+		NarrowphaseChunk const & chunk = mNarrowphaseChunks[chunkIndex];
+		for (size_t i = 0; i < chunk.boundaryManifolds.size(); i++, manifold++)
+		{
+			mManifolds[manifold] = chunk.boundaryManifolds[i];
+			mManifoldOwners[manifold] = { chunk.boundaryObjects[i], -1, chunk.boundaries[i] };
+		}
+	}
+}
+
+bool KEngine2D::PhysicsSystem::CachedManifoldPrecedes(CachedManifold const & manifold, CachedManifold const & other)
+{
+	if (manifold.object != other.object)
+	{
+		return std::less<PhysicalObject const *>()(manifold.object, other.object);
+	}
+	if (manifold.otherObject != other.otherObject)
+	{
+		return std::less<PhysicalObject const *>()(manifold.otherObject, other.otherObject);
+	}
+	if (manifold.boundary != other.boundary)
+	{
+		return std::less<BoundaryLine const *>()(manifold.boundary, other.boundary);
+	}
+	if (manifold.shape != other.shape)
+	{
+		return manifold.shape < other.shape;
+	}
+	return manifold.otherShape < other.otherShape;
+}
+
+KEngine2D::PhysicsSystem::CachedManifold KEngine2D::PhysicsSystem::GetCacheKey(int manifold) const
+{
+	ManifoldOwner const & owner = mManifoldOwners[manifold];
+	CachedManifold key;
+	key.object = mPhysicalObjects[owner.object];
+	key.otherObject = owner.otherObject >= 0 ? mPhysicalObjects[owner.otherObject] : nullptr;
+	key.boundary = owner.boundary >= 0 ? mBoundaries[owner.boundary] : nullptr;
+	key.shape = mManifolds[manifold].shape;
+	key.otherShape = mManifolds[manifold].otherShape;
+	key.pointCount = 0;
+	return key;
+}
+
+//Seeds each new contact point with the impulse its feature pair ended up with last frame
+void KEngine2D::PhysicsSystem::WarmStart()
+{
+	mStatistics.warmStartedPointCount = 0;
+	for (int manifoldIndex = 0; manifoldIndex < (int)mManifolds.size(); manifoldIndex++)
+	{
+		ContactManifold & manifold = mManifolds[manifoldIndex];
+		CachedManifold key = GetCacheKey(manifoldIndex);
+		auto cached = std::lower_bound(mContactCache.begin(), mContactCache.end(), key, CachedManifoldPrecedes);
+		bool found = cached != mContactCache.end() && !CachedManifoldPrecedes(key, *cached);
+		for (int i = 0; i < manifold.pointCount; i++)
+		{
+			ContactPoint & point = manifold.points[i];
+			point.normalImpulse = 0.0f;
+			for (int j = 0; found && j < cached->pointCount; j++)
+			{
+				if (cached->featureIds[j] == point.featureId)
+				{
+					point.normalImpulse = cached->normalImpulses[j];
+					mStatistics.warmStartedPointCount++;
+					break;
+				}
+			}
+		}
+	}
+}
+
+void KEngine2D::PhysicsSystem::UpdateContactCache()
+{
+	mContactCache.resize(mManifolds.size());
+	for (int manifoldIndex = 0; manifoldIndex < (int)mManifolds.size(); manifoldIndex++)
+	{
+		ContactManifold const & manifold = mManifolds[manifoldIndex];
+		CachedManifold & cached = mContactCache[manifoldIndex];
+		cached = GetCacheKey(manifoldIndex);
+		cached.pointCount = manifold.pointCount;
+		for (int i = 0; i < manifold.pointCount; i++)
+		{
+			cached.featureIds[i] = manifold.points[i].featureId;
+			cached.normalImpulses[i] = manifold.points[i].normalImpulse;
+		}
+	}
+	//Objects are kept by pointer, so removing one shifting the indices doesn't lose anyone's history
+	std::sort(mContactCache.begin(), mContactCache.end(), CachedManifoldPrecedes);
+}
+
+//Anything woken since the last update, from outside or by a contact, takes the rest of its group with it
+void KEngine2D::PhysicsSystem::WakeSleepGroups()
+{
+	for (size_t i = 0; i < mPhysicalObjects.size(); i++)
+	{
+		if (mSleepGroups[i] != NoSleepGroup && mPhysicalObjects[i]->IsAwake())
+		{
+			mWokenSleepGroups.push_back(mSleepGroups[i]);
+		}
+	}
+	if (mWokenSleepGroups.empty())
+	{
+		return;
+	}
+	std::sort(mWokenSleepGroups.begin(), mWokenSleepGroups.end());
+	for (size_t i = 0; i < mPhysicalObjects.size(); i++)
+	{
+		if (mSleepGroups[i] != NoSleepGroup && std::binary_search(mWokenSleepGroups.begin(), mWokenSleepGroups.end(), mSleepGroups[i]))
+		{
+			mPhysicalObjects[i]->WakeUp();
+			mSleepGroups[i] = NoSleepGroup;
+			mSleepTimes[i] = 0.0f;
+		}
+	}
+	mWokenSleepGroups.clear();
+}
+
+//Union-find over the touching pairs.  Roots are always the lowest object in their island.
+void KEngine2D::PhysicsSystem::BuildIslands()
+{
+	int objectCount = (int)mPhysicalObjects.size();
+	mIslandParents.resize(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		mIslandParents[i] = i;
+	}
+	for (ManifoldOwner const & owner : mManifoldOwners)
+	{
+		if (owner.otherObject >= 0)  //Boundaries don't move, so they don't tie objects together
 		{
-			KEngine2D::BoundaryLine * boundaryLine = *boundaryIt;
-			foundCollision = physicalObject->CheckAndResolveCollision(*boundaryLine);
+			int root = FindIslandRoot(owner.object);
+			int otherRoot = FindIslandRoot(owner.otherObject);
+			if (root < otherRoot)
+			{
+				mIslandParents[otherRoot] = root;
+			}
+			else if (otherRoot < root)
+			{
+				mIslandParents[root] = otherRoot;
+			}
+		}
+	}
+
+	int islandCount = 0;
+	mObjectIslands.resize(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		int root = FindIslandRoot(i);
+		mObjectIslands[i] = root == i ? islandCount++ : mObjectIslands[root];
+	}
+
+	mIslandStarts.assign(islandCount + 1, 0);
+	for (int i = 0; i < objectCount; i++)
+	{
+		mIslandStarts[mObjectIslands[i] + 1]++;
+	}
+	for (int island = 1; island <= islandCount; island++)
+	{
+		mIslandStarts[island] += mIslandStarts[island - 1];
+	}
+	mIslandCursors.assign(mIslandStarts.begin(), mIslandStarts.end() - 1);
+	mIslandObjects.resize(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		mIslandObjects[mIslandCursors[mObjectIslands[i]]++] = i;
+	}
+}
+
+int KEngine2D::PhysicsSystem::FindIslandRoot(int object)
+{
+	while (mIslandParents[object] != object)
+	{
+		mIslandParents[object] = mIslandParents[mIslandParents[object]]; //Path halving
+		object = mIslandParents[object];
+	}
+	return object;
+}
+
+//An awake object touching an asleep one wakes the whole island up
+void KEngine2D::PhysicsSystem::WakeTouchedIslands()
+{
+	bool wokeAny = false;
+	int islandCount = (int)mIslandStarts.size() - 1;
+	for (int island = 0; island < islandCount; island++)
+	{
+		int awakeCount = 0;
+		for (int i = mIslandStarts[island]; i < mIslandStarts[island + 1]; i++)
+		{
+			if (mPhysicalObjects[mIslandObjects[i]]->IsAwake())
+			{
+				awakeCount++;
+			}
+		}
+		if (awakeCount == 0 || awakeCount == mIslandStarts[island + 1] - mIslandStarts[island])
+		{
+			continue;
+		}
+		for (int i = mIslandStarts[island]; i < mIslandStarts[island + 1]; i++)
+		{
+			mPhysicalObjects[mIslandObjects[i]]->WakeUp();
+		}
+		wokeAny = true;
+	}
+	if (wokeAny)
+	{
+		WakeSleepGroups();
+	}
+}
+
+//One constraint per manifold, grouped by island and in manifold order within each island
+void KEngine2D::PhysicsSystem::BuildConstraints()
+{
+	int islandCount = (int)mIslandStarts.size() - 1;
+	mIslandConstraintStarts.assign(islandCount + 1, 0);
+	for (ManifoldOwner const & owner : mManifoldOwners)
+	{
+		mIslandConstraintStarts[mObjectIslands[owner.object] + 1]++;
+	}
+	for (int island = 1; island <= islandCount; island++)
+	{
+		mIslandConstraintStarts[island] += mIslandConstraintStarts[island - 1];
+	}
+	mIslandConstraintCursors.assign(mIslandConstraintStarts.begin(), mIslandConstraintStarts.end() - 1);
+	mConstraints.resize(mManifolds.size());
+	for (int manifold = 0; manifold < (int)mManifolds.size(); manifold++)
+	{
+		ManifoldOwner const & owner = mManifoldOwners[manifold];
+		ContactConstraint & constraint = mConstraints[mIslandConstraintCursors[mObjectIslands[owner.object]]++];
+		constraint.manifold = manifold;
+		constraint.object = owner.object;
+		constraint.otherObject = owner.otherObject;
+	}
+	mSolverBodies.resize(mPhysicalObjects.size());
+}
+
+void KEngine2D::PhysicsSystem::SolveIsland(int island)
+{
+	int constraintStart = mIslandConstraintStarts[island];
+	int constraintEnd = mIslandConstraintStarts[island + 1];
+	if (constraintStart == constraintEnd)
+	{
+		return;  //Nothing touching, so nothing to change
+	}
+
+	for (int i = mIslandStarts[island]; i < mIslandStarts[island + 1]; i++)
+	{
+		PhysicalObject const * physicalObject = mPhysicalObjects[mIslandObjects[i]];
+		MechanicalTransform const * mechanics = physicalObject->GetMechanics();
+		SolverBody & body = mSolverBodies[mIslandObjects[i]];
+		body.center = mechanics->GetTranslation();
+		body.velocity = mechanics->GetVelocity();
+		body.angularVelocity = mechanics->GetAngularVelocity();
+		body.inverseMass = physicalObject->GetInverseMass();
+		body.inverseMomentOfInertia = physicalObject->GetInverseMomentOfInertia();
+	}
+
+	for (int i = constraintStart; i < constraintEnd; i++)
+	{
+		PrepareConstraint(mConstraints[i]);
+	}
+	//Warm start, reapplying what was needed last frame
+	for (int i = constraintStart; i < constraintEnd; i++)
+	{
+		for (int point = 0; point < mConstraints[i].pointCount; point++)
+		{
+			ApplyConstraintImpulse(mConstraints[i], point, mConstraints[i].normalImpulses[point]);
+		}
+	}
+	for (int iteration = 0; iteration < mVelocityIterations; iteration++)
+	{
+		for (int i = constraintStart; i < constraintEnd; i++)
+		{
+			SolveConstraint(mConstraints[i]);
+		}
+	}
+	for (int i = constraintStart; i < constraintEnd; i++)
+	{
+		ContactConstraint const & constraint = mConstraints[i];
+		for (int point = 0; point < constraint.pointCount; point++)
+		{
+			mManifolds[constraint.manifold].points[point].normalImpulse = constraint.normalImpulses[point];
+		}
+	}
+
+	for (int i = mIslandStarts[island]; i < mIslandStarts[island + 1]; i++)
+	{
+		MechanicalTransform * mechanics = mPhysicalObjects[mIslandObjects[i]]->GetMechanics();
+		SolverBody const & body = mSolverBodies[mIslandObjects[i]];
+		mechanics->SetVelocity(body.velocity);
+		mechanics->SetAngularVelocity(body.angularVelocity);
+	}
+}
+
+void KEngine2D::PhysicsSystem::UpdateSleep(int island)
+{
+	if (!mSleepingEnabled)
+	{
+		return;
+	}
+	double minSleepTime = HUGE_VAL;
+	for (int i = mIslandStarts[island]; i < mIslandStarts[island + 1]; i++)
+	{
+		int object = mIslandObjects[i];
+		MechanicalTransform const * mechanics = mPhysicalObjects[object]->GetMechanics();
+		if (!mechanics->IsAwake())
+		{
+			return;  //Islands are all asleep or all awake by now
+		}
+		Point const & velocity = mechanics->GetVelocity();
+		Scalar angularVelocity = mechanics->GetAngularVelocity();
+		if (DotProduct(velocity, velocity) > mLinearSleepVelocity * mLinearSleepVelocity || angularVelocity * angularVelocity > mAngularSleepVelocity * mAngularSleepVelocity)
+		{
+			mSleepTimes[object] = 0.0f;
 		}
-		auto otherIt = it;
-		for ( otherIt++; otherIt != mPhysicalObjects.end() && !foundCollision; otherIt++)
+		else
 		{
-			PhysicalObject * otherPhysicalObject = *otherIt;
-			foundCollision = physicalObject->CheckAndResolveCollision(*otherPhysicalObject);
+			mSleepTimes[object] += mTimeStep;
 		}
+		minSleepTime = std::min(minSleepTime, mSleepTimes[object]);
+	}
+	if (minSleepTime < mTimeToSleep)
+	{
+		return;
+	}
+	for (int i = mIslandStarts[island]; i < mIslandStarts[island + 1]; i++)
+	{
+		int object = mIslandObjects[i];
+		MechanicalTransform * mechanics = mPhysicalObjects[object]->GetMechanics();
+		mechanics->SetVelocity(Point::Origin());
+		mechanics->SetAngularVelocity(0.0f);
+		mechanics->SetAwake(false);
+		mSleepGroups[object] = mNextSleepGroup + island;
+	}
+}
+
+void KEngine2D::PhysicsSystem::PrepareConstraint(ContactConstraint & constraint)
+{
+	constexpr Scalar coefficientOfRestitution = 1.0f;
+	constexpr Scalar restitutionThreshold = 1.0f; //Slower than this, contacts are resting and don't bounce
+	constexpr Scalar correctionFactor = 0.2f;     //Fraction of the overlap pushed out each update
+	constexpr Scalar allowedPenetration = 0.005f; //Left alone, so resting contacts stay touching
+
+	ContactManifold const & manifold = mManifolds[constraint.manifold];
+	SolverBody const & body = mSolverBodies[constraint.object];
+	SolverBody const & otherBody = constraint.otherObject >= 0 ? mSolverBodies[constraint.otherObject] : mStaticBody;
+	constraint.normal = manifold.normal;
+	constraint.pointCount = manifold.pointCount;
+	for (int i = 0; i < manifold.pointCount; i++)
+	{
+		ContactPoint const & point = manifold.points[i];
+		constraint.offsets[i] = point.point;
+		constraint.offsets[i] -= body.center;
+		constraint.otherOffsets[i] = point.point;
+		constraint.otherOffsets[i] -= otherBody.center;
+		constraint.normalImpulses[i] = point.normalImpulse;
+
+		Scalar offsetCrossNormal = PseudoCrossProduct(constraint.offsets[i], constraint.normal);
+		Scalar otherOffsetCrossNormal = PseudoCrossProduct(constraint.otherOffsets[i], constraint.normal);
+		Scalar inverseNormalMass = body.inverseMass + otherBody.inverseMass + (body.inverseMomentOfInertia * offsetCrossNormal * offsetCrossNormal) + (otherBody.inverseMomentOfInertia * otherOffsetCrossNormal * otherOffsetCrossNormal);
+		constraint.normalMasses[i] = inverseNormalMass > 0.0f ? 1.0f / inverseNormalMass : 0.0f;
+
+		//Restitution is worked out from the approach speed before any impulses this frame.  Slow contacts that have sunk in get eased apart instead.
+		Scalar normalVelocity = GetNormalVelocity(constraint, i);
+		if (normalVelocity < -restitutionThreshold)
+		{
+			constraint.velocityBiases[i] = -coefficientOfRestitution * normalVelocity;
+		}
+		else if (mTimeStep > 0.0f)
+		{
+			constraint.velocityBiases[i] = (correctionFactor / mTimeStep) * std::max(point.depth - allowedPenetration, (Scalar)0.0);
+		}
+		else
+		{
+			constraint.velocityBiases[i] = 0.0f;
+		}
+	}
+}
+
+//Relative velocity of the two contact points along the normal, negative when they're approaching
+KEngine2D::Scalar KEngine2D::PhysicsSystem::GetNormalVelocity(ContactConstraint const & constraint, int point) const
+{
+	SolverBody const & body = mSolverBodies[constraint.object];
+	SolverBody const & otherBody = constraint.otherObject >= 0 ? mSolverBodies[constraint.otherObject] : mStaticBody;
+	Point const & offset = constraint.offsets[point];
+	Point const & otherOffset = constraint.otherOffsets[point];
+	Point relativeVelocity = { otherBody.velocity.x - (otherBody.angularVelocity * otherOffset.y) - body.velocity.x + (body.angularVelocity * offset.y),
+							   otherBody.velocity.y + (otherBody.angularVelocity * otherOffset.x) - body.velocity.y - (body.angularVelocity * offset.x) };
+	return DotProduct(relativeVelocity, constraint.normal);
+}
+
+//Pushes the two bodies apart along the normal, the first one taking the negative side
+void KEngine2D::PhysicsSystem::ApplyConstraintImpulse(ContactConstraint const & constraint, int point, Scalar impulse)
+{
+	Point normalImpulse = constraint.normal;
+	normalImpulse *= impulse;
+	SolverBody & body = mSolverBodies[constraint.object];
+	body.velocity.x -= normalImpulse.x * body.inverseMass;
+	body.velocity.y -= normalImpulse.y * body.inverseMass;
+	body.angularVelocity -= body.inverseMomentOfInertia * PseudoCrossProduct(constraint.offsets[point], normalImpulse);
+	if (constraint.otherObject >= 0)
+	{
+		SolverBody & otherBody = mSolverBodies[constraint.otherObject];
+		otherBody.velocity.x += normalImpulse.x * otherBody.inverseMass;
+		otherBody.velocity.y += normalImpulse.y * otherBody.inverseMass;
+		otherBody.angularVelocity += otherBody.inverseMomentOfInertia * PseudoCrossProduct(constraint.otherOffsets[point], normalImpulse);
+	}
+}
+
+//The accumulated impulse is clamped rather than each step, so a warm start that turns out too strong gets taken back
+void KEngine2D::PhysicsSystem::SolveConstraint(ContactConstraint & constraint)
+{
+	for (int i = 0; i < constraint.pointCount; i++)
+	{
+		Scalar normalVelocity = GetNormalVelocity(constraint, i);
+		Scalar lambda = -constraint.normalMasses[i] * (normalVelocity - constraint.velocityBiases[i]);
+		Scalar newImpulse = std::max(constraint.normalImpulses[i] + lambda, (Scalar)0.0);
+		ApplyConstraintImpulse(constraint, i, newImpulse - constraint.normalImpulses[i]);
+		constraint.normalImpulses[i] = newImpulse;
 	}
 }
 
 void KEngine2D::PhysicsSystem::AddPhysicalObject( PhysicalObject * physicalObject )
 {
-	mPhysicalObjects.push_back(physicalObject);
+	if (mBatching)
+	{
+		mBatchedAdds.push_back(physicalObject);
+	}
+	else
+	{
+		InsertPhysicalObject(physicalObject);
+	}
 }
 
 void KEngine2D::PhysicsSystem::RemovePhysicalObject( PhysicalObject * physicalObject )
 {
-	mPhysicalObjects.erase(remove(mPhysicalObjects.begin(), mPhysicalObjects.end(), physicalObject));
+	int index = physicalObject->mSystemIndex;
+	if (index < 0 || index >= (int)mPhysicalObjects.size() || mPhysicalObjects[index] != physicalObject)
+	{
+		//Not in the lists, though it might be waiting to be added.  Batches are rarely big, so searching them is fine.
+		auto it = std::find(mBatchedAdds.begin(), mBatchedAdds.end(), physicalObject);
+		if (it != mBatchedAdds.end())
+		{
+			mBatchedAdds.erase(it);
+		}
+		return;
+	}
+	physicalObject->mSystemIndex = -1;
+	if (mBatching)
+	{
+		mPhysicalObjects[index] = nullptr;
+		mBatchedRemoves.push_back(index);
+	}
+	else
+	{
+		ErasePhysicalObject(index);
+	}
+}
+
+void KEngine2D::PhysicsSystem::BeginBatch()
+{
+	assert(!mBatching);
+	mBatching = true;
+}
+
+//Removals go highest index first, so the object moved into each hole is never one still waiting to go
+void KEngine2D::PhysicsSystem::EndBatch()
+{
+	assert(mBatching);
+	mBatching = false;
+	std::sort(mBatchedRemoves.begin(), mBatchedRemoves.end(), std::greater<int>());
+	for (int index : mBatchedRemoves)
+	{
+		ErasePhysicalObject(index);
+	}
+	mBatchedRemoves.clear();
+	for (PhysicalObject * physicalObject : mBatchedAdds)
+	{
+		InsertPhysicalObject(physicalObject);
+	}
+	mBatchedAdds.clear();
+}
+
+void KEngine2D::PhysicsSystem::InsertPhysicalObject(PhysicalObject * physicalObject)
+{
+	physicalObject->mSystemIndex = (int)mPhysicalObjects.size();
+	mBroadphase->AddProxy((int)mPhysicalObjects.size());
+	mPhysicalObjects.push_back(physicalObject);
+	physicalObject->GetCollisionVolume()->UpdatePoses();
+	mBoundingBoxes.push_back(physicalObject->GetAxisAlignedBoundingBox());
+	mSleepTimes.push_back(0.0f);
+	mSleepGroups.push_back(NoSleepGroup);
+	physicalObject->WakeUp();
+}
+
+void KEngine2D::PhysicsSystem::ErasePhysicalObject(int index)
+{
+	int last = (int)mPhysicalObjects.size() - 1;
+	mBroadphase->RemoveProxy(index);
+	if (index != last)
+	{
+		mPhysicalObjects[index] = mPhysicalObjects[last];
+		mBoundingBoxes[index] = mBoundingBoxes[last];
+		mSleepTimes[index] = mSleepTimes[last];
+		mSleepGroups[index] = mSleepGroups[last];
+		mPhysicalObjects[index]->mSystemIndex = index;
+	}
+	mPhysicalObjects.pop_back();
+	mBoundingBoxes.pop_back();
+	mSleepTimes.pop_back();
+	mSleepGroups.pop_back();
+}
+
+KEngine2D::PhysicsHandle KEngine2D::PhysicsSystem::CreateBody(MechanicsBatch * batch, Scalar mass, StaticTransform const & transform /*= StaticTransform::Identity()*/, Point const & velocity /*= Point::Origin()*/, Scalar angularVelocity /*= 0.0f*/)
+{
+	assert(batch != nullptr);
+	int slot = mBodyPool.Allocate();
+	PooledBody & body = mBodyPool.Get(slot);
+	body.mechanics.Init(batch, transform, velocity, angularVelocity);
+	body.area.Init(&body.mechanics);
+	body.object.Init(this, &body.mechanics, &body.area, mass);
+	return { slot, mBodyPool.GetGeneration(slot) };
+}
+
+void KEngine2D::PhysicsSystem::DestroyBody(PhysicsHandle body)
+{
+	if (!IsBodyValid(body))
+	{
+		return;
+	}
+	PooledBody & pooledBody = mBodyPool.Get(body.index);
+	pooledBody.object.Deinit();
+	pooledBody.area.Deinit();
+	pooledBody.mechanics.Deinit();
+	mBodyPool.Free(body.index);
+}
+
+bool KEngine2D::PhysicsSystem::IsBodyValid(PhysicsHandle body) const
+{
+	return mBodyPool.IsLive(body.index, body.generation);
+}
+
+KEngine2D::PhysicalObject * KEngine2D::PhysicsSystem::GetBody(PhysicsHandle body)
+{
+	return IsBodyValid(body) ? &mBodyPool.Get(body.index).object : nullptr;
+}
+
+void KEngine2D::PhysicsSystem::AddCircle(PhysicsHandle body, Scalar radius)
+{
+	assert(IsBodyValid(body));
+	PooledBody & pooledBody = mBodyPool.Get(body.index);
+	BoundingCircle circle;
+	circle.Init(&pooledBody.mechanics, radius);
+	pooledBody.area.AddBoundingCircle(&circle);
+	pooledBody.object.WakeUp(); //So its box gets refit with the new shape on the next update
+}
+
+void KEngine2D::PhysicsSystem::AddBox(PhysicsHandle body, Scalar width, Scalar height)
+{
+	assert(IsBodyValid(body));
+	PooledBody & pooledBody = mBodyPool.Get(body.index);
+	BoundingBox box;
+	box.Init(&pooledBody.mechanics, width, height);
+	pooledBody.area.AddBoundingBox(&box);
+	pooledBody.object.WakeUp();
+}
+
+void KEngine2D::PhysicsSystem::AddPolygon(PhysicsHandle body, Point const * vertices, int count)
+{
+	assert(IsBodyValid(body));
+	PooledBody & pooledBody = mBodyPool.Get(body.index);
+	BoundingPolygon polygon;
+	polygon.Init(&pooledBody.mechanics, vertices, count);
+	pooledBody.area.AddBoundingPolygon(&polygon);
+	pooledBody.object.WakeUp();
+}
+
+void KEngine2D::PhysicsSystem::AddCapsule(PhysicsHandle body, Scalar length, Scalar radius)
+{
+	assert(IsBodyValid(body));
+	PooledBody & pooledBody = mBodyPool.Get(body.index);
+	BoundingCapsule capsule;
+	capsule.Init(&pooledBody.mechanics, length, radius);
+	pooledBody.area.AddBoundingCapsule(&capsule);
+	pooledBody.object.WakeUp();
 }
 
 void KEngine2D::PhysicsSystem::AddBoundary( KEngine2D::BoundaryLine * boundary )
@@ -261,7 +1413,122 @@ void KEngine2D::PhysicsSystem::AddBoundary( KEngine2D::BoundaryLine * boundary )
 	mBoundaries.push_back(boundary);
 }
 
+//Order doesn't matter, so the last boundary can fill the gap
 void KEngine2D::PhysicsSystem::RemoveBoundary( KEngine2D::BoundaryLine * boundary )
 {
-    mBoundaries.erase(remove(mBoundaries.begin(), mBoundaries.end(), boundary));
+	auto it = std::find(mBoundaries.begin(), mBoundaries.end(), boundary);
+	if (it != mBoundaries.end())
+	{
+		*it = mBoundaries.back();
+		mBoundaries.pop_back();
+	}
 }
+
+void KEngine2D::PhysicsSystem::QueryRegion(AxisAlignedBoundingBox const & region, std::vector<PhysicalObject *> & results)
+{
+	results.clear();
+	if (mBroadphase == &mAABBTree)
+	{
+		mAABBTree.QueryRegion(region, mQueryProxies);
+		for (int proxy : mQueryProxies)
+		{
+			PhysicalObject * physicalObject = mPhysicalObjects[proxy];
+			if (physicalObject != nullptr && Overlaps(region, physicalObject->GetAxisAlignedBoundingBox()))
+			{
+				results.push_back(physicalObject);
+			}
+		}
+	}
+	else
+	{
+		for (PhysicalObject * physicalObject : mPhysicalObjects)
+		{
+			if (physicalObject != nullptr && Overlaps(region, physicalObject->GetAxisAlignedBoundingBox()))
+			{
+				results.push_back(physicalObject);
+			}
+		}
+	}
+}
+
+void KEngine2D::PhysicsSystem::QueryRay(Point const & start, Point const & end, std::vector<PhysicalObject *> & results)
+{
+	results.clear();
+	if (mBroadphase == &mAABBTree)
+	{
+		mAABBTree.QueryRay(start, end, mQueryProxies);
+		for (int proxy : mQueryProxies)
+		{
+			PhysicalObject * physicalObject = mPhysicalObjects[proxy];
+			if (physicalObject != nullptr && Intersects(physicalObject->GetAxisAlignedBoundingBox(), start, end))
+			{
+				results.push_back(physicalObject);
+			}
+		}
+	}
+	else
+	{
+		for (PhysicalObject * physicalObject : mPhysicalObjects)
+		{
+			if (physicalObject != nullptr && Intersects(physicalObject->GetAxisAlignedBoundingBox(), start, end))
+			{
+				results.push_back(physicalObject);
+			}
+		}
+	}
+}
+
+void KEngine2D::PhysicsSystem::SetThreadCount(int threadCount)
+{
+	assert(threadCount >= 1);
+	mThreadCount = threadCount;
+	mWorkerPool.Deinit();
+	mWorkerPool.Init(threadCount);
+}
+
+int KEngine2D::PhysicsSystem::GetThreadCount() const
+{
+	return mThreadCount;
+}
+
+void KEngine2D::PhysicsSystem::SetVelocityIterations(int velocityIterations)
+{
+	assert(velocityIterations >= 1);
+	mVelocityIterations = velocityIterations;
+}
+
+int KEngine2D::PhysicsSystem::GetVelocityIterations() const
+{
+	return mVelocityIterations;
+}
+
+void KEngine2D::PhysicsSystem::SetSleepThresholds(Scalar linearVelocity, Scalar angularVelocity, double timeToSleep)
+{
+	assert(linearVelocity >= 0.0f && angularVelocity >= 0.0f && timeToSleep >= 0.0f);
+	mLinearSleepVelocity = linearVelocity;
+	mAngularSleepVelocity = angularVelocity;
+	mTimeToSleep = timeToSleep;
+}
+
+void KEngine2D::PhysicsSystem::SetSleepingEnabled(bool sleepingEnabled)
+{
+	mSleepingEnabled = sleepingEnabled;
+	if (!sleepingEnabled)
+	{
+		for (size_t i = 0; i < mPhysicalObjects.size(); i++)
+		{
+			if (mPhysicalObjects[i] == nullptr)
+			{
+				continue; //Removed during a batch
+			}
+			mPhysicalObjects[i]->WakeUp();
+			mSleepGroups[i] = NoSleepGroup;
+			mSleepTimes[i] = 0.0f;
+		}
+	}
+}
+
+KEngine2D::PhysicsStatistics const & KEngine2D::PhysicsSystem::GetStatistics() const
+{
+	return mStatistics;
+}
\ No newline at end of file
@@ -2,6 +2,10 @@
 #include <vector>
 #include "MechanicalTransform2D.h"
 #include "Boundaries2D.h"
+#include "Broadphase2D.h"
+#include "CircleBatch2D.h"
+#include "WorkerPool2D.h"
+#include "Pool2D.h"
 
 namespace KEngine2D
 {
@@ -14,48 +18,301 @@ namespace KEngine2D
 		PhysicalObject();
 		~PhysicalObject();
 
-		void Init(PhysicsSystem * physicsSystem, MechanicalTransform * mechanics, BoundingArea * collisionVolume, double mass);
+		//A mass of zero or infinity makes an object nothing can move, with zero inverse mass and inertia
+		void Init(PhysicsSystem * physicsSystem, MechanicalTransform * mechanics, BoundingArea * collisionVolume, Scalar mass);
 		void Deinit();
 
-		double GetMass() const;
-		double GetMomentOfInertia() const;
-		void SetMass(double mass);
-		double GetEnergy() const;
+		//Inertia is worked out from the shapes once, and again only after shapes are added or removed or the scale changes
+		Scalar GetMass() const;
+		Scalar GetInverseMass() const;
+		Scalar GetMomentOfInertia() const;
+		Scalar GetInverseMomentOfInertia() const;
+		bool HasInfiniteMass() const;
+		void SetMass(Scalar mass);
+		Scalar GetEnergy() const;
+		AxisAlignedBoundingBox GetAxisAlignedBoundingBox() const;
+		BoundingArea * GetCollisionVolume() const;
+		MechanicalTransform * GetMechanics() const;
+
+		//Asleep objects aren't moved, tested against each other or solved until something touches their island
+		bool IsAwake() const;
+		void WakeUp();
+
+		//Swept against everything each update so it can't pass through boundaries or thin objects, for small fast movers
+		void SetContinuousCollision(bool continuousCollision);
+		bool GetContinuousCollision() const;
 
 		KEngine2D::Point GetVelocity(KEngine2D::Point const & offset = KEngine2D::Point::Origin()) const;
 		void ApplyImpulse(KEngine2D::Point const & impulse, KEngine2D::Point const & offset = KEngine2D::Point::Origin());
 
 		bool CheckAndResolveCollision(PhysicalObject & other);
+		void ResolveCollision(PhysicalObject & other, CollisionInfo const & collision);
 		bool CheckAndResolveCollision(KEngine2D::BoundaryLine const & other);
 
 	private:
-		double mMass;
+		friend class PhysicsSystem;
+
+		void UpdateMassProperties() const;
+
+		Scalar mMass;
+		Scalar mInverseMass;
+		mutable Scalar mMomentOfInertia;
+		mutable Scalar mInverseMomentOfInertia;
+		mutable bool mMassPropertiesValid;
+		mutable unsigned int mMassShapeVersion; //What the cached inertia was worked out from
+		mutable Scalar mMassScale;
 		MechanicalTransform * mMechanics;
 		PhysicsSystem * mPhysicsSystem;
 		BoundingArea * mCollisionVolume;
+		bool mContinuousCollision;
+		int mSystemIndex; //Where it is in the system's lists, so it can be taken out without a search.  -1 while not in them.
 	};
 
 
+	//Names a body the physics system owns.  Stays safe to hold on to after the body is destroyed, it just stops resolving.
+	struct PhysicsHandle
+	{
+		int index;
+		unsigned int generation; //0 is never valid
+	};
+
+	struct PhysicsStatistics
+	{
+		int objectCount;
+		int candidatePairCount; //Pairs the broadphase passed on to the narrowphase
+		int collisionCount; //Touching shape pairs, boundaries included
+		int islandCount; //Groups of touching objects, each resolved independently
+		int contactPointCount;
+		int warmStartedPointCount; //Contact points that picked up an impulse from the frame before
+		int awakeCount;
+		int asleepCount;
+		int continuousImpactCount; //Continuous objects that were caught before passing through something
+		int allocationCount; //Heap allocations the update made, only counted in builds with KENGINE2D_TRACK_ALLOCATIONS (see AllocationCounter)
+	};
+
 	class PhysicsSystem
 	{
 	public:
 		PhysicsSystem();
 		~PhysicsSystem();
 
-		void Init();
+		//The cell size only matters for the spatial grid, and should be about the size of a typical object.
+		//The margin only matters for the tree, and is how far an object can move before its leaf is reinserted.
+		void Init(BroadphaseType broadphaseType = BroadphaseType::SweepAndPrune, Scalar gridCellSize = 1.0f, Scalar treeMargin = 0.1f);
 		void Deinit();
 
 		void Update(double fTime);
 
+		//Updates work in buffers that grow to fit the biggest one so far and then stay that size, so once the load has
+		//peaked they stop allocating.  Reserving sizes them up front for this many objects and broadphase pairs (with one
+		//contact each), so updates that stay under that never allocate at all.
+		void Reserve(int objectCount, int pairCount);
+		//In builds with KENGINE2D_TRACK_ALLOCATIONS, turning this off makes any update that allocates fail an assert
+		void SetAllocationsAllowed(bool allocationsAllowed);
+
+		//Removing moves the last object into the removed one's place
 		void AddPhysicalObject(PhysicalObject * physicalObject);
 		void RemovePhysicalObject(PhysicalObject * physicalObject);
 
+		//Adds and removes made between these are held back and applied together by EndBatch, for spawning or clearing out
+		//lots of objects at once.  Removed objects are let go of straight away, so can be destroyed before the batch ends.
+		//Queries skip them, and don't see the added ones until the batch is over.  Can't update in the middle of a batch.
+		void BeginBatch();
+		void EndBatch();
+
+		//Bodies owned by the system, each with its transform and shapes kept in pooled storage.  Creating and destroying them
+		//doesn't allocate once the pools have grown, which suits things spawned and thrown away in large numbers.
+		//Their motion is kept in the given batch, which should belong to the MechanicsUpdater that steps the system.
+		PhysicsHandle CreateBody(MechanicsBatch * batch, Scalar mass, StaticTransform const & transform = StaticTransform::Identity(), Point const & velocity = Point::Origin(), Scalar angularVelocity = 0.0f);
+		void DestroyBody(PhysicsHandle body);
+		bool IsBodyValid(PhysicsHandle body) const;
+		PhysicalObject * GetBody(PhysicsHandle body); //Null once the body has been destroyed
+		//Shapes sit on the body's transform, and go when it does
+		void AddCircle(PhysicsHandle body, Scalar radius);
+		void AddBox(PhysicsHandle body, Scalar width, Scalar height);
+		void AddPolygon(PhysicsHandle body, Point const * vertices, int count);
+		void AddCapsule(PhysicsHandle body, Scalar length, Scalar radius);
+
 		void AddBoundary(KEngine2D::BoundaryLine * boundary);
 		void RemoveBoundary(KEngine2D::BoundaryLine * boundary);
 
+		//Objects whose bounding boxes overlap the region or the segment
+		void QueryRegion(AxisAlignedBoundingBox const & region, std::vector<PhysicalObject *> & results);
+		void QueryRay(Point const & start, Point const & end, std::vector<PhysicalObject *> & results);
+
+		//Narrowphase and islands are spread over this many threads, including the caller.  Results don't depend on it.  Kept
+		//across Deinit and Init, though the threads themselves only run between them.
+		void SetThreadCount(int threadCount);
+		int GetThreadCount() const;
+
+		//Passes the solver makes over every contact each update.  More settles stacks better, and costs the same for every contact.
+		void SetVelocityIterations(int velocityIterations);
+		int GetVelocityIterations() const;
+
+		//An island falls asleep once all of its objects have stayed under both speeds for timeToSleep seconds
+		void SetSleepThresholds(Scalar linearVelocity, Scalar angularVelocity, double timeToSleep);
+		void SetSleepingEnabled(bool sleepingEnabled);
+
+		PhysicsStatistics const & GetStatistics() const;
+
 	private:
-		std::vector<PhysicalObject *> mPhysicalObjects;
+		struct PooledBody
+		{
+			MechanicalTransform mechanics;
+			BoundingArea area;
+			PhysicalObject object;
+		};
+
+		static constexpr int NarrowphaseChunkSize = 64;
+		struct NarrowphaseChunk
+		{
+			std::vector<int> pairs;  //Which pair each manifold belongs to
+			std::vector<ContactManifold> manifolds;
+			std::vector<int> boundaryObjects;
+			std::vector<int> boundaries;
+			std::vector<ContactManifold> boundaryManifolds;
+		};
+
+		struct ContinuousImpact
+		{
+			int object;
+			Scalar remainingFraction; //Of the step, still to go after the impact
+		};
+
+		struct ManifoldOwner
+		{
+			int object;
+			int otherObject; //-1 when touching a boundary
+			int boundary;    //-1 when touching another object
+		};
+
+		//Last frame's impulses, sorted by objects, boundary and then shapes
+		struct CachedManifold
+		{
+			PhysicalObject const * object;
+			PhysicalObject const * otherObject;
+			BoundaryLine const * boundary;
+			int shape;
+			int otherShape;
+			int pointCount;
+			unsigned int featureIds[2];
+			Scalar normalImpulses[2];
+		};
+
+		//Velocities are copied out of the transforms while an island is being solved, and written back once it's done
+		struct SolverBody
+		{
+			Point center;
+			Point velocity;
+			Scalar angularVelocity;
+			Scalar inverseMass;
+			Scalar inverseMomentOfInertia;
+		};
+
+		//Everything the velocity iterations need for one manifold, worked out once before they start
+		struct ContactConstraint
+		{
+			int manifold;
+			int object;
+			int otherObject; //-1 for boundaries, which never move
+			Point normal;
+			int pointCount;
+			Point offsets[2];
+			Point otherOffsets[2];
+			Scalar normalMasses[2];
+			Scalar velocityBiases[2];
+			Scalar normalImpulses[2];
+		};
+
+		static bool CachedManifoldPrecedes(CachedManifold const & manifold, CachedManifold const & other);
+		CachedManifold GetCacheKey(int manifold) const;
+
+		//Continuous objects are swept from where they were to where they are.  Any that hit something are pulled back to the
+		//point of impact for this update's contacts, then sent on for the rest of the step once those are solved.
+		void SweepContinuousObjects();
+		void AdvanceContinuousObjects();
+		bool SweepObject(int object, Point const & start, Point const & end, Scalar & fraction);
+		bool SweepCircle(int object, Point const & start, Point const & end, Scalar radius, Scalar & fraction);
+
+		void RunNarrowphase();
+		void RunBoundaryNarrowphase();
+		void WarmStart();
+		void UpdateContactCache();
+		void WakeSleepGroups();
+		void BuildIslands();
+		int FindIslandRoot(int object);
+		void WakeTouchedIslands();
+		void UpdateSleep(int island);
+		void BuildConstraints();
+		void SolveIsland(int island);
+		void PrepareConstraint(ContactConstraint & constraint);
+		Scalar GetNormalVelocity(ContactConstraint const & constraint, int point) const;
+		void ApplyConstraintImpulse(ContactConstraint const & constraint, int point, Scalar impulse);
+		void SolveConstraint(ContactConstraint & constraint);
+
+		void InsertPhysicalObject(PhysicalObject * physicalObject);
+		void ErasePhysicalObject(int index);
+
+		std::vector<PhysicalObject *> mPhysicalObjects; //Null where something has been removed during a batch
+		bool mBatching;
+		std::vector<PhysicalObject *> mBatchedAdds;
+		std::vector<int> mBatchedRemoves;
+		Pool<PooledBody> mBodyPool;
 		std::vector<KEngine2D::BoundaryLine *> mBoundaries;
+		Broadphase * mBroadphase;
+		BruteForce mBruteForce;
+		SweepAndPrune mSweepAndPrune;
+		SpatialGrid mSpatialGrid;
+		AABBTree mAABBTree;
+		std::vector<int> mQueryProxies;
+		WorkerPool mWorkerPool;
+		int mThreadCount;
+
+		std::vector<AxisAlignedBoundingBox> mBoundingBoxes;
+		std::vector<BroadphasePair> mPairs;
+		std::vector<ContinuousImpact> mContinuousImpacts;
+		std::vector<int> mSweepProxies; //What the broadphase finds in a sweep's path
+		std::vector<int> mPairManifoldStarts; //Where each pair's manifolds begin, a pair collides if it has any
+		std::vector<int> mPairManifoldCursors;
+		std::vector<ContactManifold> mManifolds; //Pair manifolds in pair order, then boundary manifolds in object order
+		std::vector<ManifoldOwner> mManifoldOwners;
+		std::vector<CachedManifold> mContactCache;
+
+		//Pairs of lone circles get tested in one batch, everything else goes through BoundingArea::GetManifolds in fixed chunks
+		CirclePairBatch mCircleBatch;
+		std::vector<int> mBatchedPairs;
+		std::vector<int> mGeneralPairs;
+		std::vector<int> mBatchHitIndices;
+		std::vector<ContactManifold> mBatchHits;
+		std::vector<NarrowphaseChunk> mNarrowphaseChunks;
+
+		//Islands are numbered in order of their lowest object, and list their objects in order
+		std::vector<int> mIslandParents;
+		std::vector<int> mObjectIslands;
+		std::vector<int> mIslandStarts;
+		std::vector<int> mIslandCursors;
+		std::vector<int> mIslandObjects;
+
+		std::vector<SolverBody> mSolverBodies;
+		SolverBody mStaticBody; //Stands in for boundaries
+		std::vector<ContactConstraint> mConstraints; //Grouped by island
+		std::vector<int> mIslandConstraintStarts;
+		std::vector<int> mIslandConstraintCursors;
+		int mVelocityIterations;
+		double mTimeStep;
+		bool mAllocationsAllowed;
+
+		//Objects that fell asleep together share a group, so waking one wakes them all.  Awake objects have no group.
+		static constexpr long long NoSleepGroup = -1;
+		std::vector<double> mSleepTimes;
+		std::vector<long long> mSleepGroups;
+		std::vector<long long> mWokenSleepGroups;
+		long long mNextSleepGroup;
+		Scalar mLinearSleepVelocity;
+		Scalar mAngularSleepVelocity;
+		double mTimeToSleep;
+		bool mSleepingEnabled;
+		PhysicsStatistics mStatistics;
 	};
 
 }
@@ -0,0 +1,246 @@
+#pragma once
+#include "Transform2D.h"
+
+namespace KEngine2D
+{
+	//Packets hold Width values side by side and run every operation across all the lanes at once.  The lane loops have a fixed
+	//count, so compilers turn them into SIMD where the target has it, and they are the scalar fallback everywhere else.
+	//Everything is constexpr and lives in the header so kernels built from packets inline all the way down.
+	template <typename T, size_t Width>
+	struct BasicScalarPacket
+	{
+		typedef T ValueType;
+		static constexpr size_t Count = Width;
+
+		T values[Width];
+
+		static constexpr BasicScalarPacket Broadcast(T value)
+		{
+			BasicScalarPacket retVal = {};
+			for (size_t lane = 0; lane < Width; lane++) {
+				retVal.values[lane] = value;
+			}
+			return retVal;
+		}
+
+		static constexpr BasicScalarPacket Load(T const * source)
+		{
+			BasicScalarPacket retVal = {};
+			for (size_t lane = 0; lane < Width; lane++) {
+				retVal.values[lane] = source[lane];
+			}
+			return retVal;
+		}
+
+		constexpr void Store(T * destination) const
+		{
+			for (size_t lane = 0; lane < Width; lane++) {
+				destination[lane] = values[lane];
+			}
+		}
+
+		constexpr BasicScalarPacket & operator+=(BasicScalarPacket const & other)
+		{
+			for (size_t lane = 0; lane < Width; lane++) {
+				values[lane] += other.values[lane];
+			}
+			return *this;
+		}
+
+		constexpr BasicScalarPacket & operator-=(BasicScalarPacket const & other)
+		{
+			for (size_t lane = 0; lane < Width; lane++) {
+				values[lane] -= other.values[lane];
+			}
+			return *this;
+		}
+
+		constexpr BasicScalarPacket & operator*=(BasicScalarPacket const & other)
+		{
+			for (size_t lane = 0; lane < Width; lane++) {
+				values[lane] *= other.values[lane];
+			}
+			return *this;
+		}
+
+		constexpr BasicScalarPacket operator+(BasicScalarPacket const & other) const { BasicScalarPacket retVal = *this; return retVal += other; }
+		constexpr BasicScalarPacket operator-(BasicScalarPacket const & other) const { BasicScalarPacket retVal = *this; return retVal -= other; }
+		constexpr BasicScalarPacket operator*(BasicScalarPacket const & other) const { BasicScalarPacket retVal = *this; return retVal *= other; }
+	};
+
+	//Points laid out as all the xs then all the ys, the same structure of arrays the batches use
+	template <typename T, size_t Width>
+	struct BasicPointPacket
+	{
+		typedef T ValueType;
+		typedef BasicScalarPacket<T, Width> ScalarPacket;
+		static constexpr size_t Count = Width;
+
+		T x[Width];
+		T y[Width];
+
+		static constexpr BasicPointPacket Broadcast(BasicPoint<T> const & point)
+		{
+			BasicPointPacket retVal = {};
+			for (size_t lane = 0; lane < Width; lane++) {
+				retVal.x[lane] = point.x;
+				retVal.y[lane] = point.y;
+			}
+			return retVal;
+		}
+
+		//Gathers Width consecutive points
+		static constexpr BasicPointPacket Load(BasicPoint<T> const * points)
+		{
+			BasicPointPacket retVal = {};
+			for (size_t lane = 0; lane < Width; lane++) {
+				retVal.x[lane] = points[lane].x;
+				retVal.y[lane] = points[lane].y;
+			}
+			return retVal;
+		}
+
+		//Straight from structure of arrays storage, like the batches keep
+		static constexpr BasicPointPacket Load(T const * xs, T const * ys)
+		{
+			BasicPointPacket retVal = {};
+			for (size_t lane = 0; lane < Width; lane++) {
+				retVal.x[lane] = xs[lane];
+				retVal.y[lane] = ys[lane];
+			}
+			return retVal;
+		}
+
+		constexpr void Store(BasicPoint<T> * points) const
+		{
+			for (size_t lane = 0; lane < Width; lane++) {
+				points[lane].x = x[lane];
+				points[lane].y = y[lane];
+			}
+		}
+
+		constexpr void Store(T * xs, T * ys) const
+		{
+			for (size_t lane = 0; lane < Width; lane++) {
+				xs[lane] = x[lane];
+				ys[lane] = y[lane];
+			}
+		}
+
+		constexpr BasicPoint<T> Get(size_t lane) const
+		{
+			assert(lane < Width);
+			return { x[lane], y[lane] };
+		}
+
+		constexpr void Set(size_t lane, BasicPoint<T> const & point)
+		{
+			assert(lane < Width);
+			x[lane] = point.x;
+			y[lane] = point.y;
+		}
+
+		constexpr BasicPointPacket & operator+=(BasicPointPacket const & other)
+		{
+			for (size_t lane = 0; lane < Width; lane++) {
+				x[lane] += other.x[lane];
+				y[lane] += other.y[lane];
+			}
+			return *this;
+		}
+
+		constexpr BasicPointPacket & operator-=(BasicPointPacket const & other)
+		{
+			for (size_t lane = 0; lane < Width; lane++) {
+				x[lane] -= other.x[lane];
+				y[lane] -= other.y[lane];
+			}
+			return *this;
+		}
+
+		constexpr BasicPointPacket & operator*=(T const & scalar)
+		{
+			for (size_t lane = 0; lane < Width; lane++) {
+				x[lane] *= scalar;
+				y[lane] *= scalar;
+			}
+			return *this;
+		}
+
+		//Scales each point by its own lane of scalars
+		constexpr BasicPointPacket & operator*=(ScalarPacket const & scalars)
+		{
+			for (size_t lane = 0; lane < Width; lane++) {
+				x[lane] *= scalars.values[lane];
+				y[lane] *= scalars.values[lane];
+			}
+			return *this;
+		}
+
+		constexpr BasicPointPacket operator-() const
+		{
+			BasicPointPacket retVal = {};
+			for (size_t lane = 0; lane < Width; lane++) {
+				retVal.x[lane] = -x[lane];
+				retVal.y[lane] = -y[lane];
+			}
+			return retVal;
+		}
+
+		constexpr BasicPointPacket operator+(BasicPointPacket const & other) const { BasicPointPacket retVal = *this; return retVal += other; }
+		constexpr BasicPointPacket operator-(BasicPointPacket const & other) const { BasicPointPacket retVal = *this; return retVal -= other; }
+	};
+
+	typedef BasicScalarPacket<Scalar, 4> Scalarx4;
+	typedef BasicScalarPacket<Scalar, 8> Scalarx8;
+	typedef BasicPointPacket<Scalar, 4> Vec2x4;
+	typedef BasicPointPacket<Scalar, 8> Vec2x8;
+
+	//Lane by lane versions of the single point functions in Transform2D.h, giving the same results in every lane
+	template <typename T, size_t Width>
+	constexpr BasicScalarPacket<T, Width> DotProduct(BasicPointPacket<T, Width> const & vec1, BasicPointPacket<T, Width> const & vec2)
+	{
+		BasicScalarPacket<T, Width> retVal = {};
+		for (size_t lane = 0; lane < Width; lane++) {
+			retVal.values[lane] = (vec1.x[lane] * vec2.x[lane]) + (vec1.y[lane] * vec2.y[lane]);
+		}
+		return retVal;
+	}
+
+	template <typename T, size_t Width>
+	constexpr BasicScalarPacket<T, Width> PseudoCrossProduct(BasicPointPacket<T, Width> const & vec1, BasicPointPacket<T, Width> const & vec2)
+	{
+		BasicScalarPacket<T, Width> retVal = {};
+		for (size_t lane = 0; lane < Width; lane++) {
+			retVal.values[lane] = (vec1.x[lane] * vec2.y[lane]) - (vec1.y[lane] * vec2.x[lane]);
+		}
+		return retVal;
+	}
+
+	template <typename T, size_t Width>
+	constexpr BasicPointPacket<T, Width> PseudoCrossProduct(BasicPointPacket<T, Width> const & vec1, BasicScalarPacket<T, Width> const & scalars)
+	{
+		BasicPointPacket<T, Width> retVal = {};
+		for (size_t lane = 0; lane < Width; lane++) {
+			retVal.x[lane] = -vec1.y[lane] * scalars.values[lane];
+			retVal.y[lane] = vec1.x[lane] * scalars.values[lane];
+		}
+		return retVal;
+	}
+
+	//Selects instead of branching on the zero length axis, so the loop stays branch free
+	template <typename T, size_t Width>
+	constexpr BasicPointPacket<T, Width> Project(BasicPointPacket<T, Width> const & axis, BasicPointPacket<T, Width> const & vec, bool positiveOnly = false)
+	{
+		BasicScalarPacket<T, Width> dotProduct = DotProduct(vec, axis);
+		BasicScalarPacket<T, Width> axisLength2 = DotProduct(axis, axis);
+		BasicPointPacket<T, Width> retVal = {};
+		for (size_t lane = 0; lane < Width; lane++) {
+			T scalarResolute = axisLength2.values[lane] != 0 ? dotProduct.values[lane] / axisLength2.values[lane] : 0;
+			scalarResolute = positiveOnly && scalarResolute < 0 ? 0 : scalarResolute;
+			retVal.x[lane] = axis.x[lane] * scalarResolute;
+			retVal.y[lane] = axis.y[lane] * scalarResolute;
+		}
+		return retVal;
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <vector>
+#include <cassert>
+
+namespace KEngine2D
+{
+	//Fixed size chunks of already constructed objects, handed out and taken back through a free list, so Allocate and Free
+	//never touch the heap once the pool has grown big enough.  Objects never move, so pointers to them stay good, and are
+	//expected to be Init'd and Deinit'd rather than constructed.  Each slot's generation goes up when it's freed, so a
+	//stale index and generation pair can be told apart from the slot's next user.
+	template <typename T>
+	class Pool
+	{
+	public:
+		Pool()
+		{
+			mFreeList = -1;
+			mLiveCount = 0;
+		}
+
+		int Allocate()
+		{
+			if (mFreeList < 0)
+			{
+				Grow();
+			}
+			int index = mFreeList;
+			Slot & slot = GetSlot(index);
+			mFreeList = slot.nextFree;
+			slot.nextFree = LiveSlot;
+			mLiveCount++;
+			return index;
+		}
+
+		void Free(int index)
+		{
+			assert(IsLive(index));
+			Slot & slot = GetSlot(index);
+			slot.generation++;
+			slot.nextFree = mFreeList;
+			mFreeList = index;
+			mLiveCount--;
+		}
+
+		T & Get(int index)
+		{
+			assert(IsLive(index));
+			return GetSlot(index).value;
+		}
+
+		T const & Get(int index) const
+		{
+			assert(IsLive(index));
+			return GetSlot(index).value;
+		}
+
+		unsigned int GetGeneration(int index) const
+		{
+			return GetSlot(index).generation;
+		}
+
+		bool IsLive(int index) const
+		{
+			return index >= 0 && index < GetCapacity() && GetSlot(index).nextFree == LiveSlot;
+		}
+
+		bool IsLive(int index, unsigned int generation) const
+		{
+			return IsLive(index) && GetSlot(index).generation == generation;
+		}
+
+		int GetCapacity() const
+		{
+			return (int)mChunks.size() * ChunkSize;
+		}
+
+		int GetLiveCount() const
+		{
+			return mLiveCount;
+		}
+
+	private:
+		static constexpr int ChunkShift = 8;
+		static constexpr int ChunkSize = 1 << ChunkShift;
+		static constexpr int LiveSlot = -2;
+
+		struct Slot
+		{
+			T value;
+			unsigned int generation = 1; //Never 0, so a zeroed handle is never valid
+			int nextFree = -1;
+		};
+
+		Slot & GetSlot(int index)
+		{
+			return mChunks[index >> ChunkShift][index & (ChunkSize - 1)];
+		}
+
+		Slot const & GetSlot(int index) const
+		{
+			return mChunks[index >> ChunkShift][index & (ChunkSize - 1)];
+		}
+
+		//Chunks are sized once and never resized, so growing the outer list doesn't move any objects
+		void Grow()
+		{
+			int first = GetCapacity();
+			mChunks.emplace_back(ChunkSize);
+			for (int i = ChunkSize - 1; i >= 0; i--)
+			{
+				mChunks.back()[i].nextFree = mFreeList;
+				mFreeList = first + i;
+			}
+		}
+
+		std::vector<std::vector<Slot>> mChunks;
+		int mFreeList;
+		int mLiveCount;
+	};
+
+	//Needs a definition before C++17, since emplace_back takes it by reference
+	template <typename T>
+	constexpr int Pool<T>::ChunkSize;
+}
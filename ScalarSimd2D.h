@@ -0,0 +1,75 @@
+#pragma once
+#include "Transform2D.h"
+
+#if defined(__AVX__)
+#define KENGINE2D_SCALAR_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KENGINE2D_SCALAR_SSE
+#endif
+#if defined(KENGINE2D_SCALAR_AVX) || defined(KENGINE2D_SCALAR_SSE)
+#include <immintrin.h>
+#endif
+
+namespace KEngine2D
+{
+	//Registers full of Scalars, so loops over Scalar arrays can be written once for either precision.
+	//Each has Count lanes, twice as many in a float build.  SetPairs and SwapPairs treat neighbouring lanes as x and y of a point.
+#if defined(KENGINE2D_SCALAR_AVX)
+	struct WideScalars
+	{
+#if defined(KENGINE2D_SINGLE_PRECISION)
+		typedef __m256 Register;
+		static constexpr size_t Count = 8;
+		static Register Load(Scalar const * values) { return _mm256_loadu_ps(values); }
+		static void Store(Scalar * values, Register value) { _mm256_storeu_ps(values, value); }
+		static Register Set(Scalar value) { return _mm256_set1_ps(value); }
+		static Register SetPairs(Scalar first, Scalar second) { return _mm256_setr_ps(first, second, first, second, first, second, first, second); }
+		static Register Add(Register value, Register other) { return _mm256_add_ps(value, other); }
+		static Register Subtract(Register value, Register other) { return _mm256_sub_ps(value, other); }
+		static Register Multiply(Register value, Register other) { return _mm256_mul_ps(value, other); }
+		static Register SwapPairs(Register value) { return _mm256_permute_ps(value, 0xB1); }
+#else
+		typedef __m256d Register;
+		static constexpr size_t Count = 4;
+		static Register Load(Scalar const * values) { return _mm256_loadu_pd(values); }
+		static void Store(Scalar * values, Register value) { _mm256_storeu_pd(values, value); }
+		static Register Set(Scalar value) { return _mm256_set1_pd(value); }
+		static Register SetPairs(Scalar first, Scalar second) { return _mm256_setr_pd(first, second, first, second); }
+		static Register Add(Register value, Register other) { return _mm256_add_pd(value, other); }
+		static Register Subtract(Register value, Register other) { return _mm256_sub_pd(value, other); }
+		static Register Multiply(Register value, Register other) { return _mm256_mul_pd(value, other); }
+		static Register SwapPairs(Register value) { return _mm256_permute_pd(value, 0x5); }
+#endif
+	};
+#endif
+
+#if defined(KENGINE2D_SCALAR_SSE)
+	struct NarrowScalars
+	{
+#if defined(KENGINE2D_SINGLE_PRECISION)
+		typedef __m128 Register;
+		static constexpr size_t Count = 4;
+		static Register Load(Scalar const * values) { return _mm_loadu_ps(values); }
+		static void Store(Scalar * values, Register value) { _mm_storeu_ps(values, value); }
+		static Register Set(Scalar value) { return _mm_set1_ps(value); }
+		static Register SetPairs(Scalar first, Scalar second) { return _mm_setr_ps(first, second, first, second); }
+		static Register Add(Register value, Register other) { return _mm_add_ps(value, other); }
+		static Register Subtract(Register value, Register other) { return _mm_sub_ps(value, other); }
+		static Register Multiply(Register value, Register other) { return _mm_mul_ps(value, other); }
+		static Register SwapPairs(Register value) { return _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)); }
+#else
+		typedef __m128d Register;
+		static constexpr size_t Count = 2;
+		static Register Load(Scalar const * values) { return _mm_loadu_pd(values); }
+		static void Store(Scalar * values, Register value) { _mm_storeu_pd(values, value); }
+		static Register Set(Scalar value) { return _mm_set1_pd(value); }
+		static Register SetPairs(Scalar first, Scalar second) { return _mm_setr_pd(first, second); }
+		static Register Add(Register value, Register other) { return _mm_add_pd(value, other); }
+		static Register Subtract(Register value, Register other) { return _mm_sub_pd(value, other); }
+		static Register Multiply(Register value, Register other) { return _mm_mul_pd(value, other); }
+		static Register SwapPairs(Register value) { return _mm_shuffle_pd(value, value, 0x1); }
+#endif
+	};
+#endif
+}
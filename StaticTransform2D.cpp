@@ -1,12 +1,15 @@
 #include "StaticTransform2D.h"
 #include <cmath>
 
-KEngine2D::StaticTransform::StaticTransform(Point const & translation /* = Point::Origin() */, double radians /* = 0.0f */, double scale /* = 1.0f */)
+KEngine2D::StaticTransform::StaticTransform(Point const & translation /* = Point::Origin() */, Scalar radians /* = 0.0f */, Scalar scale /* = 1.0f */)
 {
 	mTranslation = translation;
 	mRotation = radians;
 	mScale = scale;
-    UpdateMatrix();
+	mVersion = 0;
+	mSinTheta = 0.0f;
+	mCosTheta = 1.0f;
+	mTrigDirty = true;
 }
 
 KEngine2D::Point KEngine2D::StaticTransform::GetTranslation() const
@@ -14,37 +17,84 @@ KEngine2D::Point KEngine2D::StaticTransform::GetTranslation() const
 	return mTranslation;
 }
 
-double KEngine2D::StaticTransform::GetRotation() const
+KEngine2D::Scalar KEngine2D::StaticTransform::GetRotation() const
 {
 	return mRotation;
 }
 
-double KEngine2D::StaticTransform::GetScale() const
+KEngine2D::Scalar KEngine2D::StaticTransform::GetScale() const
 {
 	return mScale;
 }
 
-const KEngine2D::Matrix& KEngine2D::StaticTransform::GetAsMatrix() const
+KEngine2D::Affine KEngine2D::StaticTransform::GetAsAffine() const
 {
-    return mMatrix;
+	UpdateTrig();
+	return Affine::Make(mTranslation, mScale, mCosTheta, mSinTheta);
 }
 
+unsigned int KEngine2D::StaticTransform::GetVersion() const
+{
+	return mVersion;
+}
+
+KEngine2D::Pose KEngine2D::StaticTransform::GetPose() const
+{
+	UpdateTrig();
+	return { mTranslation, mScale, mCosTheta, mSinTheta };
+}
+
+//Same as Transform's, without redoing the trig every call
+KEngine2D::Point KEngine2D::StaticTransform::LocalToGlobal(Point const & point, bool asVector) const
+{
+	return GetPose().LocalToGlobal(point, asVector);
+}
+
+KEngine2D::Point KEngine2D::StaticTransform::GlobalToLocal(Point const & point) const
+{
+	return GetPose().GlobalToLocal(point);
+}
+
+void KEngine2D::StaticTransform::LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector) const
+{
+	GetPose().LocalToGlobalBatch(points, results, count, asVector);
+}
+
+void KEngine2D::StaticTransform::GlobalToLocalBatch(Point const * points, Point * results, size_t count) const
+{
+	GetPose().GlobalToLocalBatch(points, results, count);
+}
+
+//Setting a value it already has doesn't count as a change
 void KEngine2D::StaticTransform::SetTranslation( Point const & translation )
 {
+	if (translation.x == mTranslation.x && translation.y == mTranslation.y)
+	{
+		return;
+	}
 	mTranslation = translation;
-    UpdateMatrix();
+	mVersion++;
 }
 
-void KEngine2D::StaticTransform::SetRotation( double rotation )
+void KEngine2D::StaticTransform::SetRotation( Scalar rotation )
 {
+	if (rotation == mRotation)
+	{
+		return;
+	}
 	mRotation = rotation;
-    UpdateMatrix();
+	mTrigDirty = true;
+	mVersion++;
 }
 
-void KEngine2D::StaticTransform::SetScale( double scale )
+void KEngine2D::StaticTransform::SetScale( Scalar scale )
 {
+	if (scale == mScale)
+	{
+		return;
+	}
 	mScale = scale;
-    UpdateMatrix();
+	mVersion++;
 }
 
 KEngine2D::StaticTransform const & KEngine2D::StaticTransform::Identity()
@@ -53,26 +103,13 @@ KEngine2D::StaticTransform const & KEngine2D::StaticTransform::Identity()
 	return identity;
 }
 
-void KEngine2D::StaticTransform::UpdateMatrix()
+void KEngine2D::StaticTransform::UpdateTrig() const
 {
-    float sinTheta = sin(mRotation);
-    float cosTheta = cos(mRotation);
-    float xScale = mScale;
-    float yScale = mScale;
-    mMatrix.data[0][0] = xScale * cosTheta;
-    mMatrix.data[0][1] = - yScale * sinTheta;
-    mMatrix.data[0][2] = 0;
-    mMatrix.data[0][3] = mTranslation.x;
-    mMatrix.data[1][0] = xScale * sinTheta;
-    mMatrix.data[1][1] = yScale * cosTheta;
-    mMatrix.data[1][2] = 0;
-    mMatrix.data[1][3] = mTranslation.y;
-    mMatrix.data[2][0] = 0.0f;
-    mMatrix.data[2][1] = 0.0f;
-    mMatrix.data[2][2] = 1.0f;
-    mMatrix.data[2][3] = 0.0f;
-    mMatrix.data[3][0] = 0.0f;
-    mMatrix.data[3][1] = 0.0f;
-    mMatrix.data[3][2] = 0.0f;
-    mMatrix.data[3][3] = 1.0f;
+	if (!mTrigDirty)
+	{
+		return;
+	}
+	mSinTheta = std::sin(mRotation);
+	mCosTheta = std::cos(mRotation);
+	mTrigDirty = false;
 }
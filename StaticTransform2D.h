@@ -4,28 +4,41 @@
 
 namespace KEngine2D
 {
-	class StaticTransform : public Transform
+	//The sine and cosine of the rotation are only worked out when something asks for them after a change.
+	//Filling them in from const calls isn't safe from several threads at once, so use UpdateTrig first.
+	class StaticTransform final : public Transform
 	{
 	public:
-		StaticTransform(Point const & translation = Point::Origin(), double radians = 0.0f, double scale = 1.0f);
+		StaticTransform(Point const & translation = Point::Origin(), Scalar radians = 0.0f, Scalar scale = 1.0f);
 	
 		virtual Point GetTranslation() const;
-		virtual double GetRotation() const;
-		virtual double GetScale() const;
-        virtual const Matrix & GetAsMatrix() const;
+		virtual Scalar GetRotation() const;
+		virtual Scalar GetScale() const;
+		virtual Affine GetAsAffine() const override;
+		virtual unsigned int GetVersion() const override;
+		virtual Pose GetPose() const override;
+
+		virtual Point LocalToGlobal(Point const & point, bool asVector = false) const override;
+		virtual Point GlobalToLocal(Point const & point) const override;
+		virtual void LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector = false) const override;
+		virtual void GlobalToLocalBatch(Point const * points, Point * results, size_t count) const override;
 	
 		void SetTranslation(Point const & translation);
-		void SetRotation(double rotation);
-		void SetScale(double scale);
+		void SetRotation(Scalar rotation);
+		void SetScale(Scalar scale);
+
+		//Works out the sine and cosine now rather than on first use
+		void UpdateTrig() const;
 
 		static StaticTransform const & Identity();
 
 	private:
-        void UpdateMatrix();
-        
 		Point mTranslation;
-		double mRotation;
-		double mScale;
-        Matrix mMatrix;
+		Scalar mRotation;
+		Scalar mScale;
+		unsigned int mVersion;
+		mutable Scalar mSinTheta;
+		mutable Scalar mCosTheta;
+		mutable bool mTrigDirty;
 	};
 }
@@ -0,0 +1,105 @@
+//Standalone checks that PhysicsSystem::Update stops allocating once its buffers have grown.  Needs every source built with
+//KENGINE2D_TRACK_ALLOCATIONS, otherwise there's nothing to count, for example:
+//  g++ -std=c++14 -DKENGINE2D_TRACK_ALLOCATIONS -I. -I<KEngineCore include path> Tests/AllocationChecks2D.cpp *.cpp -o AllocationChecks2D -lpthread
+#include <cstdio>
+#include "../Physics2D.h"
+#include "../MechanicsBatch2D.h"
+#include "../AllocationCounter2D.h"
+#include "Check2D.h"
+
+using namespace KEngine2D;
+using namespace KEngine2DChecks;
+
+//A pile of boxes and circles falling into a walled pit, so pairs, contacts and islands keep changing as it settles.  Some
+//are continuous, so their sweeps are counted as well.
+static void FillScene(PhysicsSystem & system, MechanicsBatch & batch)
+{
+	for (int i = 0; i < 400; i++)
+	{
+		StaticTransform transform({ 2.0f + (i % 20) * 2.9f, 1.0f + (i / 20) * 2.5f }, 0.1f * i);
+		PhysicsHandle body = system.CreateBody(&batch, 1.0f, transform);
+		if (i % 2 == 0)
+		{
+			system.AddCircle(body, 1.0f);
+		}
+		else
+		{
+			system.AddBox(body, 2.0f, 2.0f);
+		}
+		system.GetBody(body)->SetContinuousCollision(i % 10 == 0);
+	}
+}
+
+//Returns the most allocations any one of the updates made
+static int RunScene(PhysicsSystem & system, MechanicsBatch & batch, int frameCount)
+{
+	int mostAllocations = 0;
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		for (int i = 0; i < (int)batch.GetSize(); i++)
+		{
+			Point velocity = batch.GetVelocity(i);
+			batch.SetVelocity(i, { velocity.x, velocity.y - 9.8f / 60.0f });
+		}
+		batch.Integrate(1.0 / 60.0);
+		system.Update(1.0 / 60.0);
+		if (system.GetStatistics().allocationCount > mostAllocations)
+		{
+			mostAllocations = system.GetStatistics().allocationCount;
+		}
+	}
+	return mostAllocations;
+}
+
+static void CheckScene(int threadCount, bool reserve)
+{
+	printf("%d thread(s), %s\n", threadCount, reserve ? "reserved up front" : "warmed up");
+	MechanicsBatch batch;
+	PhysicsSystem system;
+	system.Init(BroadphaseType::SweepAndPrune);
+	system.SetThreadCount(threadCount);
+	BoundaryLine walls[3];
+	walls[0].Init(0.0f, 1.0f, 0.0f);
+	walls[1].Init(1.0f, 0.0f, 0.0f);
+	walls[2].Init(-1.0f, 0.0f, 60.0f);
+	for (BoundaryLine & wall : walls)
+	{
+		system.AddBoundary(&wall);
+	}
+	FillScene(system, batch);
+	if (reserve)
+	{
+		system.Reserve(400, 4000);
+	}
+	else
+	{
+		RunScene(system, batch, 200);
+	}
+
+	//Any allocation from here on fails an assert as well as the check
+	system.SetAllocationsAllowed(false);
+	Check(RunScene(system, batch, 200) == 0, "updates don't allocate");
+	Check(system.GetStatistics().collisionCount > 0, "things are still touching");
+	system.Deinit();
+	system.Init(BroadphaseType::SweepAndPrune);
+	Check(system.GetThreadCount() == threadCount, "the thread count is kept across Deinit and Init");
+	system.Deinit();
+	for (BoundaryLine & wall : walls)
+	{
+		wall.Deinit();
+	}
+}
+
+int main()
+{
+	if (!AllocationCounter::IsEnabled())
+	{
+		Check(false, "built with KENGINE2D_TRACK_ALLOCATIONS");
+		return Finish("AllocationChecks2D");
+	}
+	CheckScene(1, false);
+	CheckScene(4, false);
+	CheckScene(1, true);
+	CheckScene(4, true);
+	return Finish("AllocationChecks2D");
+}
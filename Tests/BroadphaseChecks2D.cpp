@@ -0,0 +1,143 @@
+//Standalone checks that every broadphase finds the same pairs and answers region queries the same way.  Build it along
+//with the library sources, for example:
+//  g++ -std=c++14 -I. -I<KEngineCore include path> Tests/BroadphaseChecks2D.cpp *.cpp -o BroadphaseChecks2D -lpthread
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include "../Broadphase2D.h"
+#include "Check2D.h"
+
+using namespace KEngine2D;
+using namespace KEngine2DChecks;
+
+static AxisAlignedBoundingBox RandomBox(Scalar worldSize, Scalar maxSize)
+{
+	Point corner = { (Scalar)(rand() % 1000) * worldSize / 1000.0f, (Scalar)(rand() % 1000) * worldSize / 1000.0f };
+	Point size = { (Scalar)(rand() % 100 + 1) * maxSize / 100.0f, (Scalar)(rand() % 100 + 1) * maxSize / 100.0f };
+	return { corner, { corner.x + size.x, corner.y + size.y } };
+}
+
+static bool SameProxies(std::vector<int> proxies, std::vector<int> expected)
+{
+	std::sort(proxies.begin(), proxies.end());
+	std::sort(expected.begin(), expected.end());
+	return proxies == expected;
+}
+
+static bool SamePairs(std::vector<BroadphasePair> const & pairs, std::vector<BroadphasePair> const & expected)
+{
+	if (pairs.size() != expected.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < pairs.size(); i++)
+	{
+		if (pairs[i].first != expected[i].first || pairs[i].second != expected[i].second)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//Brute force pairs everything, so its pairs are cut down to the ones that really overlap
+static void FindReferencePairs(std::vector<AxisAlignedBoundingBox> const & boxes, std::vector<BroadphasePair> & pairs)
+{
+	pairs.clear();
+	for (int i = 0; i < (int)boxes.size(); i++)
+	{
+		for (int j = i + 1; j < (int)boxes.size(); j++)
+		{
+			if (Overlaps(boxes[i], boxes[j]))
+			{
+				pairs.push_back({ i, j });
+			}
+		}
+	}
+}
+
+static void CheckBroadphase(Broadphase & broadphase, char const * name)
+{
+	printf("%s\n", name);
+	srand(7);
+	const Scalar worldSize = 200.0f;
+	std::vector<AxisAlignedBoundingBox> boxes;
+	for (int i = 0; i < 500; i++)
+	{
+		broadphase.AddProxy(i);
+		boxes.push_back(RandomBox(worldSize, i % 50 == 0 ? 40.0f : 4.0f));
+	}
+
+	std::vector<BroadphasePair> pairs;
+	std::vector<BroadphasePair> expectedPairs;
+	std::vector<int> proxies;
+	std::vector<int> expectedProxies;
+	bool pairsMatch = true;
+	bool queriesMatch = true;
+	for (int frame = 0; frame < 10; frame++)
+	{
+		//Everything moves a little, some things a long way, and a few go away
+		for (AxisAlignedBoundingBox & box : boxes)
+		{
+			Scalar dx = (Scalar)(rand() % 21 - 10) * (rand() % 10 == 0 ? 5.0f : 0.1f);
+			Scalar dy = (Scalar)(rand() % 21 - 10) * 0.1f;
+			box.first.x += dx;
+			box.second.x += dx;
+			box.first.y += dy;
+			box.second.y += dy;
+		}
+		for (int removal = 0; removal < 5; removal++)
+		{
+			int proxy = rand() % (int)boxes.size();
+			broadphase.RemoveProxy(proxy);
+			boxes[proxy] = boxes.back();
+			boxes.pop_back();
+		}
+
+		//Queries made before the pairs are found, as well as after
+		broadphase.UpdateProxies(boxes);
+		for (int query = 0; query < 20; query++)
+		{
+			AxisAlignedBoundingBox region = RandomBox(worldSize, query == 0 ? worldSize : 30.0f);
+			broadphase.QueryRegion(boxes, region, proxies);
+			expectedProxies.clear();
+			for (int proxy = 0; proxy < (int)boxes.size(); proxy++)
+			{
+				if (Overlaps(boxes[proxy], region))
+				{
+					expectedProxies.push_back(proxy);
+				}
+			}
+			queriesMatch = queriesMatch && SameProxies(proxies, expectedProxies);
+		}
+
+		broadphase.FindPairs(boxes, pairs);
+		FindReferencePairs(boxes, expectedPairs);
+		pairsMatch = pairsMatch && SamePairs(pairs, expectedPairs);
+	}
+	Check(pairsMatch, "finds exactly the overlapping pairs");
+	Check(queriesMatch, "region queries find exactly the overlapping boxes");
+}
+
+int main()
+{
+	BruteForce bruteForce;
+	bruteForce.Init();
+	std::vector<AxisAlignedBoundingBox> boxes = { { { 0.0f, 0.0f }, { 1.0f, 1.0f } }, { { 5.0f, 5.0f }, { 6.0f, 6.0f } } };
+	std::vector<int> proxies;
+	bruteForce.AddProxy(0);
+	bruteForce.AddProxy(1);
+	bruteForce.QueryRegion(boxes, { { 0.5f, 0.5f }, { 2.0f, 2.0f } }, proxies);
+	Check(proxies.size() == 1 && proxies[0] == 0, "brute force queries check the boxes");
+
+	SweepAndPrune sweepAndPrune;
+	sweepAndPrune.Init();
+	CheckBroadphase(sweepAndPrune, "Sweep and prune");
+	SpatialGrid spatialGrid;
+	spatialGrid.Init(4.0f);
+	CheckBroadphase(spatialGrid, "Spatial grid");
+	AABBTree tree;
+	tree.Init(0.5f);
+	CheckBroadphase(tree, "AABB tree");
+	return Finish("BroadphaseChecks2D");
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdio>
+#include <cmath>
+
+//Tiny helpers for the standalone checks in this folder.  They stay on in release builds, unlike assert, and each check's
+//main returns the number of failures, so anything nonzero is a failed run.
+namespace KEngine2DChecks
+{
+	static int failureCount = 0;
+
+	inline void Check(bool condition, char const * description)
+	{
+		if (!condition)
+		{
+			printf("FAILED: %s\n", description);
+			failureCount++;
+		}
+	}
+
+	inline void CheckNear(double value, double expected, char const * description, double tolerance = 1e-4)
+	{
+		if (!(std::fabs(value - expected) <= tolerance * std::fmax(1.0, std::fabs(expected))))
+		{
+			printf("FAILED: %s (got %f, expected %f)\n", description, value, expected);
+			failureCount++;
+		}
+	}
+
+	inline int Finish(char const * name)
+	{
+		printf("%s: %s\n", name, failureCount == 0 ? "all passed" : "FAILED");
+		return failureCount;
+	}
+}
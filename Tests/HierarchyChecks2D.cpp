@@ -0,0 +1,60 @@
+//Standalone checks for HierarchyUpdater.  Build it along with the library sources, for example:
+//  g++ -std=c++14 -I. -I<KEngineCore include path> Tests/HierarchyChecks2D.cpp *.cpp -o HierarchyChecks2D -lpthread
+//Adding -fsanitize=thread also catches children on one level racing to fill in their shared parent's lazy trig.
+#include <memory>
+#include <vector>
+#include "../HierarchicalTransform2D.h"
+#include "../MechanicalTransform2D.h"
+#include "Check2D.h"
+
+using namespace KEngine2D;
+using namespace KEngine2DChecks;
+
+//Moving a parent by hand, between updates, should reach all of its children on the next update
+static void CheckMovedParent(int threadCount)
+{
+	printf("%d thread(s)\n", threadCount);
+	const int childCount = 40000;
+	MechanicalTransform root;
+	root.Init(StaticTransform::Identity(), Point::Origin());
+	HierarchyUpdater hierarchy;
+	hierarchy.SetThreadCount(threadCount);
+	HierarchicalTransform parent;
+	parent.Init(&hierarchy, &root);
+	std::vector<std::unique_ptr<HierarchicalTransform>> children(childCount);
+	for (int i = 0; i < childCount; i++)
+	{
+		children[i].reset(new HierarchicalTransform);
+		children[i]->Init(&hierarchy, &parent, StaticTransform({ 1.0f, 0.0f }));
+	}
+	hierarchy.Update(1.0 / 60.0);
+
+	//A quarter turn each time, so the children end up going round the parent
+	bool allMoved = true;
+	for (int turn = 1; turn <= 8; turn++)
+	{
+		parent.SetLocalTransform(StaticTransform({ 0.0f, 2.0f }, turn * 3.14159265f / 2.0f));
+		hierarchy.Update(1.0 / 60.0);
+		Point expected = { turn % 4 == 2 ? -1.0f : (turn % 4 == 0 ? 1.0f : 0.0f), 2.0f + (turn % 4 == 1 ? 1.0f : (turn % 4 == 3 ? -1.0f : 0.0f)) };
+		for (std::unique_ptr<HierarchicalTransform> const & child : children)
+		{
+			Point translation = child->GetTranslation();
+			allMoved = allMoved && std::fabs(translation.x - expected.x) < 1e-4f && std::fabs(translation.y - expected.y) < 1e-4f;
+		}
+	}
+	Check(allMoved, "children follow their moved parent");
+
+	for (std::unique_ptr<HierarchicalTransform> & child : children)
+	{
+		child->Deinit();
+	}
+	parent.Deinit();
+	root.Deinit();
+}
+
+int main()
+{
+	CheckMovedParent(1);
+	CheckMovedParent(4);
+	return Finish("HierarchyChecks2D");
+}
@@ -0,0 +1,72 @@
+//Standalone checks for PhysicalObject's cached mass properties.  Build it along with the library sources, for example:
+//  g++ -std=c++14 -I. -I<KEngineCore include path> Tests/MassChecks2D.cpp *.cpp -o MassChecks2D -lpthread
+#include <limits>
+#include "../Physics2D.h"
+#include "../MechanicsBatch2D.h"
+#include "Check2D.h"
+
+using namespace KEngine2D;
+using namespace KEngine2DChecks;
+
+static void CheckCachedInertia()
+{
+	MechanicsBatch batch;
+	PhysicsSystem system;
+	system.Init(BroadphaseType::SweepAndPrune);
+	PhysicsHandle body = system.CreateBody(&batch, 2.0f);
+	PhysicalObject * object = system.GetBody(body);
+	CheckNear(object->GetInverseMass(), 0.5f, "inverse mass");
+	CheckNear(object->GetMomentOfInertia(), 0.0f, "no shapes, no inertia");
+	CheckNear(object->GetInverseMomentOfInertia(), 0.0f, "no inertia can't turn");
+
+	system.AddBox(body, 3.0f, 2.0f);
+	Scalar boxInertia = 2.0f * (9.0f + 4.0f) / 12.0f;
+	CheckNear(object->GetMomentOfInertia(), boxInertia, "adding a shape updates the inertia");
+	CheckNear(object->GetInverseMomentOfInertia(), 1.0f / boxInertia, "and its inverse");
+
+	object->GetMechanics()->SetCurrentTransform(StaticTransform(Point::Origin(), 0.0f, 2.0f));
+	CheckNear(object->GetMomentOfInertia(), boxInertia * 4.0f, "scaling updates the inertia");
+
+	object->SetMass(4.0f);
+	CheckNear(object->GetMomentOfInertia(), boxInertia * 8.0f, "changing the mass updates the inertia");
+	system.Deinit();
+}
+
+static void CheckInfiniteMass(Scalar mass, char const * description)
+{
+	MechanicsBatch batch;
+	PhysicsSystem system;
+	system.Init(BroadphaseType::SweepAndPrune);
+	PhysicsHandle body = system.CreateBody(&batch, mass);
+	system.AddBox(body, 3.0f, 2.0f);
+	PhysicalObject * object = system.GetBody(body);
+	printf("%s\n", description);
+	Check(object->HasInfiniteMass(), "has infinite mass");
+	Check(object->GetInverseMass() == 0.0f, "zero inverse mass");
+	Check(object->GetInverseMomentOfInertia() == 0.0f, "zero inverse inertia");
+	Check(object->GetEnergy() == 0.0f, "no energy");
+
+	object->ApplyImpulse({ 5.0f, 5.0f }, { 1.0f, 0.0f });
+	Check(object->GetVelocity().x == 0.0f && object->GetVelocity().y == 0.0f, "impulses don't move it");
+	Check(object->GetMechanics()->GetAngularVelocity() == 0.0f, "impulses don't turn it");
+
+	//Something landing on it bounces off, and it stays where it is
+	PhysicsHandle ball = system.CreateBody(&batch, 1.0f, StaticTransform({ 0.0f, 3.0f }), { 0.0f, -10.0f });
+	system.AddCircle(ball, 1.0f);
+	for (int frame = 0; frame < 30; frame++)
+	{
+		batch.Integrate(1.0 / 60.0);
+		system.Update(1.0 / 60.0);
+	}
+	Check(object->GetMechanics()->GetTranslation().x == 0.0f && object->GetMechanics()->GetTranslation().y == 0.0f, "collisions don't move it");
+	Check(system.GetBody(ball)->GetVelocity().y > 0.0f, "the other body bounces off");
+	system.Deinit();
+}
+
+int main()
+{
+	CheckCachedInertia();
+	CheckInfiniteMass(std::numeric_limits<Scalar>::infinity(), "Infinite mass");
+	CheckInfiniteMass(0.0f, "Zero mass");
+	return Finish("MassChecks2D");
+}
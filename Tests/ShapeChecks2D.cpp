@@ -0,0 +1,85 @@
+//Standalone checks for the bounding shapes.  Build it along with the library sources, for example:
+//  g++ -std=c++14 -I. -I<KEngineCore include path> Tests/ShapeChecks2D.cpp *.cpp -o ShapeChecks2D
+#include "../Boundaries2D.h"
+#include "../StaticTransform2D.h"
+#include "Check2D.h"
+
+using namespace KEngine2D;
+using namespace KEngine2DChecks;
+
+static void CheckSquareMatchesBox(StaticTransform transform)
+{
+	Point square[4] = { { -1.5f, -1.0f }, { 1.5f, -1.0f }, { 1.5f, 1.0f }, { -1.5f, 1.0f } };
+	BoundingPolygon polygon;
+	polygon.Init(&transform, square, 4);
+	BoundingBox box;
+	box.Init(&transform, 3.0f, 2.0f);
+	CheckNear(polygon.GetArea(), box.GetArea(), "square polygon has the box's area");
+	CheckNear(polygon.GetAreaMomentOfInertia(), box.GetAreaMomentOfInertia(), "square polygon has the box's inertia");
+	CheckNear(polygon.GetInnerRadius(), 1.0f * transform.GetScale(), "square polygon's inner radius is half its short side");
+
+	BoundingArea polygonArea;
+	polygonArea.Init(&transform);
+	polygonArea.AddBoundingPolygon(&polygon);
+	BoundingArea boxArea;
+	boxArea.Init(&transform);
+	boxArea.AddBoundingBox(&box);
+	CheckNear(polygonArea.GetAreaMomentOfInertia(), boxArea.GetAreaMomentOfInertia(), "square polygon area has the box area's inertia");
+}
+
+//Two halves side by side have to add up to the whole
+static void CheckCompoundMatchesWhole()
+{
+	StaticTransform center({ 0.0f, 0.0f });
+	StaticTransform left({ -1.0f, 0.0f });
+	Point rightHalf[4] = { { 0.0f, -1.0f }, { 2.0f, -1.0f }, { 2.0f, 1.0f }, { 0.0f, 1.0f } };
+	BoundingBox leftBox;
+	leftBox.Init(&left, 2.0f, 2.0f);
+	BoundingPolygon rightPolygon;
+	rightPolygon.Init(&center, rightHalf, 4);
+	BoundingArea halves;
+	halves.Init(&center);
+	halves.AddBoundingBox(&leftBox);
+	halves.AddBoundingPolygon(&rightPolygon);
+
+	BoundingBox whole;
+	whole.Init(&center, 4.0f, 2.0f);
+	CheckNear(halves.GetAreaMomentOfInertia(), whole.GetAreaMomentOfInertia(), "box and polygon halves have the whole box's inertia");
+}
+
+static void CheckCapsule()
+{
+	StaticTransform transform({ 0.0f, 0.0f });
+	BoundingCapsule capsule;
+	capsule.Init(&transform, 4.0f, 1.0f);
+	CheckNear(capsule.GetArea(), 8.0f + M_PI, "capsule area is the rectangle plus one disc");
+
+	//Lying on its side, two units above the square's top face
+	Point square[4] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+	StaticTransform squareTransform({ 0.0f, -4.0f });
+	BoundingPolygon polygon;
+	polygon.Init(&squareTransform, square, 4);
+	Point point, otherPoint;
+	CheckNear(GetHullDistance(polygon.GetConvexHull(), capsule.GetConvexHull(), point, otherPoint), 3.0f, "distance from square to capsule segment");
+
+	ContactManifold manifold;
+	StaticTransform restingTransform({ 0.0f, 1.75f });
+	BoundingCapsule resting;
+	resting.Init(&restingTransform, 4.0f, 1.0f);
+	Check(GetHullManifold(polygon.GetConvexHull(), resting.GetConvexHull(), manifold) == false, "separated capsule has no manifold");
+	restingTransform.SetTranslation({ 0.0f, -2.25f });
+	resting.UpdatePose();
+	Check(GetHullManifold(polygon.GetConvexHull(), resting.GetConvexHull(), manifold), "overlapping capsule has a manifold");
+	Check(manifold.pointCount == 2, "capsule lying on a face touches at two points");
+	CheckNear(manifold.normal.y, 1.0f, "normal points from the square to the capsule");
+	CheckNear(manifold.points[0].depth, 0.25f, "depth of the capsule's overlap");
+}
+
+int main()
+{
+	CheckSquareMatchesBox(StaticTransform({ 0.0f, 0.0f }));
+	CheckSquareMatchesBox(StaticTransform({ 3.0f, -2.0f }, 0.7f, 2.0f));
+	CheckCompoundMatchesWhole();
+	CheckCapsule();
+	return Finish("ShapeChecks2D");
+}
@@ -0,0 +1,93 @@
+//Standalone checks for objects falling asleep and waking up.  Build it along with the library sources, for example:
+//  g++ -std=c++14 -I. -I<KEngineCore include path> Tests/SleepChecks2D.cpp *.cpp -o SleepChecks2D -lpthread
+#include "../Physics2D.h"
+#include "../MechanicsBatch2D.h"
+#include "Check2D.h"
+
+using namespace KEngine2D;
+using namespace KEngine2DChecks;
+
+static void Step(MechanicsBatch & batch, PhysicsSystem & system)
+{
+	batch.Integrate(1.0 / 60.0);
+	system.Update(1.0 / 60.0);
+}
+
+//Moving an asleep object onto another has to be noticed, even though nothing else about it changed
+static void CheckTeleportWakes()
+{
+	MechanicsBatch batch;
+	PhysicsSystem system;
+	system.Init(BroadphaseType::SweepAndPrune);
+	PhysicsHandle moved = system.CreateBody(&batch, 1.0f, StaticTransform({ -10.0f, 0.0f }));
+	PhysicsHandle resting = system.CreateBody(&batch, 1.0f, StaticTransform({ 10.0f, 0.0f }));
+	system.AddCircle(moved, 1.0f);
+	system.AddCircle(resting, 1.0f);
+	system.GetBody(moved)->GetMechanics()->SetAwake(false);
+	system.GetBody(resting)->GetMechanics()->SetAwake(false);
+	Step(batch, system);
+	Check(system.GetStatistics().asleepCount == 2, "both start asleep");
+
+	system.GetBody(moved)->GetMechanics()->SetCurrentTransform(StaticTransform({ 9.5f, 0.0f }));
+	Check(system.GetBody(moved)->IsAwake(), "teleporting wakes it");
+	Step(batch, system);
+	Check(system.GetStatistics().collisionCount == 1, "it collides where it was moved to");
+	Check(system.GetBody(resting)->IsAwake(), "and wakes what it landed on");
+	system.Deinit();
+}
+
+//An object woken by a collision should be held up by the boundaries it's touching on the same update
+static void CheckWokenObjectsTouchBoundaries()
+{
+	MechanicsBatch batch;
+	PhysicsSystem system;
+	system.Init(BroadphaseType::SweepAndPrune);
+	BoundaryLine floor;
+	floor.Init(0.0f, 1.0f, 10.0f);
+	system.AddBoundary(&floor);
+	PhysicsHandle box = system.CreateBody(&batch, 1.0f, StaticTransform({ 0.0f, 0.4f }));
+	system.AddBox(box, 1.0f, 1.0f);
+	Step(batch, system);
+	system.GetBody(box)->GetMechanics()->SetAwake(false);
+
+	//Boundaries don't wake anything, so the floor can be moved up into the box while it sleeps
+	floor.Init(0.0f, 1.0f, 0.0f);
+	Step(batch, system);
+	Check(system.GetStatistics().collisionCount == 0, "asleep objects aren't tested against boundaries");
+
+	PhysicsHandle ball = system.CreateBody(&batch, 1.0f, StaticTransform({ 0.9f, 0.6f }), { -1.0f, 0.0f });
+	system.AddCircle(ball, 0.5f);
+	Step(batch, system);
+	Check(system.GetBody(box)->IsAwake(), "the ball wakes the box");
+	Check(system.GetStatistics().collisionCount == 2, "the box touches the floor as well as the ball");
+	system.Deinit();
+	floor.Deinit();
+}
+
+static void CheckDisablingSleepInBatch()
+{
+	MechanicsBatch batch;
+	PhysicsSystem system;
+	system.Init(BroadphaseType::SweepAndPrune);
+	PhysicsHandle first = system.CreateBody(&batch, 1.0f, StaticTransform({ -10.0f, 0.0f }));
+	PhysicsHandle second = system.CreateBody(&batch, 1.0f, StaticTransform({ 10.0f, 0.0f }));
+	system.AddCircle(first, 1.0f);
+	system.AddCircle(second, 1.0f);
+	system.GetBody(second)->GetMechanics()->SetAwake(false);
+	system.BeginBatch();
+	system.DestroyBody(first);
+	system.SetSleepingEnabled(false);
+	system.EndBatch();
+	Check(system.GetBody(second)->IsAwake(), "disabling sleep in a batch wakes what's left");
+	Step(batch, system);
+	Check(system.GetStatistics().objectCount == 1, "the removed object is gone");
+	system.Deinit();
+}
+
+int main()
+{
+	CheckTeleportWakes();
+	CheckWokenObjectsTouchBoundaries();
+	CheckDisablingSleepInBatch();
+	return Finish("SleepChecks2D");
+}
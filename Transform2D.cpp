@@ -1,4 +1,5 @@
 #include "Transform2D.h"
+#include "ScalarSimd2D.h"
 #include <assert.h>
 #include <cmath>
 
@@ -13,103 +14,138 @@ const KEngine2D::Matrix & KEngine2D::Matrix::Identity()
     return identity;
 }
 
-KEngine2D::Point const & KEngine2D::Point::Origin()
+template <typename T>
+KEngine2D::BasicPoint<T> const & KEngine2D::BasicPoint<T>::Origin()
 {
-	static Point origin = {0.0f, 0.0f};
+	static BasicPoint origin = {0.0f, 0.0f};
 	return origin;
 }
 
-KEngine2D::Point & KEngine2D::Point::operator+=( Point const & other )
+template <typename T>
+KEngine2D::BasicAffine<T> const & KEngine2D::BasicAffine<T>::Identity()
 {
-	x += other.x;
-	y += other.y;
-	return *this;
+	static BasicAffine identity = {{
+		{1,0,0},
+		{0,1,0}
+	}};
+	return identity;
 }
 
-KEngine2D::Point & KEngine2D::Point::operator-=( Point const & other )
+template <typename T>
+KEngine2D::BasicAffine<T> KEngine2D::BasicAffine<T>::Make(BasicPoint<T> const & translation, T radians, T scale)
 {
-	x -= other.x;
-	y -= other.y;
-	return *this;
+	return Make(translation, scale, std::cos(radians), std::sin(radians));
 }
 
-KEngine2D::Point & KEngine2D::Point::operator*=(double const & scalar)
+template <typename T>
+KEngine2D::BasicAffine<T> KEngine2D::BasicAffine<T>::Make(BasicPoint<T> const & translation, T scale, T cosTheta, T sinTheta)
 {
-	x *= scalar;
-	y *= scalar;
-	return *this;
+	return {{
+		{ scale * cosTheta, -scale * sinTheta, translation.x },
+		{ scale * sinTheta, scale * cosTheta, translation.y }
+	}};
 }
 
-KEngine2D::Point & KEngine2D::Point::operator/=(double const & scalar)
+template <typename T>
+KEngine2D::BasicAffine<T> KEngine2D::BasicAffine<T>::operator*(BasicAffine const & other) const
 {
-	assert(scalar != 0.0f);
-	x /= scalar;
-	y /= scalar;
-	return *this;
+	BasicAffine retVal;
+	for (int row = 0; row < 2; row++) {
+		retVal.data[row][0] = (data[row][0] * other.data[0][0]) + (data[row][1] * other.data[1][0]);
+		retVal.data[row][1] = (data[row][0] * other.data[0][1]) + (data[row][1] * other.data[1][1]);
+		retVal.data[row][2] = (data[row][0] * other.data[0][2]) + (data[row][1] * other.data[1][2]) + data[row][2];
+	}
+	return retVal;
 }
 
-KEngine2D::Point KEngine2D::Point::operator-()
+template <typename T>
+KEngine2D::BasicAffine<T> KEngine2D::BasicAffine<T>::Inverse() const
 {
-	Point retVal = {-x, -y};
+	T determinant = (data[0][0] * data[1][1]) - (data[0][1] * data[1][0]);
+	assert(determinant != 0.0f);
+	T inverseDeterminant = 1.0f / determinant;
+	BasicAffine retVal;
+	retVal.data[0][0] = data[1][1] * inverseDeterminant;
+	retVal.data[0][1] = -data[0][1] * inverseDeterminant;
+	retVal.data[1][0] = -data[1][0] * inverseDeterminant;
+	retVal.data[1][1] = data[0][0] * inverseDeterminant;
+	retVal.data[0][2] = -((retVal.data[0][0] * data[0][2]) + (retVal.data[0][1] * data[1][2]));
+	retVal.data[1][2] = -((retVal.data[1][0] * data[0][2]) + (retVal.data[1][1] * data[1][2]));
 	return retVal;
 }
 
-KEngine2D::Point KEngine2D::Point::operator+(Point const & other)
+template <typename T>
+KEngine2D::BasicPoint<T> KEngine2D::BasicAffine<T>::Apply(BasicPoint<T> const & point) const
 {
-	return{ x + other.x, y + other.y };
+	return { (data[0][0] * point.x) + (data[0][1] * point.y) + data[0][2], (data[1][0] * point.x) + (data[1][1] * point.y) + data[1][2] };
 }
 
-KEngine2D::Point KEngine2D::Point::operator-(Point const & other) 
+template <typename T>
+KEngine2D::BasicPoint<T> KEngine2D::BasicAffine<T>::ApplyToVector(BasicPoint<T> const & vector) const
 {
-	return{ x - other.x, y - other.y };
+	return { (data[0][0] * vector.x) + (data[0][1] * vector.y), (data[1][0] * vector.x) + (data[1][1] * vector.y) };
 }
 
-float KEngine2D::DotProduct(Point const & vec1, Point const & vec2)
+template <typename T>
+KEngine2D::Matrix KEngine2D::BasicAffine<T>::ToMatrix() const
 {
-	return (vec1.x * vec2.x) + (vec1.y * vec2.y);
+	return {{
+		{ (float)data[0][0], (float)data[0][1], 0.0f, (float)data[0][2] },
+		{ (float)data[1][0], (float)data[1][1], 0.0f, (float)data[1][2] },
+		{ 0.0f, 0.0f, 1.0f, 0.0f },
+		{ 0.0f, 0.0f, 0.0f, 1.0f }
+	}};
 }
 
-//Cross Product is undefined, but this gets the z-value (magnitude) of the vector we'd get if these were 3d vectors
-float KEngine2D::PseudoCrossProduct(Point const & vec1, Point const & vec2)
+template struct KEngine2D::BasicPoint<float>;
+template struct KEngine2D::BasicPoint<double>;
+template struct KEngine2D::BasicAffine<float>;
+template struct KEngine2D::BasicAffine<double>;
+
+KEngine2D::Affine KEngine2D::Transform::GetAsAffine() const
 {
-	return (vec1.x * vec2.y) - (vec1.y * vec2.x);
+	return Affine::Make(GetTranslation(), GetRotation(), GetScale());
 }
 
-//Cross Product is even more undefined, but this gets the vector this were a 3d vector and the scalar was the z value of another 3d vector
-KEngine2D::Point KEngine2D::PseudoCrossProduct(Point const & vec1, float scalar)
+KEngine2D::Matrix KEngine2D::Transform::GetAsMatrix() const
 {
-	return{ -1.0 * vec1.y * scalar, vec1.x * scalar }; 
+	return GetAsAffine().ToMatrix();
 }
 
-KEngine2D::Point KEngine2D::Project( Point const & axis, Point const & vec, bool positiveOnly /*= false*/ )
+KEngine2D::Pose KEngine2D::Transform::GetPose() const
 {
-	//Yes this does project on any length vector without square root.  Thanks for noticing.
-	double dotProduct = DotProduct(vec, axis);
-	double axisLength2 = DotProduct(axis, axis);
-	double scalarResolute = axisLength2 != 0 ? dotProduct / axisLength2 : 0; ///Make sure not to divide by zero
-	if (positiveOnly && scalarResolute < 0.0f)
-	{
-		scalarResolute = 0.0f;
-	}
-
-	KEngine2D::Point projection = axis;
-	projection *= scalarResolute;
-	return projection;
+	Scalar radians = GetRotation();
+	return { GetTranslation(), GetScale(), std::cos(radians), std::sin(radians) };
 }
 
 KEngine2D::Point KEngine2D::Transform::LocalToGlobal(Point const & point, bool asVector) const
+{
+	return GetPose().LocalToGlobal(point, asVector);
+}
+
+KEngine2D::Point KEngine2D::Transform::GlobalToLocal(Point const & point) const
+{
+	return GetPose().GlobalToLocal(point);
+}
+
+void KEngine2D::Transform::LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector /*= false*/) const
+{
+	GetPose().LocalToGlobalBatch(points, results, count, asVector);
+}
+
+void KEngine2D::Transform::GlobalToLocalBatch(Point const * points, Point * results, size_t count) const
+{
+	GetPose().GlobalToLocalBatch(points, results, count);
+}
+
+KEngine2D::Point KEngine2D::Pose::LocalToGlobal(Point const & point, bool asVector) const
 {
 	Point retVal = point;
-	double scale = GetScale();
-	double radians = GetRotation();
-	Point translation = GetTranslation();
 	if (!asVector)
 	{
 		retVal.x *= scale;
 		retVal.y *= scale;
 	}
-	float cosTheta = cos(radians);
-	float sinTheta = sin(radians);
 	retVal = { (retVal.x * cosTheta) - (retVal.y * sinTheta), (retVal.y * cosTheta) + (retVal.x * sinTheta) };
 	if (!asVector)
 	{
@@ -119,14 +155,76 @@ KEngine2D::Point KEngine2D::Transform::LocalToGlobal(Point const & point, bool a
 	return retVal;
 }
 
-KEngine2D::Point KEngine2D::Transform::GlobalToLocal(Point const & point) const
+KEngine2D::Point KEngine2D::Pose::GlobalToLocal(Point const & point) const
 {
 	Point retVal;
-	double radians = GetRotation();
-	Point translation = GetTranslation();
-	float cosTheta = cos(radians);
-	float sinTheta = sin(radians);
 	retVal.x = ((point.x - translation.x) * cosTheta) + ((point.y - translation.y) * sinTheta);
 	retVal.y = ((point.y - translation.y) * cosTheta) - ((point.x - translation.x) * sinTheta);
 	return retVal;
 }
+
+//Working it out in the same order as LocalToGlobal keeps the results exactly the same
+void KEngine2D::Pose::LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector /*= false*/) const
+{
+	Scalar pointScale = asVector ? 1.0f : scale;
+	Point offset = asVector ? Point::Origin() : translation;
+	size_t i = 0;
+#if defined(KENGINE2D_SCALAR_AVX)
+	i += LocalToGlobalPoints<WideScalars>(points + i, results + i, count - i, pointScale, offset, cosTheta, sinTheta);
+#endif
+#if defined(KENGINE2D_SCALAR_SSE)
+	i += LocalToGlobalPoints<NarrowScalars>(points + i, results + i, count - i, pointScale, offset, cosTheta, sinTheta);
+#endif
+	for (; i < count; i++) {
+		Point point = { points[i].x * pointScale, points[i].y * pointScale };
+		results[i] = { (point.x * cosTheta) - (point.y * sinTheta) + offset.x, (point.y * cosTheta) + (point.x * sinTheta) + offset.y };
+	}
+}
+
+void KEngine2D::Pose::GlobalToLocalBatch(Point const * points, Point * results, size_t count) const
+{
+	size_t i = 0;
+#if defined(KENGINE2D_SCALAR_AVX)
+	i += GlobalToLocalPoints<WideScalars>(points + i, results + i, count - i, translation, cosTheta, sinTheta);
+#endif
+#if defined(KENGINE2D_SCALAR_SSE)
+	i += GlobalToLocalPoints<NarrowScalars>(points + i, results + i, count - i, translation, cosTheta, sinTheta);
+#endif
+	for (; i < count; i++) {
+		Point delta = { points[i].x - translation.x, points[i].y - translation.y };
+		results[i] = { (delta.x * cosTheta) + (delta.y * sinTheta), (delta.y * cosTheta) - (delta.x * sinTheta) };
+	}
+}
+
+//The swapped copy of each point gives the cross terms
+template <typename Registers>
+size_t KEngine2D::Pose::LocalToGlobalPoints(Point const * points, Point * results, size_t count, Scalar pointScale, Point const & offset, Scalar cosTheta, Scalar sinTheta)
+{
+	constexpr size_t pointsPerRegister = Registers::Count / 2;
+	typename Registers::Register scale = Registers::Set(pointScale);
+	typename Registers::Register cosines = Registers::Set(cosTheta);
+	typename Registers::Register sines = Registers::SetPairs(-sinTheta, sinTheta);
+	typename Registers::Register offsets = Registers::SetPairs(offset.x, offset.y);
+	size_t i = 0;
+	for (; i + pointsPerRegister <= count; i += pointsPerRegister) {
+		typename Registers::Register point = Registers::Multiply(Registers::Load(&points[i].x), scale);
+		typename Registers::Register rotated = Registers::Add(Registers::Multiply(point, cosines), Registers::Multiply(Registers::SwapPairs(point), sines));
+		Registers::Store(&results[i].x, Registers::Add(rotated, offsets));
+	}
+	return i;
+}
+
+template <typename Registers>
+size_t KEngine2D::Pose::GlobalToLocalPoints(Point const * points, Point * results, size_t count, Point const & translation, Scalar cosTheta, Scalar sinTheta)
+{
+	constexpr size_t pointsPerRegister = Registers::Count / 2;
+	typename Registers::Register cosines = Registers::Set(cosTheta);
+	typename Registers::Register sines = Registers::SetPairs(sinTheta, -sinTheta);
+	typename Registers::Register translations = Registers::SetPairs(translation.x, translation.y);
+	size_t i = 0;
+	for (; i + pointsPerRegister <= count; i += pointsPerRegister) {
+		typename Registers::Register delta = Registers::Subtract(Registers::Load(&points[i].x), translations);
+		Registers::Store(&results[i].x, Registers::Add(Registers::Multiply(delta, cosines), Registers::Multiply(Registers::SwapPairs(delta), sines)));
+	}
+	return i;
+}
@@ -1,44 +1,204 @@
 #pragma once
+#include <cstddef>
+#include <assert.h>
 
 namespace KEngine2D
-{
+{
+	//Define KENGINE2D_SINGLE_PRECISION to build everything on float instead of double.  Points and transforms take half the
+	//memory, and SIMD loops handle twice as many values at a time.
+#if defined(KENGINE2D_SINGLE_PRECISION)
+	typedef float Scalar;
+#else
+	typedef double Scalar;
+#endif
+
     struct Matrix
     {
         float  data[4][4];
         static Matrix const & Identity();
     };
     
-	struct Point
+	//Instantiated for float and double, so tools can use either whatever the engine is built with
+	template <typename T>
+	struct BasicPoint
+	{
+		typedef T ValueType;
+
+		T x;
+		T y;
+		static BasicPoint const & Origin();
+
+		BasicPoint & operator+=(BasicPoint const & other);
+		BasicPoint & operator-=(BasicPoint const & other);
+		BasicPoint & operator*=(T const & scalar);
+		BasicPoint & operator/=(T const & scalar);
+        BasicPoint & operator*=(Matrix const & transform);
+		BasicPoint operator-();
+		BasicPoint operator+(BasicPoint const & other);
+		BasicPoint operator-(BasicPoint const & other);
+	};
+
+	typedef BasicPoint<Scalar> Point;
+
+	template <typename T>
+	T DotProduct(BasicPoint<T> const & vec1, BasicPoint<T> const & vec2);
+	template <typename T>
+	T PseudoCrossProduct(BasicPoint<T> const & vec1, BasicPoint<T> const & vec2);
+	template <typename T>
+	BasicPoint<T> PseudoCrossProduct(BasicPoint<T> const & vec1, typename BasicPoint<T>::ValueType scalar);
+	template <typename T>
+	BasicPoint<T> Project(BasicPoint<T> const & axis, BasicPoint<T> const & vec, bool positiveOnly = false);
+
+	//Top two rows of a 3x3 matrix, which is all a 2D affine transform needs: x' = data[0][0]x + data[0][1]y + data[0][2]
+	template <typename T>
+	struct BasicAffine
 	{
-		double x;
-		double y;
-		static Point const & Origin();
-
-		Point & operator+=(Point const & other);
-		Point & operator-=(Point const & other);
-		Point & operator*=(double const & scalar);
-		Point & operator/=(double const & scalar);
-        Point & operator*=(Matrix const & transform);
-		Point operator-();
-		Point operator+(Point const & other);
-		Point operator-(Point const & other);
+		T data[2][3];
+		static BasicAffine const & Identity();
+		static BasicAffine Make(BasicPoint<T> const & translation, T radians, T scale);
+		static BasicAffine Make(BasicPoint<T> const & translation, T scale, T cosTheta, T sinTheta);
+
+		BasicAffine operator*(BasicAffine const & other) const; //The result applies other first, then this
+		BasicAffine Inverse() const;
+		BasicPoint<T> Apply(BasicPoint<T> const & point) const;
+		BasicPoint<T> ApplyToVector(BasicPoint<T> const & vector) const; //Leaves out the translation
+		Matrix ToMatrix() const;
 	};
 
-	float DotProduct(Point const & vec1, Point const & vec2);
-	float PseudoCrossProduct(Point const & vec1, Point const & vec2);
-	Point PseudoCrossProduct(Point const & vec1, float scalar);
-	Point Project(Point const & axis, Point const & vec, bool positiveOnly = false);
+	typedef BasicAffine<Scalar> Affine;
+
+	//A transform's position, scale and rotation copied out into plain values, trig included, so hot loops can work
+	//from a snapshot without going back through the virtual interface
+	struct Pose
+	{
+		Point translation;
+		Scalar scale;
+		Scalar cosTheta;
+		Scalar sinTheta;
+
+		Point LocalToGlobal(Point const & point, bool asVector = false) const;
+		Point GlobalToLocal(Point const & point) const;
+		void LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector = false) const;
+		void GlobalToLocalBatch(Point const * points, Point * results, size_t count) const;
+
+	private:
+		//Each register holds whole points, x then y.  Returns how far it got, leaving the rest for a narrower register or plain code.
+		template <typename Registers>
+		static size_t LocalToGlobalPoints(Point const * points, Point * results, size_t count, Scalar pointScale, Point const & offset, Scalar cosTheta, Scalar sinTheta);
+		template <typename Registers>
+		static size_t GlobalToLocalPoints(Point const * points, Point * results, size_t count, Point const & translation, Scalar cosTheta, Scalar sinTheta);
+	};
 
 	class Transform
 	{
 	public:
 		virtual ~Transform() {}
 		virtual Point GetTranslation() const = 0;
-		virtual double GetRotation() const = 0;
-		virtual double GetScale() const = 0;
-        virtual const Matrix& GetAsMatrix() const = 0;
+		virtual Scalar GetRotation() const = 0;
+		virtual Scalar GetScale() const = 0;
+		virtual Affine GetAsAffine() const;
+		//Only built when asked for, for the renderer
+		virtual Matrix GetAsMatrix() const;
+		//Goes up whenever the transform changes, so anything derived from it can tell when to recompute
+		virtual unsigned int GetVersion() const = 0;
+		virtual Pose GetPose() const;
 
 		virtual Point LocalToGlobal(Point const & point, bool asVector = false) const;
 		virtual Point GlobalToLocal(Point const & point) const;
+
+		//Same as above for count points at once, with the trig only worked out once.  Results match the single point versions exactly.
+		virtual void LocalToGlobalBatch(Point const * points, Point * results, size_t count, bool asVector = false) const;
+		virtual void GlobalToLocalBatch(Point const * points, Point * results, size_t count) const;
+
 	};
 }
+
+//The point operations are small enough that callers should get to inline them, so they live here rather than in the .cpp
+template <typename T>
+KEngine2D::BasicPoint<T> & KEngine2D::BasicPoint<T>::operator+=( BasicPoint const & other )
+{
+	x += other.x;
+	y += other.y;
+	return *this;
+}
+
+template <typename T>
+KEngine2D::BasicPoint<T> & KEngine2D::BasicPoint<T>::operator-=( BasicPoint const & other )
+{
+	x -= other.x;
+	y -= other.y;
+	return *this;
+}
+
+template <typename T>
+KEngine2D::BasicPoint<T> & KEngine2D::BasicPoint<T>::operator*=(T const & scalar)
+{
+	x *= scalar;
+	y *= scalar;
+	return *this;
+}
+
+template <typename T>
+KEngine2D::BasicPoint<T> & KEngine2D::BasicPoint<T>::operator/=(T const & scalar)
+{
+	assert(scalar != 0.0f);
+	x /= scalar;
+	y /= scalar;
+	return *this;
+}
+
+template <typename T>
+KEngine2D::BasicPoint<T> KEngine2D::BasicPoint<T>::operator-()
+{
+	BasicPoint retVal = {-x, -y};
+	return retVal;
+}
+
+template <typename T>
+KEngine2D::BasicPoint<T> KEngine2D::BasicPoint<T>::operator+(BasicPoint const & other)
+{
+	return{ x + other.x, y + other.y };
+}
+
+template <typename T>
+KEngine2D::BasicPoint<T> KEngine2D::BasicPoint<T>::operator-(BasicPoint const & other) 
+{
+	return{ x - other.x, y - other.y };
+}
+
+template <typename T>
+T KEngine2D::DotProduct(BasicPoint<T> const & vec1, BasicPoint<T> const & vec2)
+{
+	return (vec1.x * vec2.x) + (vec1.y * vec2.y);
+}
+
+//Cross Product is undefined, but this gets the z-value (magnitude) of the vector we'd get if these were 3d vectors
+template <typename T>
+T KEngine2D::PseudoCrossProduct(BasicPoint<T> const & vec1, BasicPoint<T> const & vec2)
+{
+	return (vec1.x * vec2.y) - (vec1.y * vec2.x);
+}
+
+//Cross Product is even more undefined, but this gets the vector this were a 3d vector and the scalar was the z value of another 3d vector
+template <typename T>
+KEngine2D::BasicPoint<T> KEngine2D::PseudoCrossProduct(BasicPoint<T> const & vec1, typename BasicPoint<T>::ValueType scalar)
+{
+	return{ -vec1.y * scalar, vec1.x * scalar }; 
+}
+
+template <typename T>
+KEngine2D::BasicPoint<T> KEngine2D::Project( BasicPoint<T> const & axis, BasicPoint<T> const & vec, bool positiveOnly /*= false*/ )
+{
+	//Yes this does project on any length vector without square root.  Thanks for noticing.
+	T dotProduct = DotProduct(vec, axis);
+	T axisLength2 = DotProduct(axis, axis);
+	T scalarResolute = axisLength2 != 0 ? dotProduct / axisLength2 : 0; ///Make sure not to divide by zero
+	if (positiveOnly && scalarResolute < 0.0f)
+	{
+		scalarResolute = 0.0f;
+	}
+
+	BasicPoint<T> projection = axis;
+	projection *= scalarResolute;
+	return projection;
+}
@@ -0,0 +1,108 @@
+#include "WorkerPool2D.h"
+#include <cassert>
+#include <algorithm>
+
+KEngine2D::WorkerPool::WorkerPool()
+{
+	mNextIndex = 0;
+	mCount = 0;
+	mGrainSize = 1;
+	mBusyWorkers = 0;
+	mGeneration = 0;
+	mQuitting = false;
+	mInvoker = nullptr;
+	mContext = nullptr;
+}
+
+KEngine2D::WorkerPool::~WorkerPool()
+{
+	Deinit();
+}
+
+void KEngine2D::WorkerPool::Init(int threadCount)
+{
+	assert(threadCount >= 1);
+	assert(mWorkers.empty());
+	mQuitting = false;
+	for (int i = 1; i < threadCount; i++) {
+		mWorkers.emplace_back(&WorkerPool::WorkerLoop, this, mGeneration);
+	}
+}
+
+void KEngine2D::WorkerPool::Deinit()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuitting = true;
+	}
+	mWorkReady.notify_all();
+	for (std::thread & worker : mWorkers) {
+		worker.join();
+	}
+	mWorkers.clear();
+}
+
+int KEngine2D::WorkerPool::GetThreadCount() const
+{
+	return (int)mWorkers.size() + 1;
+}
+
+void KEngine2D::WorkerPool::Run(int count, int grainSize, TaskInvoker invoker, void const * context)
+{
+	assert(grainSize >= 1);
+	if (mWorkers.empty() || count <= grainSize) {
+		for (int i = 0; i < count; i++) {
+			invoker(context, i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mInvoker = invoker;
+		mContext = context;
+		mCount = count;
+		mGrainSize = grainSize;
+		mNextIndex = 0;
+		mBusyWorkers = (int)mWorkers.size();
+		mGeneration++;
+	}
+	mWorkReady.notify_all();
+
+	Work();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWorkDone.wait(lock, [this]() { return mBusyWorkers == 0; });
+}
+
+void KEngine2D::WorkerPool::Work()
+{
+	for (int begin = mNextIndex.fetch_add(mGrainSize); begin < mCount; begin = mNextIndex.fetch_add(mGrainSize)) {
+		int end = std::min(begin + mGrainSize, mCount);
+		for (int i = begin; i < end; i++) {
+			mInvoker(mContext, i);
+		}
+	}
+}
+
+void KEngine2D::WorkerPool::WorkerLoop(unsigned int generation)
+{
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWorkReady.wait(lock, [this, generation]() { return mQuitting || mGeneration != generation; });
+			if (mQuitting) {
+				return;
+			}
+			generation = mGeneration;
+		}
+
+		Work();
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mBusyWorkers--;
+		if (mBusyWorkers == 0) {
+			mWorkDone.notify_one();
+		}
+	}
+}
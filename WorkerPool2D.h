@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace KEngine2D
+{
+	//Fixed set of worker threads for splitting a loop across cores.  The calling thread works too, so a pool
+	//of one thread has no workers and just runs everything inline.
+	class WorkerPool
+	{
+	public:
+		WorkerPool();
+		~WorkerPool();
+
+		void Init(int threadCount);
+		void Deinit();
+
+		int GetThreadCount() const;
+
+		//Calls task(index) for every index in [0, count), handing out grainSize indices at a time.  Returns once all are done.
+		template <typename Task>
+		void ParallelFor(int count, int grainSize, Task const & task)
+		{
+			Run(count, grainSize, [](void const * context, int index) { (*static_cast<Task const *>(context))(index); }, &task);
+		}
+
+	private:
+		typedef void (*TaskInvoker)(void const * context, int index);
+
+		void Run(int count, int grainSize, TaskInvoker invoker, void const * context);
+		void Work();
+		void WorkerLoop(unsigned int generation);
+
+		std::vector<std::thread> mWorkers;
+		std::mutex mMutex;
+		std::condition_variable mWorkReady;
+		std::condition_variable mWorkDone;
+		std::atomic<int> mNextIndex;
+		int mCount;
+		int mGrainSize;
+		int mBusyWorkers;
+		unsigned int mGeneration;
+		bool mQuitting;
+		TaskInvoker mInvoker;
+		void const * mContext;
+	};
+}